@@ -0,0 +1,159 @@
+/*
+ * Traffic assignment report.
+ *
+ * Loads each map (without a GraphViewer window), draws a random demand
+ * matrix (trips from a set of origins to random destinations) and
+ * solves its user equilibrium with assignTraffic, printing the relative
+ * gap, total travel time and step of every iteration, and whether the
+ * gap asked for was reached or the iterations ran out first.
+ *
+ * Kept outside src/ so it does not clash with the application's main().
+ * Build from the project root with:
+ *   g++ -std=gnu++14 -O2 -Isrc -IGraphViewer/cpp benchmark/AssignmentReport.cpp \
+ *       $(find src GraphViewer/cpp -name '*.cpp' ! -name main.cpp) \
+ *       -o assignment_report -lpthread          (add -lws2_32 on Windows)
+ *
+ * Usage:
+ *   assignment_report [--maps porto,paris,...] [--pairs N] [--origins N]
+ *                     [--vehicles V] [--iterations N] [--gap G]
+ *                     [--threads N] [--seed S] [--resource DIR]
+ */
+#include "LoadMap.h"
+#include "Graph.h"
+#include "Benchmark.h"
+#include "Assignment.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <random>
+
+using namespace std;
+
+struct Options {
+	vector<string> maps = {"porto", "paris"};
+	int pairs = 3000;
+	int origins = 300;
+	double vehicles = 2;
+	int iterations = ASSIGNMENT_MAX_ITERATIONS;
+	double gap = ASSIGNMENT_GAP;
+	int threads = 0;
+	unsigned seed = 1;
+	string resource = "./resource/";
+};
+
+
+
+////////////
+// Report //
+////////////
+
+static void reportMap(const string &name, const Options &options) {
+	Graph *g = nullptr;
+	MetaData meta;
+	if (loadMap(options.resource + name, g, meta, false, false) != 0) {
+		cerr << "Failed to load map " << name << endl;
+		delete g;
+		return;
+	}
+
+	mt19937 random(options.seed);
+	vector<Vertex*> vertices = g->getAllVertexSet();
+	vector<Vertex*> origins;
+	for (int i = 0; i < options.origins; ++i)
+		origins.push_back(vertices[random() % vertices.size()]);
+	vector<TripDemand> demand;
+	for (int i = 0; i < options.pairs; ++i)
+		demand.push_back({origins[random() % origins.size()], vertices[random() % vertices.size()], options.vehicles});
+
+	cout << endl << name << ": " << vertices.size() << " vertices, " << demand.size() << " trips from "
+			<< origins.size() << " origins, " << options.vehicles << " vehicles each" << endl;
+	cout << right << setw(9) << "iteration" << setw(12) << "gap" << setw(16) << "total (veh h)"
+			<< setw(10) << "step" << setw(12) << "time (ms)" << endl;
+
+	AssignmentResult result = assignTraffic(g, demand, options.iterations, options.gap, options.threads,
+			[](const AssignmentIteration &iteration) {
+		cout << setw(9) << iteration.iteration << setw(12) << scientific << setprecision(3) << iteration.gap
+				<< setw(16) << fixed << setprecision(2) << iteration.totalTime
+				<< setw(10) << setprecision(4) << iteration.step
+				<< setw(12) << setprecision(1) << iteration.time / 1000 << endl;
+	});
+
+	double last = result.iterations.empty() ? 0 : result.iterations.back().gap;
+	cout << defaultfloat << setprecision(3);
+	if (result.converged)
+		cout << "Converged after " << result.iterations.size() << (result.iterations.size() == 1 ? " iteration" : " iterations")
+				<< " (gap " << last << ")";
+	else
+		cout << "Stopped at the cap of " << options.iterations << " iterations without converging (gap " << last
+				<< ", asked for " << options.gap << ")";
+	cout << setprecision(6) << ", " << result.unassigned << " vehicles with no route" << endl;
+
+	delete g;
+}
+
+
+
+//////////
+// Main //
+//////////
+
+static vector<string> splitList(const string &list) {
+	vector<string> items;
+	stringstream stream(list);
+	string item;
+	while (getline(stream, item, ',')) {
+		if (!item.empty()) items.push_back(item);
+	}
+	return items;
+}
+
+static string directory(string path) {
+	if (!path.empty() && path.back() != '/' && path.back() != '\\') path += '/';
+	return path;
+}
+
+static int parseOptions(int argc, char *argv[], Options &options) {
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (i + 1 >= argc) {
+			cerr << "Missing value for " << arg << endl;
+			return -1;
+		}
+		string value = argv[++i];
+
+		try {
+			if (arg == "--maps") options.maps = splitList(value);
+			else if (arg == "--pairs") options.pairs = stoi(value);
+			else if (arg == "--origins") options.origins = stoi(value);
+			else if (arg == "--vehicles") options.vehicles = stod(value);
+			else if (arg == "--iterations") options.iterations = stoi(value);
+			else if (arg == "--gap") options.gap = stod(value);
+			else if (arg == "--threads") options.threads = stoi(value);
+			else if (arg == "--seed") options.seed = stoul(value);
+			else if (arg == "--resource") options.resource = directory(value);
+			else {
+				cerr << "Unknown option " << arg << endl;
+				return -1;
+			}
+		} catch (exception &e) {
+			cerr << "Invalid value " << value << " for " << arg << endl;
+			return -1;
+		}
+	}
+	return options.pairs > 0 && options.origins > 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+	Options options;
+	if (parseOptions(argc, argv, options) != 0) {
+		cerr << "Usage: " << argv[0] << " [--maps a,b,...] [--pairs N] [--origins N] [--vehicles V]"
+			" [--iterations N] [--gap G] [--threads N] [--seed S] [--resource DIR]" << endl;
+		return 1;
+	}
+
+	for (const string &name : options.maps)
+		reportMap(name, options);
+
+	return 0;
+}
@@ -0,0 +1,230 @@
+/*
+ * Evacuation report.
+ *
+ * Loads each map (without a GraphViewer window), picks random safe
+ * zones and builds their SafeZoneTable. Then, round after round, it
+ * accidents a random area, lets the table follow, and fixes the area
+ * again. Each round prints the time of the table's update against
+ * building a new table, and the vertices where the two disagree,
+ * which should always be 0.
+ *
+ * Then it plans the evacuation of random regions (the vertices
+ * nearest to a random one) to the same safe zones through the clear
+ * network: the most vehicles per hour that can leave each region
+ * (maxEvacuationFlow), and the plan of least total travel time
+ * (planEvacuation), with the time each takes.
+ *
+ * Kept outside src/ so it does not clash with the application's main().
+ * Build from the project root with:
+ *   g++ -std=gnu++14 -O2 -Isrc -IGraphViewer/cpp benchmark/EvacuationReport.cpp \
+ *       $(find src GraphViewer/cpp -name '*.cpp' ! -name main.cpp) \
+ *       -o evacuation_report -lpthread          (add -lws2_32 on Windows)
+ *
+ * Usage:
+ *   evacuation_report [--maps porto,paris,...] [--zones N] [--rounds N]
+ *                     [--area N] [--metric distance|time] [--regions N]
+ *                     [--region N] [--vehicles N] [--seed S]
+ *                     [--resource DIR]
+ */
+#include "LoadMap.h"
+#include "Graph.h"
+#include "Benchmark.h"
+#include "Evacuation.h"
+#include "CompactGraph.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <random>
+#include <math.h>
+
+using namespace std;
+
+struct Options {
+	vector<string> maps = {"porto", "paris"};
+	int zones = 5;
+	int rounds = 10;
+	int area = 50;             // Vertices accidented each round
+	Metric metric = DISTANCE;
+	int regions = 5;
+	int region = 200;          // Vertices of each region evacuated
+	int vehicles = -1;         // Per hour; the most that can leave if negative
+	unsigned seed = 1;
+	string resource = "./resource/";
+};
+
+
+
+////////////
+// Report //
+////////////
+
+/*
+ * @brief Vertices where table and a new table of the same safe
+ * zones disagree on the cost
+ */
+static int mismatches(Graph *g, const SafeZoneTable &table, const vector<Vertex*> &zones, Metric metric) {
+	SafeZoneTable fresh(g, zones, metric);
+	int count = 0;
+	for (Vertex *v : g->getAllVertexSet()) {
+		double a = table.getCost(v), b = fresh.getCost(v);
+		if (a != b && !(fabs(a - b) <= 1e-9 * max(1.0, fabs(b)))) ++count;
+	}
+	return count;
+}
+
+static void reportSafeZones(Graph *g, const Options &options, mt19937 &random, vector<Vertex*> &zones) {
+	vector<Vertex*> vertices = g->getVertexSet();
+	for (int i = 0; i < options.zones; ++i)
+		zones.push_back(vertices[random() % vertices.size()]);
+
+	auto start = chrono::steady_clock::now();
+	SafeZoneTable table(g, zones, options.metric);
+	double build = elapsedMicroseconds(start);
+	cout << "Safe zone table: " << zones.size() << " zones, " << table.getNumCovered() << " vertices covered, built in "
+			<< fixed << setprecision(2) << build / 1000 << " ms" << endl;
+	cout << right << setw(6) << "round" << setw(10) << "covered" << setw(14) << "update (ms)"
+			<< setw(14) << "rebuild (ms)" << setw(10) << "fix (ms)" << setw(12) << "mismatches" << endl;
+
+	for (int r = 1; r <= options.rounds; ++r) {
+		Vertex *center = vertices[random() % vertices.size()];
+		vector<Vertex*> area = g->findNearestVertices(center->getX(), center->getY(), options.area);
+
+		// One bulk accident: the table follows it in one update
+		start = chrono::steady_clock::now();
+		g->accidentVertices(area);
+		double update = elapsedMicroseconds(start);
+		int covered = table.getNumCovered();
+
+		start = chrono::steady_clock::now();
+		SafeZoneTable rebuilt(g, zones, options.metric);
+		double rebuild = elapsedMicroseconds(start);
+		int bad = mismatches(g, table, zones, options.metric);
+
+		start = chrono::steady_clock::now();
+		g->fixVertices(area);
+		double fix = elapsedMicroseconds(start);
+		bad += mismatches(g, table, zones, options.metric);
+
+		cout << setw(6) << r << setw(10) << covered << setw(14) << update / 1000 << setw(14) << rebuild / 1000
+				<< setw(10) << fix / 1000 << setw(12) << bad << endl;
+	}
+	cout << defaultfloat << setprecision(6);
+}
+
+static void reportEvacuations(Graph *g, const Options &options, mt19937 &random, const vector<Vertex*> &zones) {
+	auto start = chrono::steady_clock::now();
+	CompactGraph compact(g);
+	cout << "Evacuations to the same zones (snapshot built in " << fixed << setprecision(2)
+			<< elapsedMicroseconds(start) / 1000 << " ms):" << endl;
+	cout << setw(6) << "region" << setw(10) << "max flow" << setw(10) << "(ms)" << setw(10) << "flow"
+			<< setw(14) << "cost (veh h)" << setw(8) << "routes" << setw(14) << "slowest (min)" << setw(10) << "(ms)" << endl;
+
+	vector<Vertex*> vertices = g->getVertexSet();
+	for (int r = 1; r <= options.regions; ++r) {
+		Vertex *center = vertices[random() % vertices.size()];
+		vector<Vertex*> region = g->findNearestVertices(center->getX(), center->getY(), options.region);
+
+		start = chrono::steady_clock::now();
+		int maxFlow = maxEvacuationFlow(compact, region, zones);
+		double flowTime = elapsedMicroseconds(start);
+
+		start = chrono::steady_clock::now();
+		EvacuationPlan plan = planEvacuation(compact, region, zones, options.vehicles);
+		double planTime = elapsedMicroseconds(start);
+
+		cout << setw(6) << r << setw(10) << maxFlow << setw(10) << flowTime / 1000 << setw(10) << plan.flow
+				<< setw(14) << plan.cost << setw(8) << plan.routes.size()
+				<< setw(14) << (plan.routes.empty() ? 0 : plan.routes.back().time * 60) << setw(10) << planTime / 1000 << endl;
+	}
+	cout << defaultfloat << setprecision(6);
+}
+
+static void reportMap(const string &name, const Options &options) {
+	Graph *g = nullptr;
+	MetaData meta;
+	if (loadMap(options.resource + name, g, meta, false, false) != 0) {
+		cerr << "Failed to load map " << name << endl;
+		delete g;
+		return;
+	}
+	g->buildSpatialIndex();
+
+	cout << endl << name << ": " << g->getNumVertices() << " vertices, costs in "
+			<< (options.metric == DISTANCE ? "meters" : "hours") << endl;
+
+	mt19937 random(options.seed);
+	vector<Vertex*> zones;
+	reportSafeZones(g, options, random, zones);
+	reportEvacuations(g, options, random, zones);
+
+	delete g;
+}
+
+
+
+//////////
+// Main //
+//////////
+
+static vector<string> splitList(const string &list) {
+	vector<string> items;
+	stringstream stream(list);
+	string item;
+	while (getline(stream, item, ',')) {
+		if (!item.empty()) items.push_back(item);
+	}
+	return items;
+}
+
+static string directory(string path) {
+	if (!path.empty() && path.back() != '/' && path.back() != '\\') path += '/';
+	return path;
+}
+
+static int parseOptions(int argc, char *argv[], Options &options) {
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (i + 1 >= argc) {
+			cerr << "Missing value for " << arg << endl;
+			return -1;
+		}
+		string value = argv[++i];
+
+		try {
+			if (arg == "--maps") options.maps = splitList(value);
+			else if (arg == "--zones") options.zones = stoi(value);
+			else if (arg == "--rounds") options.rounds = stoi(value);
+			else if (arg == "--area") options.area = stoi(value);
+			else if (arg == "--metric" && (value == "distance" || value == "time"))
+				options.metric = value == "distance" ? DISTANCE : TRAVEL_TIME;
+			else if (arg == "--regions") options.regions = stoi(value);
+			else if (arg == "--region") options.region = stoi(value);
+			else if (arg == "--vehicles") options.vehicles = stoi(value);
+			else if (arg == "--seed") options.seed = stoul(value);
+			else if (arg == "--resource") options.resource = directory(value);
+			else {
+				cerr << "Unknown option " << arg << " " << value << endl;
+				return -1;
+			}
+		} catch (exception &e) {
+			cerr << "Invalid value " << value << " for " << arg << endl;
+			return -1;
+		}
+	}
+	return options.zones > 0 && options.area > 0 && options.region > 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+	Options options;
+	if (parseOptions(argc, argv, options) != 0) {
+		cerr << "Usage: " << argv[0] << " [--maps a,b,...] [--zones N] [--rounds N] [--area N]"
+			" [--metric distance|time] [--regions N] [--region N] [--vehicles N] [--seed S] [--resource DIR]" << endl;
+		return 1;
+	}
+
+	for (const string &name : options.maps)
+		reportMap(name, options);
+
+	return 0;
+}
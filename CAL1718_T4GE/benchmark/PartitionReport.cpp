@@ -0,0 +1,202 @@
+/*
+ * Graph partitioning report.
+ *
+ * Loads each map (without a GraphViewer window), partitions it with
+ * recursive coordinate bisection and with inertial flow, and reports
+ * the cut statistics of every level: cells, cut edges, boundary
+ * vertices, cell sizes, imbalance and partitioning time.
+ * Optionally writes the cell assignments and boundary vertex sets.
+ *
+ * Kept outside src/ so it does not clash with the application's main().
+ * Build from the project root with:
+ *   g++ -std=gnu++14 -O2 -Isrc -IGraphViewer/cpp benchmark/PartitionReport.cpp \
+ *       $(find src GraphViewer/cpp -name '*.cpp' ! -name main.cpp) \
+ *       -o partition_report -lpthread          (add -lws2_32 on Windows)
+ *
+ * Usage:
+ *   partition_report [--maps fep,porto,...] [--cells 64,1024]
+ *                    [--resource DIR] [--output DIR]
+ *
+ * With --output, for each map and partitioner writes:
+ *   <map>_<partitioner>_cells.txt     "vertexID cell0 cell1 ..." per vertex
+ *   <map>_<partitioner>_boundary.txt  "level cell vertexID..." per cell
+ */
+#include "LoadMap.h"
+#include "Graph.h"
+#include "Benchmark.h"
+#include "Partition.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <algorithm>
+
+using namespace std;
+
+static const vector<string> default_maps = {
+	"fep", "newyork", "madrid", "vilareal", "graciosa", "bignewyork",
+	"faro", "coimbra", "porto", "sydney", "tokyo", "paris"
+};
+
+struct Options {
+	vector<string> maps = default_maps;
+	vector<int> cellSizes = {64, 1024};
+	string resource = "./resource/";
+	string output = "";
+};
+
+struct Partitioner {
+	string name;
+	function<Partition(const CompactGraph&, const vector<int>&)> run;
+};
+
+static const vector<Partitioner> partitioners = {
+	{"bisection", [](const CompactGraph &g, const vector<int> &sizes) { return bisectByCoordinates(g, sizes); }},
+	{"inertial_flow", [](const CompactGraph &g, const vector<int> &sizes) { return inertialFlow(g, sizes); }}
+};
+
+
+
+////////////
+// Output //
+////////////
+
+static bool writeCells(const string &filename, const CompactGraph &compact, const Partition &partition) {
+	ofstream file(filename);
+	if (!file.is_open()) return false;
+
+	for (int v = 0; v < compact.getNumVertices(); ++v) {
+		file << compact.getVertex(v)->getID();
+		for (int l = 0; l < partition.getNumLevels(); ++l)
+			file << ' ' << partition.cells[l][v];
+		file << '\n';
+	}
+	return true;
+}
+
+static bool writeBoundaries(const string &filename, const CompactGraph &compact, const Partition &partition) {
+	ofstream file(filename);
+	if (!file.is_open()) return false;
+
+	for (int l = 0; l < partition.getNumLevels(); ++l) {
+		vector<vector<int>> boundary = boundaryVertices(compact, partition, l);
+		for (size_t cell = 0; cell < boundary.size(); ++cell) {
+			file << l << ' ' << cell;
+			for (int v : boundary[cell])
+				file << ' ' << compact.getVertex(v)->getID();
+			file << '\n';
+		}
+	}
+	return true;
+}
+
+
+
+////////////
+// Report //
+////////////
+
+static void reportMap(const string &name, const Options &options) {
+	Graph *g = nullptr;
+	MetaData meta;
+	if (loadMap(options.resource + name, g, meta, false, false) != 0) {
+		cerr << "Failed to load map " << name << endl;
+		delete g;
+		return;
+	}
+
+	CompactGraph compact(g);
+	cout << endl << name << ": " << compact.getNumVertices() << " vertices, "
+			<< compact.getNumEdges() << " edges" << endl;
+	cout << left << setw(15) << "partitioner" << right << setw(6) << "level" << setw(7) << "cells"
+			<< setw(10) << "cut" << setw(10) << "boundary" << setw(9) << "min" << setw(9) << "max"
+			<< setw(11) << "imbalance" << setw(12) << "time (ms)" << endl;
+
+	for (const Partitioner &partitioner : partitioners) {
+		auto start = chrono::steady_clock::now();
+		Partition partition = partitioner.run(compact, options.cellSizes);
+		double ms = elapsedMicroseconds(start) / 1000.0;
+
+		for (int l = 0; l < partition.getNumLevels(); ++l) {
+			CutStats stats = cutStatistics(compact, partition, l);
+			cout << left << setw(15) << partitioner.name << right << setw(6) << l << setw(7) << stats.cells
+					<< setw(10) << stats.cutEdges << setw(10) << stats.boundaryVertices
+					<< setw(9) << stats.minCell << setw(9) << stats.maxCell
+					<< setw(10) << fixed << setprecision(1) << stats.imbalance * 100 << '%';
+			if (l == 0) cout << setw(12) << setprecision(1) << ms;
+			cout << endl;
+		}
+
+		if (options.output.empty()) continue;
+		string prefix = options.output + name + "_" + partitioner.name;
+		if (!writeCells(prefix + "_cells.txt", compact, partition)
+				|| !writeBoundaries(prefix + "_boundary.txt", compact, partition)) {
+			cerr << "Could not write " << prefix << "_*.txt" << endl;
+		}
+	}
+
+	delete g;
+}
+
+
+
+//////////
+// Main //
+//////////
+
+static vector<string> splitList(const string &list) {
+	vector<string> items;
+	stringstream stream(list);
+	string item;
+	while (getline(stream, item, ',')) {
+		if (!item.empty()) items.push_back(item);
+	}
+	return items;
+}
+
+static string directory(string path) {
+	if (!path.empty() && path.back() != '/' && path.back() != '\\') path += '/';
+	return path;
+}
+
+static int parseOptions(int argc, char *argv[], Options &options) {
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (i + 1 >= argc) {
+			cerr << "Missing value for " << arg << endl;
+			return -1;
+		}
+		string value = argv[++i];
+
+		if (arg == "--maps") options.maps = splitList(value);
+		else if (arg == "--cells") {
+			options.cellSizes.clear();
+			for (const string &size : splitList(value))
+				options.cellSizes.push_back(stoi(size));
+			sort(options.cellSizes.begin(), options.cellSizes.end());
+		}
+		else if (arg == "--resource") options.resource = directory(value);
+		else if (arg == "--output") options.output = directory(value);
+		else {
+			cerr << "Unknown option " << arg << endl;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	Options options;
+	if (parseOptions(argc, argv, options) != 0) {
+		cerr << "Usage: " << argv[0] << " [--maps a,b,...] [--cells 64,1024]"
+			" [--resource DIR] [--output DIR]" << endl;
+		return 1;
+	}
+
+	for (const string &name : options.maps)
+		reportMap(name, options);
+
+	return 0;
+}
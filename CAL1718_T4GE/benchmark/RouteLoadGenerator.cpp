@@ -0,0 +1,247 @@
+/*
+ * Load generator for the routing server (see src/RouteServer.h).
+ *
+ * Opens several connections to a running server, keeps a fixed number
+ * of ROUTE requests in flight on each (pipelining) and measures the
+ * latency of every request, from send to response. Prints latency
+ * percentiles and the achieved throughput.
+ *
+ * Start the server with, for example:
+ *   CAL1718_T4GE --map porto --serve 7000 --threads 8
+ * Build from the project root with (Linux):
+ *   g++ -std=gnu++14 -O2 -Isrc -IGraphViewer/cpp benchmark/RouteLoadGenerator.cpp src/Benchmark.cpp \
+ *       -o route_load_generator -lpthread
+ *
+ * Usage:
+ *   route_load_generator [--port P] [--connections C] [--requests N]
+ *                        [--pipeline D] [--algo astar|dijkstra]
+ *                        [--metric distance|time] [--seed S]
+ */
+#include "Benchmark.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <random>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct Options {
+	int port = 7000;
+	int connections = 8;
+	int requests = 20000;    // In total, over all connections
+	int pipeline = 4;        // Requests in flight per connection
+	string algo = "astar";
+	string metric = "distance";
+	unsigned seed = 2018;
+};
+
+struct ConnectionResult {
+	vector<double> latencies;
+	int errors = 0;
+	int unknown = 0;         // Requests naming a vertex ID the server does not have
+	bool failed = false;
+};
+
+
+
+////////////////
+// Connection //
+////////////////
+
+/*
+ * Blocking line-based connection to the server
+ */
+class LineSocket {
+	int fd = -1;
+	string buffer;
+
+public:
+	bool open(int port) {
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) return false;
+		int yes = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(port);
+		return connect(fd, (sockaddr*)&address, sizeof(address)) == 0;
+	}
+
+	bool send(const string &text) {
+		size_t sent = 0;
+		while (sent < text.size()) {
+			ssize_t n = ::send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+			if (n <= 0) return false;
+			sent += n;
+		}
+		return true;
+	}
+
+	bool readLine(string &line) {
+		size_t end;
+		while ((end = buffer.find('\n')) == string::npos) {
+			char chunk[65536];
+			ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+			if (n <= 0) return false;
+			buffer.append(chunk, n);
+		}
+		line = buffer.substr(0, end);
+		buffer.erase(0, end + 1);
+		return true;
+	}
+
+	~LineSocket() {
+		if (fd >= 0) close(fd);
+	}
+};
+
+
+
+//////////
+// Load //
+//////////
+
+/*
+ * @brief Sends count ROUTE requests over one connection,
+ * keeping up to depth of them in flight
+ */
+static void runConnection(const Options &options, int vertices, int count, unsigned seed, ConnectionResult &result) {
+	LineSocket socket;
+	if (!socket.open(options.port)) {
+		result.failed = true;
+		return;
+	}
+
+	mt19937 rng(seed);
+	uniform_int_distribution<int> pick(0, vertices - 1);
+	deque<chrono::steady_clock::time_point> inFlight;
+	result.latencies.reserve(count);
+
+	int sent = 0;
+	string line;
+	while ((int)result.latencies.size() < count) {
+		// Top up the pipeline in a single write
+		string batch;
+		while (sent < count && (int)inFlight.size() < options.pipeline) {
+			ostringstream request;
+			request << "ROUTE " << pick(rng) << ' ' << pick(rng) << ' ' << options.algo << ' ' << options.metric << '\n';
+			batch += request.str();
+			inFlight.push_back(chrono::steady_clock::now());
+			++sent;
+		}
+		if (!batch.empty() && !socket.send(batch)) {
+			result.failed = true;
+			return;
+		}
+
+		if (!socket.readLine(line)) {
+			result.failed = true;
+			return;
+		}
+		result.latencies.push_back(elapsedMicroseconds(inFlight.front()));
+		inFlight.pop_front();
+		if (line == "ERR unknown vertex") ++result.unknown;
+		else if (line.compare(0, 2, "OK") != 0 && line != "ERR unreachable") ++result.errors;
+	}
+
+	socket.send("QUIT\n");
+	socket.readLine(line);
+}
+
+/*
+ * @brief Asks the server for its number of vertices
+ * @return The number of vertices, -1 if the server is unavailable
+ */
+static int queryVertices(int port) {
+	LineSocket socket;
+	string line, word;
+	int vertices = -1;
+	if (!socket.open(port) || !socket.send("INFO\nQUIT\n") || !socket.readLine(line)) return -1;
+
+	istringstream ss(line);
+	while (ss >> word) {
+		if (word == "vertices") ss >> vertices;
+	}
+	return vertices;
+}
+
+static int parseOptions(int argc, char *argv[], Options &options) {
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (i + 1 >= argc) return -1;
+		string value = argv[++i];
+
+		try {
+			if (arg == "--port") options.port = stoi(value);
+			else if (arg == "--connections") options.connections = stoi(value);
+			else if (arg == "--requests") options.requests = stoi(value);
+			else if (arg == "--pipeline") options.pipeline = stoi(value);
+			else if (arg == "--algo") options.algo = value;
+			else if (arg == "--metric") options.metric = value;
+			else if (arg == "--seed") options.seed = (unsigned)stoul(value);
+			else return -1;
+		} catch (exception &e) {
+			return -1;
+		}
+	}
+	return options.connections > 0 && options.requests > 0 && options.pipeline > 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+	Options options;
+	if (parseOptions(argc, argv, options) != 0) {
+		cerr << "Usage: " << argv[0] << " [--port P] [--connections C] [--requests N] [--pipeline D]"
+			" [--algo astar|dijkstra] [--metric distance|time] [--seed S]" << endl;
+		return 1;
+	}
+
+	int vertices = queryVertices(options.port);
+	if (vertices <= 0) {
+		cerr << "No routing server on port " << options.port << endl;
+		return 1;
+	}
+
+	vector<ConnectionResult> results(options.connections);
+	vector<thread> threads;
+
+	auto start = chrono::steady_clock::now();
+	for (int c = 0; c < options.connections; ++c) {
+		int count = options.requests / options.connections + (c < options.requests % options.connections);
+		threads.emplace_back(runConnection, cref(options), vertices, count, options.seed + c, ref(results[c]));
+	}
+	for (auto &t : threads)
+		t.join();
+	double elapsed = elapsedMicroseconds(start);
+
+	vector<double> latencies;
+	int errors = 0, unknown = 0, failed = 0;
+	for (auto &result : results) {
+		latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+		errors += result.errors;
+		unknown += result.unknown;
+		failed += result.failed;
+	}
+
+	LatencySummary summary = summarizeLatencies(latencies);
+
+	cout << "Connections: " << options.connections << " (" << failed << " failed), pipeline depth " << options.pipeline << endl;
+	cout << "Requests: " << summary.samples << " (" << errors << " errors, " << unknown << " unknown vertices) in "
+		<< elapsed / 1e6 << " seconds" << endl;
+	cout << "Throughput: " << (elapsed > 0 ? summary.samples / (elapsed / 1e6) : 0) << " requests/second" << endl;
+	cout << "Latency (us): mean " << summary.mean << ", p50 " << summary.p50 << ", p95 " << summary.p95
+		<< ", p99 " << summary.p99 << ", max " << summary.max << endl;
+
+	return failed > 0 ? 1 : 0;
+}
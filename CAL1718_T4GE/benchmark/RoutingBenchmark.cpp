@@ -0,0 +1,439 @@
+/*
+ * Standalone routing benchmark.
+ *
+ * Loads each map (without a GraphViewer window), samples random reachable
+ * origin/destination pairs and times every routing algorithm over them,
+ * reporting latency percentiles, search effort and throughput.
+ * The same queries are run with the vertices laid out in memory in each
+ * of the given orders, also reporting cache misses where available.
+ * Results can be written as CSV and JSON for regression tracking.
+ *
+ * Kept outside src/ so it does not clash with the application's main().
+ * Build from the project root with:
+ *   g++ -std=gnu++14 -O2 -Isrc -IGraphViewer/cpp benchmark/RoutingBenchmark.cpp \
+ *       $(find src GraphViewer/cpp -name '*.cpp' ! -name main.cpp) \
+ *       -o routing_benchmark -lpthread          (add -lws2_32 on Windows)
+ *
+ * Usage:
+ *   routing_benchmark [--maps fep,porto,...] [--queries N] [--warmup N]
+ *                     [--orders id,bfs,hilbert] [--seed S] [--resource DIR]
+ *                     [--csv FILE] [--json FILE]
+ */
+#include "LoadMap.h"
+#include "Graph.h"
+#include "Benchmark.h"
+#include "Overlay.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <random>
+#include <map>
+
+using namespace std;
+
+static const vector<string> default_maps = {
+	"fep", "newyork", "madrid", "vilareal", "graciosa", "bignewyork",
+	"faro", "coimbra", "porto", "sydney", "tokyo", "paris"
+};
+
+static const map<string, VertexOrder> order_names = {
+	{"id", ID_ORDER}, {"bfs", BFS_ORDER}, {"hilbert", HILBERT_ORDER}
+};
+
+struct Options {
+	vector<string> maps = default_maps;
+	vector<string> orders = {"id", "bfs", "hilbert"};
+	string resource = "./resource/";
+	int queries = 1000;
+	int warmup = 100;
+	unsigned seed = 2018;
+	string csv = "";
+	string json = "";
+};
+
+struct Query {
+	Vertex *origin, *destination;
+};
+
+// Queries by vertex ID, valid in any order of the vertices
+struct QueryIds {
+	int origin, destination;
+};
+
+struct Result {
+	string map;
+	string order;
+	string algorithm;
+	int vertices, edges;
+	LatencySummary latency;
+	double settled, relaxed, decreaseKeys, maxHeapSize; // Means per query
+	double cacheMisses;                                 // Mean per query, -1 if unavailable
+};
+
+struct Algorithm {
+	string name;
+	function<void(Graph*, const Query&, SearchStats*)> run;
+};
+
+static const vector<Algorithm> algorithms = {
+	{"gbfs", [](Graph *g, const Query &q, SearchStats *s) { g->gbfsDist(q.origin, q.destination, nullptr, s); }},
+	{"dijkstra_late_exit", [](Graph *g, const Query &q, SearchStats *s) { g->dijkstraDist(q.origin, nullptr, s); }},
+	{"dijkstra_early_exit", [](Graph *g, const Query &q, SearchStats *s) { g->dijkstraDist(q.origin, q.destination, nullptr, s); }},
+	{"astar", [](Graph *g, const Query &q, SearchStats *s) { g->AstarDist(q.origin, q.destination, nullptr, s); }},
+	{"dijkstra_simulation", [](Graph *g, const Query &q, SearchStats *s) { g->dijkstraSimulation(q.origin, q.destination, nullptr, s); }}
+};
+
+
+
+////////////////////
+// Query Sampling //
+////////////////////
+
+/*
+ * @brief Samples count origin/destination pairs such that
+ * the destination is reachable from the origin
+ */
+static vector<QueryIds> sampleQueries(Graph *g, int count, mt19937 &rng) {
+	vector<QueryIds> queries;
+	vector<Vertex*> vertices = g->getVertexSet();
+	if (vertices.size() < 2) return queries;
+
+	uniform_int_distribution<size_t> pick(0, vertices.size() - 1);
+
+	int attempts = 0;
+	while ((int)queries.size() < count && attempts < 50 * count) {
+		++attempts;
+		Vertex *origin = vertices[pick(rng)];
+		if (origin->isAccidented()) continue;
+
+		g->bfs(origin);
+		vector<Vertex*> reachable;
+		for (auto v : vertices) {
+			if (v != origin && v->getPath() != nullptr) reachable.push_back(v);
+		}
+		if (reachable.empty()) continue;
+
+		uniform_int_distribution<size_t> pickDest(0, reachable.size() - 1);
+		queries.push_back({origin->getID(), reachable[pickDest(rng)]->getID()});
+	}
+
+	return queries;
+}
+
+static vector<Query> findQueries(Graph *g, const vector<QueryIds> &ids) {
+	vector<Query> queries;
+	for (const QueryIds &q : ids)
+		queries.push_back({g->getVertex(q.origin), g->getVertex(q.destination)});
+	return queries;
+}
+
+
+
+
+///////////////
+// Benchmark //
+///////////////
+
+static vector<Result> benchmarkOrder(const string &name, const string &order, const vector<QueryIds> &warmupIds,
+		const vector<QueryIds> &queryIds, const Options &options) {
+	vector<Result> results;
+
+	Graph *g = nullptr;
+	MetaData meta;
+	if (loadMap(options.resource + name, g, meta, false, false, order_names.at(order)) != 0) {
+		cerr << "Failed to load map " << name << endl;
+		delete g;
+		return results;
+	}
+
+	vector<Query> warmup = findQueries(g, warmupIds);
+	vector<Query> queries = findQueries(g, queryIds);
+	CacheMissCounter counter;
+
+	for (const Algorithm &algorithm : algorithms) {
+		for (const Query &q : warmup) algorithm.run(g, q, nullptr);
+
+		vector<double> samples;
+		samples.reserve(queries.size());
+		SearchStats total;
+		long long misses = 0;
+
+		for (const Query &q : queries) {
+			SearchStats stats;
+			counter.start();
+			auto start = chrono::steady_clock::now();
+			algorithm.run(g, q, &stats);
+			samples.push_back(elapsedMicroseconds(start));
+			misses += counter.stop();
+			total.settled += stats.settled;
+			total.relaxed += stats.relaxed;
+			total.decreaseKeys += stats.decreaseKeys;
+			total.maxHeapSize += stats.maxHeapSize;
+		}
+
+		Result result;
+		result.map = name;
+		result.order = order;
+		result.algorithm = algorithm.name;
+		result.vertices = g->getNumVertices();
+		result.edges = (int)g->getSubRoadsInfo().size();
+		result.latency = summarizeLatencies(samples);
+		result.settled = (double)total.settled / queries.size();
+		result.relaxed = (double)total.relaxed / queries.size();
+		result.decreaseKeys = (double)total.decreaseKeys / queries.size();
+		result.maxHeapSize = (double)total.maxHeapSize / queries.size();
+		result.cacheMisses = counter.isAvailable() ? (double)misses / queries.size() : -1;
+		results.push_back(result);
+	}
+
+	// Multi-level overlay: repeated customizations, then queries by travel time
+	{
+		OverlayGraph overlay(g);
+		const CompactGraph &compact = overlay.getCompactGraph();
+
+		vector<double> customizations;
+		for (int i = 0; i < 10; ++i) {
+			auto start = chrono::steady_clock::now();
+			overlay.customize();
+			customizations.push_back(elapsedMicroseconds(start));
+		}
+
+		Result customize;
+		customize.map = name;
+		customize.order = order;
+		customize.algorithm = "overlay_customize";
+		customize.vertices = g->getNumVertices();
+		customize.edges = (int)g->getSubRoadsInfo().size();
+		customize.latency = summarizeLatencies(customizations);
+		customize.settled = customize.relaxed = customize.decreaseKeys = customize.maxHeapSize = 0;
+		customize.cacheMisses = -1;
+		results.push_back(customize);
+
+		SearchWorkspace workspace;
+		vector<int> path;
+		for (const Query &q : warmup)
+			overlay.route(compact.getIndex(q.origin), compact.getIndex(q.destination), path, workspace);
+
+		vector<double> samples;
+		SearchStats total;
+		long long misses = 0;
+		for (const Query &q : queries) {
+			SearchStats stats;
+			int origin = compact.getIndex(q.origin), destination = compact.getIndex(q.destination);
+			counter.start();
+			auto start = chrono::steady_clock::now();
+			overlay.route(origin, destination, path, workspace, &stats);
+			samples.push_back(elapsedMicroseconds(start));
+			misses += counter.stop();
+			total.settled += stats.settled;
+			total.relaxed += stats.relaxed;
+			total.decreaseKeys += stats.decreaseKeys;
+			total.maxHeapSize += stats.maxHeapSize;
+		}
+
+		Result result = customize;
+		result.algorithm = "overlay_query";
+		result.latency = summarizeLatencies(samples);
+		result.settled = (double)total.settled / queries.size();
+		result.relaxed = (double)total.relaxed / queries.size();
+		result.decreaseKeys = (double)total.decreaseKeys / queries.size();
+		result.maxHeapSize = (double)total.maxHeapSize / queries.size();
+		result.cacheMisses = counter.isAvailable() ? (double)misses / queries.size() : -1;
+		results.push_back(result);
+	}
+
+	delete g;
+	return results;
+}
+
+static vector<Result> benchmarkMap(const string &name, const Options &options, mt19937 &rng) {
+	vector<Result> results;
+
+	Graph *g = nullptr;
+	MetaData meta;
+	if (loadMap(options.resource + name, g, meta, false, false, ID_ORDER) != 0) {
+		cerr << "Failed to load map " << name << endl;
+		delete g;
+		return results;
+	}
+
+	// Warmup and measured queries are sampled independently
+	vector<QueryIds> warmup = sampleQueries(g, options.warmup, rng);
+	vector<QueryIds> queries = sampleQueries(g, options.queries, rng);
+	delete g;
+	if (queries.empty()) {
+		cerr << "No reachable queries in map " << name << endl;
+		return results;
+	}
+
+	// Same queries, with the vertices in each order
+	for (const string &order : options.orders) {
+		vector<Result> orderResults = benchmarkOrder(name, order, warmup, queries, options);
+		results.insert(results.end(), orderResults.begin(), orderResults.end());
+	}
+	return results;
+}
+
+
+
+////////////
+// Output //
+////////////
+
+static void printResults(const vector<Result> &results) {
+	cout << endl;
+	cout << "MAP          ORDER    ALGORITHM              QUERIES     P50(us)     P95(us)     P99(us)    MEAN(us)     MAX(us)     SETTLED     RELAXED     QUERY/S    MISSES/Q" << endl;
+	for (const Result &r : results) {
+		ostringstream line;
+		line.setf(ios::fixed);
+		line.precision(1);
+		line.width(13); line << left << r.map;
+		line.width(9); line << left << r.order;
+		line.width(21); line << left << r.algorithm;
+		line << right;
+		line.width(10); line << r.latency.samples;
+		line.width(12); line << r.latency.p50;
+		line.width(12); line << r.latency.p95;
+		line.width(12); line << r.latency.p99;
+		line.width(12); line << r.latency.mean;
+		line.width(12); line << r.latency.max;
+		line.width(12); line << r.settled;
+		line.width(12); line << r.relaxed;
+		line.width(12); line << r.latency.throughput();
+		line.width(12);
+		if (r.cacheMisses >= 0) line << r.cacheMisses;
+		else line << "n/a";
+		cout << line.str() << endl;
+	}
+}
+
+static bool writeCSV(const string &filename, const vector<Result> &results) {
+	ofstream file(filename);
+	if (!file.is_open()) return false;
+
+	file << "map,order,algorithm,vertices,edges,queries,p50_us,p95_us,p99_us,mean_us,stddev_us,min_us,max_us,settled,relaxed,decrease_keys,max_heap,throughput_qps,cache_misses" << endl;
+	for (const Result &r : results) {
+		file << r.map << ',' << r.order << ',' << r.algorithm << ',' << r.vertices << ',' << r.edges << ','
+			<< r.latency.samples << ',' << r.latency.p50 << ',' << r.latency.p95 << ','
+			<< r.latency.p99 << ',' << r.latency.mean << ',' << r.latency.stddev << ','
+			<< r.latency.min << ',' << r.latency.max << ',' << r.settled << ','
+			<< r.relaxed << ',' << r.decreaseKeys << ',' << r.maxHeapSize << ','
+			<< r.latency.throughput() << ',' << r.cacheMisses << endl;
+	}
+	return true;
+}
+
+static bool writeJSON(const string &filename, const vector<Result> &results, const Options &options) {
+	ofstream file(filename);
+	if (!file.is_open()) return false;
+
+	file << "{" << endl;
+	file << "  \"seed\": " << options.seed << "," << endl;
+	file << "  \"queries\": " << options.queries << "," << endl;
+	file << "  \"warmup\": " << options.warmup << "," << endl;
+	file << "  \"results\": [" << endl;
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result &r = results[i];
+		file << "    {\"map\": \"" << r.map << "\", \"order\": \"" << r.order << "\""
+			<< ", \"algorithm\": \"" << r.algorithm << "\""
+			<< ", \"vertices\": " << r.vertices << ", \"edges\": " << r.edges
+			<< ", \"queries\": " << r.latency.samples
+			<< ", \"p50_us\": " << r.latency.p50 << ", \"p95_us\": " << r.latency.p95
+			<< ", \"p99_us\": " << r.latency.p99 << ", \"mean_us\": " << r.latency.mean
+			<< ", \"stddev_us\": " << r.latency.stddev << ", \"min_us\": " << r.latency.min
+			<< ", \"max_us\": " << r.latency.max << ", \"settled\": " << r.settled
+			<< ", \"relaxed\": " << r.relaxed << ", \"decrease_keys\": " << r.decreaseKeys
+			<< ", \"max_heap\": " << r.maxHeapSize
+			<< ", \"throughput_qps\": " << r.latency.throughput()
+			<< ", \"cache_misses\": " << r.cacheMisses << "}"
+			<< (i + 1 < results.size() ? "," : "") << endl;
+	}
+	file << "  ]" << endl;
+	file << "}" << endl;
+	return true;
+}
+
+
+
+//////////
+// Main //
+//////////
+
+static vector<string> splitList(const string &list) {
+	vector<string> items;
+	stringstream stream(list);
+	string item;
+	while (getline(stream, item, ',')) {
+		if (!item.empty()) items.push_back(item);
+	}
+	return items;
+}
+
+static int parseOptions(int argc, char *argv[], Options &options) {
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (i + 1 >= argc) {
+			cerr << "Missing value for " << arg << endl;
+			return -1;
+		}
+		string value = argv[++i];
+
+		if (arg == "--maps") options.maps = splitList(value);
+		else if (arg == "--queries") options.queries = stoi(value);
+		else if (arg == "--warmup") options.warmup = stoi(value);
+		else if (arg == "--orders") options.orders = splitList(value);
+		else if (arg == "--seed") options.seed = (unsigned)stoul(value);
+		else if (arg == "--resource") options.resource = value;
+		else if (arg == "--csv") options.csv = value;
+		else if (arg == "--json") options.json = value;
+		else {
+			cerr << "Unknown option " << arg << endl;
+			return -1;
+		}
+	}
+
+	for (const string &order : options.orders) {
+		if (order_names.count(order) == 0) {
+			cerr << "Unknown order " << order << endl;
+			return -1;
+		}
+	}
+
+	if (!options.resource.empty() && options.resource.back() != '/' && options.resource.back() != '\\') {
+		options.resource += '/';
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	Options options;
+	if (parseOptions(argc, argv, options) != 0) {
+		cerr << "Usage: " << argv[0] << " [--maps a,b,...] [--queries N] [--warmup N]"
+			" [--orders id,bfs,hilbert] [--seed S] [--resource DIR] [--csv FILE] [--json FILE]" << endl;
+		return 1;
+	}
+
+	mt19937 rng(options.seed);
+	vector<Result> results;
+
+	for (const string &name : options.maps) {
+		cout << "Benchmarking " << name << "..." << endl;
+		vector<Result> mapResults = benchmarkMap(name, options, rng);
+		results.insert(results.end(), mapResults.begin(), mapResults.end());
+	}
+
+	printResults(results);
+
+	if (!options.csv.empty() && !writeCSV(options.csv, results)) {
+		cerr << "Could not write " << options.csv << endl;
+		return 1;
+	}
+	if (!options.json.empty() && !writeJSON(options.json, results, options)) {
+		cerr << "Could not write " << options.json << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,176 @@
+#include "Assignment.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <math.h>
+
+/*
+ * @brief (Private) Hours to cross subroad with load cars in it,
+ * following Subroad::calculateAverageSpeed
+ */
+static double travelTime(const Subroad *subroad, double load) {
+	return (subroad->getDistance() / 1000) / max(1, subroad->calculateAverageSpeed(load));
+}
+
+/*
+ * @brief User equilibrium of the demand over the clear part of graph,
+ * by the Frank-Wolfe algorithm: each iteration sends every trip along
+ * its shortest route at the current travel times (in parallel, one
+ * search per origin) and moves the loads towards that assignment by
+ * the step that best balances the travel times (a bisection line
+ * search of the Beckmann objective, or the successive averages step
+ * 1/(k+1) when the speed steps leave nothing to gain at once).
+ *
+ * Loads are kept per subroad (both directions of a road share one)
+ * and written to the graph with setActualCapacity, so that after the
+ * assignment the actual capacity of every clear subroad is the number
+ * of vehicles routed over it, up to its maximum.
+ * @param gap Relative gap to stop at (see AssignmentIteration::gap)
+ * @param threads Threads of the shortest path searches, 0 for one per
+ * hardware thread
+ * @param report If given, called after every iteration
+ */
+AssignmentResult assignTraffic(Graph *graph, const vector<TripDemand> &demand,
+		int maxIterations, double gap, int threads, function<void(const AssignmentIteration&)> report) {
+	static const double infinity = numeric_limits<double>::infinity();
+	auto start = chrono::steady_clock::now();
+	AssignmentResult result;
+	CompactGraph compact(graph);
+	if (threads <= 0) threads = defaultThreads();
+
+	// One link per subroad, with the first edge found on it
+	vector<Edge*> links;
+	unordered_map<const Subroad*, int> linkIndexes;
+	vector<int> linkOf(compact.getNumEdges());
+	for (int e = 0; e < compact.getNumEdges(); ++e) {
+		Edge *edge = compact.getEdge(e);
+		auto it = linkIndexes.find(edge->getSubroad());
+		if (it == linkIndexes.end()) {
+			it = linkIndexes.insert({edge->getSubroad(), links.size()}).first;
+			links.push_back(edge);
+		}
+		linkOf[e] = it->second;
+	}
+	int numLinks = links.size();
+
+	// Trips by origin
+	map<int, vector<pair<int, double>>> trips;
+	for (const TripDemand &trip : demand) {
+		int origin = compact.getIndex(trip.origin), destination = compact.getIndex(trip.destination);
+		if (origin < 0 || destination < 0) result.unassigned += trip.vehicles;
+		else trips[origin].push_back({destination, trip.vehicles});
+	}
+	vector<int> origins;
+	vector<vector<int>> destinations;
+	vector<vector<double>> vehicles;
+	for (auto &pair : trips) {
+		origins.push_back(pair.first);
+		destinations.emplace_back();
+		vehicles.emplace_back();
+		for (auto &trip : pair.second) {
+			destinations.back().push_back(trip.first);
+			vehicles.back().push_back(trip.second);
+		}
+	}
+
+	vector<SearchWorkspace> workspaces(threads);
+	vector<vector<double>> partialLoads(threads);
+	vector<double> partialCost(threads), partialLost(threads);
+	double lost = 0;
+
+	// All or nothing: every trip on its shortest route at the current
+	// travel times. Returns the vehicle hours of those routes.
+	const auto allOrNothing = [&](vector<double> &loads) {
+		for (int t = 0; t < threads; ++t) {
+			partialLoads[t].assign(numLinks, 0);
+			partialCost[t] = partialLost[t] = 0;
+		}
+		parallelFor(origins.size(), threads, [&](int i, int t) {
+			vector<double> costs;
+			vector<vector<int>> paths;
+			compact.oneToMany(origins[i], destinations[i], TRAVEL_TIME, costs, workspaces[t], &paths);
+			for (size_t j = 0; j < costs.size(); ++j) {
+				if (costs[j] == infinity) {
+					partialLost[t] += vehicles[i][j];
+					continue;
+				}
+				partialCost[t] += vehicles[i][j] * costs[j];
+				for (int e : paths[j])
+					partialLoads[t][linkOf[e]] += vehicles[i][j];
+			}
+		});
+
+		loads.assign(numLinks, 0);
+		double cost = 0;
+		lost = 0;
+		for (int t = 0; t < threads; ++t) {
+			for (int l = 0; l < numLinks; ++l)
+				loads[l] += partialLoads[t][l];
+			cost += partialCost[t];
+			lost += partialLost[t];
+		}
+		return cost;
+	};
+
+	// Writes the loads to the graph, and their travel times to the snapshot
+	const auto setLoads = [&](const vector<double> &loads) {
+		for (int l = 0; l < numLinks; ++l)
+			links[l]->setActualCapacity(min(links[l]->getMaxCapacity(), (int)lround(loads[l])));
+		compact.refreshCosts();
+	};
+
+	// Start from the free flow shortest routes
+	vector<double> loads(numLinks, 0), target;
+	setLoads(loads);
+	allOrNothing(loads);
+	result.unassigned += lost;
+
+	for (int k = 1; k <= maxIterations; ++k) {
+		setLoads(loads);
+		double shortest = allOrNothing(target);
+
+		AssignmentIteration iteration;
+		iteration.iteration = k;
+		for (int l = 0; l < numLinks; ++l)
+			iteration.totalTime += loads[l] * travelTime(links[l]->getSubroad(), links[l]->getActualCapacity());
+		iteration.gap = iteration.totalTime > 0 ? (iteration.totalTime - shortest) / iteration.totalTime : 0;
+
+		if (iteration.gap <= gap) {
+			result.converged = true;
+		} else {
+			// The objective's slope along the direction only grows with the step
+			const auto slope = [&](double step) {
+				double sum = 0;
+				for (int l = 0; l < numLinks; ++l) {
+					double direction = target[l] - loads[l];
+					if (direction != 0)
+						sum += direction * travelTime(links[l]->getSubroad(), loads[l] + step * direction);
+				}
+				return sum;
+			};
+			double low = 0, high = 1;
+			if (slope(1) <= 0) low = 1;
+			else {
+				for (int i = 0; i < ASSIGNMENT_LINE_SEARCH; ++i) {
+					double middle = (low + high) / 2;
+					(slope(middle) > 0 ? high : low) = middle;
+				}
+			}
+			// The speeds change in steps, which can leave the best step at
+			// zero: move by the successive averages step instead
+			iteration.step = low > 0 ? low : 1.0 / (k + 1);
+			for (int l = 0; l < numLinks; ++l)
+				loads[l] += iteration.step * (target[l] - loads[l]);
+		}
+
+		iteration.time = elapsedMicroseconds(start);
+		result.iterations.push_back(iteration);
+		if (report) report(iteration);
+		if (result.converged) break;
+	}
+
+	setLoads(loads);
+	return result;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Graph.h"
+#include "CompactGraph.h"
+
+#include <functional>
+
+using namespace std;
+
+// Traffic assignment: stop once the relative gap falls under
+// ASSIGNMENT_GAP, or after ASSIGNMENT_MAX_ITERATIONS
+#define ASSIGNMENT_GAP              1e-4
+#define ASSIGNMENT_MAX_ITERATIONS   50
+#define ASSIGNMENT_LINE_SEARCH      30 // Bisection steps of each line search
+
+/*
+ * Vehicles going from one vertex to another
+ */
+struct TripDemand {
+	Vertex *origin, *destination;
+	double vehicles;
+};
+
+/*
+ * State of the traffic assignment after one iteration
+ */
+struct AssignmentIteration {
+	int iteration = 0;
+	double gap = 0;            // Relative gap: share of the total travel time over that of the shortest routes
+	double totalTime = 0;      // Vehicle hours at the current loads
+	double step = 0;           // Share of the new routes taken by the next iteration
+	double time = 0;           // Microseconds spent so far
+};
+
+/*
+ * Result of a traffic assignment
+ */
+struct AssignmentResult {
+	vector<AssignmentIteration> iterations;
+	double unassigned = 0;     // Vehicles with no route to their destination
+	bool converged = false;
+};
+
+///// ***** Traffic assignment
+AssignmentResult assignTraffic(Graph *graph, const vector<TripDemand> &demand,
+		int maxIterations = ASSIGNMENT_MAX_ITERATIONS, double gap = ASSIGNMENT_GAP, int threads = 0,
+		function<void(const AssignmentIteration&)> report = nullptr);
+/////
@@ -0,0 +1,314 @@
+#include "BatchRouting.h"
+#include "RouteServer.h"
+#include "MapRegistry.h"
+
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <memory>
+
+static const string batch_usage =
+"Usage: --map NAME[,NAME...] [--queries FILE] [--output FILE] [--algo dijkstra|astar]\n"
+"       [--metric distance|time] [--threads N] [--chunk N] [--budget MB]\n"
+"Reads one \"[map] origin destination\" query of vertex IDs per line from\n"
+"FILE (or stdin) and writes one line per query:\n"
+"       [map] origin destination cost length hops microseconds id,id,...\n"
+"Queries without a map go to the first --map. Maps are loaded when first\n"
+"needed, the least recently used unloaded past --budget (see MapRegistry).\n"
+"Queries are answered in parallel, --chunk at a time (1 for no buffering).\n"
+"With --serve PORT, keeps the map loaded and answers requests on\n"
+"127.0.0.1:PORT instead, --threads workers (see RouteServer.h).\n";
+
+
+
+//////////////////////////
+/// Class QueryEngine ////
+//////////////////////////
+
+/*
+ * @brief Takes a snapshot of graph to answer queries with
+ * @param astar Whether to use A* instead of Dijkstra
+ * @param threads Worker threads, 0 for one per hardware thread
+ */
+QueryEngine::QueryEngine(const Graph *graph, Metric metric, bool astar, int threads) :
+		compact(graph), metric(metric), astar(astar), threads(threads) {
+	if (this->threads <= 0) this->threads = defaultThreads();
+	workspaces.resize(this->threads);
+
+	for (int i = 0; i < compact.getNumVertices(); ++i)
+		indexes[compact.getVertex(i)->getID()] = i;
+}
+
+int QueryEngine::getThreads() const {
+	return threads;
+}
+
+int QueryEngine::getNumVertices() const {
+	return compact.getNumVertices();
+}
+
+/*
+ * @brief Whether the snapshot has a vertex with the given ID
+ */
+bool QueryEngine::hasVertex(int id) const {
+	return indexes.count(id) > 0;
+}
+
+/*
+ * @brief Answers a single query
+ * @param thread Index of the calling worker, selects its workspace
+ */
+RouteAnswer QueryEngine::route(int origin, int destination, int thread) {
+	return route(origin, destination, metric, astar, thread);
+}
+
+/*
+ * @brief Same as above, with another metric or algorithm
+ * than the engine's own
+ */
+RouteAnswer QueryEngine::route(int origin, int destination, Metric metric, bool astar, int thread) {
+	RouteAnswer answer;
+	auto start = chrono::steady_clock::now();
+
+	auto o = indexes.find(origin), d = indexes.find(destination);
+	if (o != indexes.end() && d != indexes.end()) {
+		vector<int> path;
+		double cost = compact.route(o->second, d->second, metric, astar, path, workspaces[thread]);
+
+		if (cost != numeric_limits<double>::infinity()) {
+			answer.found = true;
+			answer.cost = cost;
+			for (size_t i = 0; i < path.size(); ++i) {
+				answer.path.push_back(compact.getVertex(path[i])->getID());
+				if (i == 0) continue;
+
+				// Cheapest edge between consecutive vertices, as chosen by the search
+				double length = numeric_limits<double>::infinity(), best = length;
+				for (int e = compact.getFirstEdge(path[i - 1]); e < compact.getLastEdge(path[i - 1]); ++e) {
+					if (compact.getTarget(e) == path[i] && compact.getCost(e, metric) < best) {
+						best = compact.getCost(e, metric);
+						length = compact.getCost(e, DISTANCE);
+					}
+				}
+				answer.length += length;
+			}
+		}
+	}
+
+	answer.time = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+	return answer;
+}
+
+/*
+ * @brief Answers all queries, spread over the engine's threads.
+ * Answers are in the same order as the queries.
+ */
+vector<RouteAnswer> QueryEngine::route(const vector<RouteQuery> &queries) {
+	vector<RouteAnswer> answers(queries.size());
+
+	parallelFor(queries.size(), threads, [&](int i, int thread) {
+		if (queries[i].error.empty())
+			answers[i] = route(queries[i].origin, queries[i].destination, thread);
+	});
+
+	return answers;
+}
+
+
+
+////////////////
+// Batch Mode //
+////////////////
+
+/*
+ * @brief Reads up to max queries from in, one "origin destination"
+ * pair per line, optionally preceded by the name of the map.
+ * Empty lines and lines starting with # are skipped.
+ * Malformed lines become queries with an error set.
+ * @return False once in is exhausted and nothing was read
+ */
+bool readQueries(istream &in, vector<RouteQuery> &queries, int max) {
+	queries.clear();
+	string line;
+
+	while ((int)queries.size() < max && getline(in, line)) {
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (line.find_first_not_of(" \t") == string::npos || line[line.find_first_not_of(" \t")] == '#')
+			continue;
+
+		RouteQuery query;
+		istringstream ss(line);
+		string first, rest;
+		ss >> first;
+		if (first.find_first_not_of("-0123456789") != string::npos) query.map = first;
+		else ss.seekg(0);
+
+		if (!(ss >> query.origin >> query.destination) || (ss >> rest)) {
+			query.origin = query.destination = -1;
+			query.error = "invalid query \"" + line + "\"";
+		}
+		queries.push_back(query);
+	}
+
+	return !queries.empty();
+}
+
+/*
+ * @brief Writes one answer line:
+ * [map] origin destination cost length hops microseconds id,id,...
+ * or origin destination unreachable, or # error: ...
+ */
+void writeAnswer(ostream &out, const RouteQuery &query, const RouteAnswer &answer) {
+	if (!query.error.empty()) {
+		out << "# error: " << query.error << '\n';
+		return;
+	}
+
+	if (!query.map.empty()) out << query.map << ' ';
+	out << query.origin << ' ' << query.destination << ' ';
+	if (!answer.found) {
+		out << "unreachable " << answer.time << '\n';
+		return;
+	}
+
+	out << answer.cost << ' ' << answer.length << ' ' << answer.path.size() - 1 << ' ' << answer.time << ' ';
+	for (size_t i = 0; i < answer.path.size(); ++i) {
+		if (i > 0) out << ',';
+		out << answer.path[i];
+	}
+	out << '\n';
+}
+
+/*
+ * @brief Non-interactive mode: loads maps without the viewer and
+ * answers the queries of a file (or stdin), see batch_usage.
+ * @return The program's exit code
+ */
+int batchMode(int argc, char* argv[]) {
+	string mapnames, queriesFile = "-", outputFile = "-";
+	string algo = "astar", metricName = "distance";
+	int threads = 0, chunk = BATCH_CHUNK_SIZE, serve = 0, budget = MAP_MEMORY_BUDGET >> 20;
+
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if (i + 1 >= argc) {
+			cerr << "Missing value for " << arg << endl << batch_usage;
+			return 1;
+		}
+		string value = argv[++i];
+
+		if (arg == "--map") mapnames = value;
+		else if (arg == "--queries") queriesFile = value;
+		else if (arg == "--output") outputFile = value;
+		else if (arg == "--algo") algo = value;
+		else if (arg == "--metric") metricName = value;
+		else if (arg == "--threads" || arg == "--chunk" || arg == "--serve" || arg == "--budget") {
+			try {
+				(arg == "--threads" ? threads : arg == "--chunk" ? chunk : arg == "--serve" ? serve : budget) = stoi(value);
+			} catch (exception &e) {
+				cerr << "Invalid number " << value << " for " << arg << endl;
+				return 1;
+			}
+		}
+		else {
+			cerr << "Unknown option " << arg << endl << batch_usage;
+			return 1;
+		}
+	}
+
+	vector<string> names;
+	istringstream list(mapnames);
+	for (string name; getline(list, name, ',');) {
+		if (!name.empty()) names.push_back(name);
+	}
+
+	if (names.empty() || chunk < 1 || budget < 1 || serve < 0 || serve > 65535 || (algo != "dijkstra" && algo != "astar")
+			|| (metricName != "distance" && metricName != "time")) {
+		cerr << batch_usage;
+		return 1;
+	}
+
+	Metric metric = metricName == "time" ? TRAVEL_TIME : DISTANCE;
+
+	// Engines of the loaded maps, dropped along with their map (so the registry goes first)
+	map<string, unique_ptr<QueryEngine>> engines;
+	MapRegistry maps(MAP_RESOURCE_PREFIX, (size_t)budget << 20, false);
+	maps.setUnloadHandler([&](const string &name, Graph*) { engines.erase(name); });
+
+	const auto load = [&](const string &name) -> Graph* {
+		// Map loading messages go to stderr, keeping stdout for the answers
+		streambuf *out = cout.rdbuf(cerr.rdbuf());
+		Graph *graph = maps.exists(name) ? maps.get(name) : nullptr;
+		cout.rdbuf(out);
+		if (graph == nullptr) cerr << "Could not load map " << name << endl;
+		return graph;
+	};
+
+	for (const string &name : names) {
+		if (load(name) == nullptr) return 1;
+	}
+
+	if (serve) {
+		RouteServer server(maps.get(names[0]), *maps.getMeta(names[0]), serve, threads);
+		int result = server.run();
+		return result == 0 ? 0 : 1;
+	}
+
+	ifstream queriesStream;
+	istream *in = &cin;
+	if (queriesFile != "-") {
+		queriesStream.open(queriesFile);
+		if (!queriesStream.is_open()) {
+			cerr << "Could not open " << queriesFile << endl;
+			return 1;
+		}
+		in = &queriesStream;
+	}
+
+	ofstream outputFileStream;
+	ostream *output = &cout;
+	if (outputFile != "-") {
+		outputFileStream.open(outputFile);
+		if (!outputFileStream.is_open()) {
+			cerr << "Could not open " << outputFile << endl;
+			return 1;
+		}
+		output = &outputFileStream;
+	}
+
+	// Stream the queries in chunks, answering the queries of each map in parallel
+	vector<RouteQuery> queries;
+	while (readQueries(*in, queries, chunk)) {
+		map<string, vector<int>> byMap;
+		for (size_t i = 0; i < queries.size(); ++i) {
+			if (queries[i].error.empty())
+				byMap[queries[i].map.empty() ? names[0] : queries[i].map].push_back(i);
+		}
+
+		vector<RouteAnswer> answers(queries.size());
+		for (auto &pair : byMap) {
+			Graph *graph = load(pair.first);
+			if (graph == nullptr) {
+				for (int i : pair.second)
+					queries[i].error = "unknown map " + pair.first;
+				continue;
+			}
+
+			unique_ptr<QueryEngine> &engine = engines[pair.first];
+			if (!engine) engine.reset(new QueryEngine(graph, metric, algo == "astar", threads));
+
+			vector<RouteQuery> mapQueries;
+			for (int i : pair.second)
+				mapQueries.push_back(queries[i]);
+			vector<RouteAnswer> mapAnswers = engine->route(mapQueries);
+			for (size_t j = 0; j < pair.second.size(); ++j)
+				answers[pair.second[j]] = mapAnswers[j];
+		}
+
+		for (size_t i = 0; i < queries.size(); ++i)
+			writeAnswer(*output, queries[i], answers[i]);
+		output->flush();
+	}
+
+	return 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Graph.h"
+
+#include <iostream>
+
+using namespace std;
+
+// Queries answered per parallel round in batch mode
+#define BATCH_CHUNK_SIZE       4096
+
+/*
+ * One origin/destination query, by vertex ID
+ */
+struct RouteQuery {
+	string map = "";    // Map the query targets, empty for the default one
+	int origin, destination;
+	string error = ""; // Set if the query could not be parsed
+};
+
+/*
+ * Answer to a RouteQuery
+ */
+struct RouteAnswer {
+	bool found = false;
+	double cost = 0;           // Meters or hours, depending on the metric
+	double length = 0;         // Meters
+	vector<int> path;          // Vertex IDs, origin first
+	double time = 0;           // Microseconds
+};
+
+//////////////////////////
+/// Class QueryEngine ////
+//////////////////////////
+
+/**
+ * Answers routing queries in parallel over a CompactGraph
+ * snapshot of a Graph, taken when the engine is built.
+ */
+class QueryEngine {
+	CompactGraph compact;
+	unordered_map<int, int> indexes; // Vertex ID to snapshot index
+	Metric metric;
+	bool astar;
+	int threads;
+	vector<SearchWorkspace> workspaces;
+
+public:
+	QueryEngine(const Graph *graph, Metric metric, bool astar, int threads = 0);
+
+	int getThreads() const;
+	int getNumVertices() const;
+	bool hasVertex(int id) const;
+
+	RouteAnswer route(int origin, int destination, int thread = 0);
+	RouteAnswer route(int origin, int destination, Metric metric, bool astar, int thread = 0);
+
+	vector<RouteAnswer> route(const vector<RouteQuery> &queries);
+};
+
+bool readQueries(istream &in, vector<RouteQuery> &queries, int max);
+
+void writeAnswer(ostream &out, const RouteQuery &query, const RouteAnswer &answer);
+
+int batchMode(int argc, char* argv[]);
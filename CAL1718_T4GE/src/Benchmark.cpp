@@ -0,0 +1,120 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <math.h>
+
+#ifdef linux
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+/*
+ * @brief Operations per second, given the summed latency
+ */
+double LatencySummary::throughput() const {
+	return total > 0 ? samples / (total / 1e6) : 0;
+}
+
+/*
+ * @brief Nearest-rank percentile of an ascending sorted sample
+ * @param p Percentile, from 0 to 100
+ */
+double percentile(const vector<double> &sorted, double p) {
+	if (sorted.empty()) return 0;
+	int rank = (int)ceil(p / 100.0 * sorted.size());
+	rank = max(1, min((int)sorted.size(), rank));
+	return sorted[rank - 1];
+}
+
+/*
+ * @brief Computes mean, standard deviation, extremes and
+ * the 50th, 95th and 99th percentiles of the samples
+ */
+LatencySummary summarizeLatencies(vector<double> samples) {
+	LatencySummary summary;
+	if (samples.empty()) return summary;
+
+	sort(samples.begin(), samples.end());
+
+	for (double s : samples)
+		summary.total += s;
+
+	summary.samples = samples.size();
+	summary.mean = summary.total / samples.size();
+
+	double variance = 0;
+	for (double s : samples)
+		variance += (s - summary.mean) * (s - summary.mean);
+	if (samples.size() > 1)
+		summary.stddev = sqrt(variance / (samples.size() - 1));
+
+	summary.min = samples.front();
+	summary.max = samples.back();
+	summary.p50 = percentile(samples, 50);
+	summary.p95 = percentile(samples, 95);
+	summary.p99 = percentile(samples, 99);
+	return summary;
+}
+
+
+
+//////////////////////
+// CacheMissCounter //
+//////////////////////
+
+/*
+ * @brief Opens the counter, left unavailable if it cannot be opened
+ */
+CacheMissCounter::CacheMissCounter() {
+#ifdef linux
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+CacheMissCounter::~CacheMissCounter() {
+#ifdef linux
+	if (fd >= 0) close(fd);
+#endif
+}
+
+bool CacheMissCounter::isAvailable() const {
+	return fd >= 0;
+}
+
+/*
+ * @brief Resets the count and starts counting
+ */
+void CacheMissCounter::start() {
+#ifdef linux
+	if (fd < 0) return;
+	ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+}
+
+/*
+ * @brief Stops counting
+ * @return The cache misses since start, -1 if unavailable
+ */
+long long CacheMissCounter::stop() {
+#ifdef linux
+	if (fd < 0) return -1;
+	ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	long long count = 0;
+	if (read(fd, &count, sizeof(count)) != sizeof(count)) return -1;
+	return count;
+#else
+	return -1;
+#endif
+}
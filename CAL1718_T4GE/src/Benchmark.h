@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <chrono>
+
+using namespace std;
+
+/*
+ * Summary statistics of a set of latency samples (microseconds)
+ */
+struct LatencySummary {
+	int samples = 0;
+	double mean = 0, stddev = 0;
+	double min = 0, max = 0;
+	double p50 = 0, p95 = 0, p99 = 0;
+	double total = 0;
+
+	double throughput() const; // Operations per second
+};
+
+double percentile(const vector<double> &sorted, double p);
+
+LatencySummary summarizeLatencies(vector<double> samples);
+
+/*
+ * Elapsed time since start, in (fractional) microseconds
+ */
+inline double elapsedMicroseconds(chrono::steady_clock::time_point start) {
+	return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+}
+
+/*
+ * Hardware cache misses of the calling thread between start and stop,
+ * from the Linux performance counters. Unavailable on other platforms
+ * or where the counters are not allowed (see perf_event_paranoid).
+ */
+class CacheMissCounter {
+	int fd = -1;
+
+public:
+	CacheMissCounter();
+	~CacheMissCounter();
+	CacheMissCounter(const CacheMissCounter&) = delete;
+	CacheMissCounter &operator=(const CacheMissCounter&) = delete;
+
+	bool isAvailable() const;
+	void start();
+	long long stop();
+};
@@ -4,49 +4,54 @@
 // Functions Prototypes //
 //////////////////////////
 
-void causeIntersectionAccident();
-void causeRoadAccident();
+void causeIntersectionAccident(Graph *graph);
+void causeRoadAccident(Graph *graph);
+void causeAreaAccident(Graph *graph);
 
 /*
  * Cause Accident UI Menu
  */
-void causeAccident() {
+void causeAccident(Graph *graph) {
 	int option;
 
 	cout << "Cause accident" << endl << endl;
 
 	cout << "1 - Intersection accident" << endl;
-	cout << "2 - Road accident" << endl << endl;
+	cout << "2 - Road accident" << endl;
+	cout << "3 - Area accident" << endl << endl;
 
-	option = selectOption(2);
-	if (option == 3)
+	option = selectOption(3);
+	if (option == 4)
 		return;
 
 	switch (option)
 	{
 	case 1:
-		causeIntersectionAccident();
+		causeIntersectionAccident(graph);
 		break;
 	case 2:
-		causeRoadAccident();
+		causeRoadAccident(graph);
+		break;
+	case 3:
+		causeAreaAccident(graph);
 		break;
 	}
 
 	system("cls");
-	return causeAccident();
+	return causeAccident(graph);
 }
 
 /*
  * Cause Node accident UI
  */
-void causeIntersectionAccident() {
+void causeIntersectionAccident(Graph *graph) {
 	system("cls");
 
 	Vertex *vertex = nullptr;
 
 	cout << "Cause an accident" << endl << endl;
 
-	vertex = selectVertex(true);
+	vertex = selectVertex(graph, true);
 	if (vertex == nullptr) return;
 
 	// Cause accident
@@ -57,17 +62,34 @@ void causeIntersectionAccident() {
 /*
  * Cause Edge accident UI
  */
-void causeRoadAccident() {
+void causeRoadAccident(Graph *graph) {
 	system("cls");
 
 	Edge *edge = nullptr;
 
 	cout << "Cause an accident" << endl << endl;
 
-	edge = selectEdge(true);
+	edge = selectEdge(graph, true);
 	if (edge == nullptr) return;
 
 	// Cause accident
 	edge->accident();
 	graph->rearrange();
 }
+
+/*
+ * Cause Area accident UI
+ */
+void causeAreaAccident(Graph *graph) {
+	system("cls");
+
+	cout << "Cause an accident" << endl << endl;
+
+	vector<pair<double, double>> area = selectArea(graph);
+	if (area.empty()) return;
+
+	// Cause accident on every node inside
+	int closed = graph->accidentArea(area);
+	cout << closed << " nodes closed" << endl;
+	system("pause");
+}
@@ -0,0 +1,317 @@
+#include "CompactGraph.h"
+#include "Graph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <math.h>
+#include <queue>
+#include <thread>
+
+/*
+ * @brief Builds the snapshot of the clear vertices and edges of graph.
+ * Accidented vertices are kept (so that every vertex has an index)
+ * but have no edges in or out.
+ */
+CompactGraph::CompactGraph(const Graph *graph) {
+	vertices = graph->getAllVertexSet();
+	indexes.reserve(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		indexes[vertices[i]] = i;
+		xs.push_back(vertices[i]->getX());
+		ys.push_back(vertices[i]->getY());
+	}
+
+	offsets.reserve(vertices.size() + 1);
+	offsets.push_back(0);
+	for (auto v : vertices) {
+		if (!v->isAccidented()) {
+			for (auto e : v->getAdj()) {
+				if (e->getDest()->isAccidented()) continue;
+				targets.push_back(indexes[e->getDest()]);
+				edges.push_back(e);
+				lengths.push_back(e->getDistance());
+				times.push_back(e->getWeight());
+			}
+		}
+		offsets.push_back(targets.size());
+	}
+
+	scale = graph->getScale();
+	maxSpeed = 0;
+	for (size_t e = 0; e < edges.size(); ++e) {
+		if (times[e] > 0) maxSpeed = max(maxSpeed, (lengths[e] / 1000) / times[e]);
+	}
+}
+
+int CompactGraph::getNumVertices() const {
+	return vertices.size();
+}
+
+int CompactGraph::getNumEdges() const {
+	return targets.size();
+}
+
+/*
+ * @brief Returns the index of vertex v, -1 if not in the snapshot
+ */
+int CompactGraph::getIndex(const Vertex *v) const {
+	auto it = indexes.find(v);
+	return it == indexes.end() ? -1 : it->second;
+}
+
+Vertex* CompactGraph::getVertex(int index) const {
+	return vertices[index];
+}
+
+int CompactGraph::getFirstEdge(int index) const {
+	return offsets[index];
+}
+
+int CompactGraph::getLastEdge(int index) const {
+	return offsets[index + 1];
+}
+
+/*
+ * @brief Vertex edge leaves from: the one whose range holds it
+ */
+int CompactGraph::getSource(int edge) const {
+	return upper_bound(offsets.begin(), offsets.end(), edge) - offsets.begin() - 1;
+}
+
+int CompactGraph::getTarget(int edge) const {
+	return targets[edge];
+}
+
+Edge* CompactGraph::getEdge(int edge) const {
+	return edges[edge];
+}
+
+double CompactGraph::getCost(int edge, Metric metric) const {
+	return metric == DISTANCE ? lengths[edge] : times[edge];
+}
+
+double CompactGraph::getX(int index) const {
+	return xs[index];
+}
+
+double CompactGraph::getY(int index) const {
+	return ys[index];
+}
+
+/*
+ * @brief Reads the current travel times of the edges again, after
+ * their capacities changed (the topology is kept as it was)
+ */
+void CompactGraph::refreshCosts() {
+	maxSpeed = 0;
+	for (size_t e = 0; e < edges.size(); ++e) {
+		times[e] = edges[e]->getWeight();
+		if (times[e] > 0) maxSpeed = max(maxSpeed, (lengths[e] / 1000) / times[e]);
+	}
+}
+
+/*
+ * @brief Lower bound of the cost from one vertex to another:
+ * the straight line distance, or the time to travel it at
+ * the fastest speed of the snapshot
+ */
+double CompactGraph::estimate(int from, int to, Metric metric) const {
+	double dx = xs[to] - xs[from], dy = ys[to] - ys[from];
+	double d = scale * sqrt(dx * dx + dy * dy);
+	if (metric == DISTANCE) return d;
+	return maxSpeed > 0 ? (d / 1000) / maxSpeed : 0;
+}
+
+/*
+ * @brief Dijkstra from origin that stops as soon as every
+ * destination is settled (or the reachable graph is exhausted).
+ * @param result Set to the cost to each destination, in the same
+ * order, infinity if unreachable
+ * @param workspace Thread's own search state, reused between calls
+ * @param paths If given, set to the edges of the path to each
+ * destination, in the same order, empty if unreachable
+ */
+void CompactGraph::oneToMany(int origin, const vector<int> &destinations, Metric metric,
+		vector<double> &result, SearchWorkspace &workspace, vector<vector<int>> *paths) const {
+	static const double infinity = numeric_limits<double>::infinity();
+	using entry = pair<double, int>;
+
+	vector<double> &cost = workspace.cost;
+	vector<char> &target = workspace.target;
+	if (cost.size() != vertices.size()) {
+		cost.assign(vertices.size(), infinity);
+		target.assign(vertices.size(), 0);
+	}
+	vector<int> &parentEdge = workspace.parentEdge;
+	if (paths != nullptr && parentEdge.size() != vertices.size()) {
+		parentEdge.assign(vertices.size(), -1);
+	}
+
+	// Count the distinct destinations still to be settled
+	int remaining = 0;
+	for (int d : destinations) {
+		if (d >= 0 && !target[d]) {
+			target[d] = 1;
+			++remaining;
+		}
+	}
+
+	priority_queue<entry, vector<entry>, greater<entry>> q;
+	cost[origin] = 0;
+	workspace.touched.push_back(origin);
+	q.push({0, origin});
+
+	while (!q.empty() && remaining > 0) {
+		entry top = q.top();
+		q.pop();
+		int v = top.second;
+		if (top.first > cost[v]) continue; // Stale entry
+
+		if (target[v]) {
+			target[v] = 0;
+			--remaining;
+		}
+
+		for (int e = offsets[v]; e < offsets[v + 1]; ++e) {
+			int w = targets[e];
+			double newcost = top.first + getCost(e, metric);
+			if (newcost < cost[w]) {
+				if (cost[w] == infinity)
+					workspace.touched.push_back(w);
+				cost[w] = newcost;
+				if (paths != nullptr) parentEdge[w] = e;
+				q.push({newcost, w});
+			}
+		}
+	}
+
+	result.resize(destinations.size());
+	for (size_t i = 0; i < destinations.size(); ++i)
+		result[i] = destinations[i] >= 0 ? cost[destinations[i]] : infinity;
+
+	if (paths != nullptr) {
+		paths->resize(destinations.size());
+		for (size_t i = 0; i < destinations.size(); ++i) {
+			vector<int> &path = (*paths)[i];
+			path.clear();
+			if (result[i] == infinity) continue;
+			for (int v = destinations[i]; v != origin; v = getSource(parentEdge[v]))
+				path.push_back(parentEdge[v]);
+			reverse(path.begin(), path.end());
+		}
+		for (int v : workspace.touched)
+			parentEdge[v] = -1;
+	}
+
+	// Reset only what was touched
+	for (int v : workspace.touched)
+		cost[v] = infinity;
+	for (int d : destinations)
+		if (d >= 0) target[d] = 0;
+	workspace.touched.clear();
+}
+
+/*
+ * @brief Best path from origin to destination, by Dijkstra
+ * or, if astar is set, by A* guided by estimate().
+ * @param path Set to the vertex indexes of the path, origin first,
+ * empty if the destination is unreachable
+ * @param workspace Thread's own search state, reused between calls
+ * @return The cost of the path, infinity if unreachable
+ */
+double CompactGraph::route(int origin, int destination, Metric metric, bool astar,
+		vector<int> &path, SearchWorkspace &workspace) const {
+	static const double infinity = numeric_limits<double>::infinity();
+	using entry = pair<double, int>;
+
+	vector<double> &cost = workspace.cost;
+	vector<int> &parent = workspace.parent;
+	if (cost.size() != vertices.size()) {
+		cost.assign(vertices.size(), infinity);
+		workspace.target.assign(vertices.size(), 0);
+	}
+	if (parent.size() != vertices.size()) {
+		parent.assign(vertices.size(), -1);
+	}
+
+	priority_queue<entry, vector<entry>, greater<entry>> q;
+	cost[origin] = 0;
+	workspace.touched.push_back(origin);
+	q.push({astar ? estimate(origin, destination, metric) : 0, origin});
+
+	while (!q.empty()) {
+		entry top = q.top();
+		q.pop();
+		int v = top.second;
+		if (v == destination) break;
+
+		double vcost = cost[v];
+		if (top.first > vcost + (astar ? estimate(v, destination, metric) : 0)) continue; // Stale entry
+
+		for (int e = offsets[v]; e < offsets[v + 1]; ++e) {
+			int w = targets[e];
+			double newcost = vcost + getCost(e, metric);
+			if (newcost < cost[w]) {
+				if (cost[w] == infinity)
+					workspace.touched.push_back(w);
+				cost[w] = newcost;
+				parent[w] = v;
+				q.push({newcost + (astar ? estimate(w, destination, metric) : 0), w});
+			}
+		}
+	}
+
+	double result = cost[destination];
+
+	path.clear();
+	if (result != infinity) {
+		for (int v = destination; v != origin; v = parent[v])
+			path.push_back(v);
+		path.push_back(origin);
+		reverse(path.begin(), path.end());
+	}
+
+	// Reset only what was touched
+	for (int v : workspace.touched) {
+		cost[v] = infinity;
+		parent[v] = -1;
+	}
+	workspace.touched.clear();
+
+	return result;
+}
+
+/*
+ * @brief Runs body(i, thread) for every i in 0..n-1, spread over
+ * the given number of threads (0 for one per hardware thread).
+ * Each thread takes the next unprocessed i, so uneven work is balanced.
+ */
+void parallelFor(int n, int threads, function<void(int i, int thread)> body) {
+	if (threads <= 0) threads = defaultThreads();
+	threads = max(1, min(threads, n));
+
+	if (threads == 1) {
+		for (int i = 0; i < n; ++i)
+			body(i, 0);
+		return;
+	}
+
+	atomic<int> next(0);
+	vector<thread> pool;
+	for (int t = 0; t < threads; ++t) {
+		pool.emplace_back([&, t]() {
+			for (int i = next++; i < n; i = next++)
+				body(i, t);
+		});
+	}
+	for (auto &worker : pool)
+		worker.join();
+}
+
+/*
+ * @brief Number of hardware threads, at least 1
+ */
+int defaultThreads() {
+	return max(1u, thread::hardware_concurrency());
+}
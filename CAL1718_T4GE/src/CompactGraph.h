@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+
+using namespace std;
+
+class Graph;
+class Vertex;
+class Edge;
+
+// Edge cost used by the searches
+enum Metric {
+	DISTANCE,       // Meters
+	TRAVEL_TIME     // Hours, at the current average speed of each edge
+};
+
+/*
+ * Reusable per-thread state of the CompactGraph searches
+ */
+struct SearchWorkspace {
+	vector<double> cost;
+	vector<char> target;
+	vector<int> parent;
+	vector<int> parentEdge; // Edge into each vertex on its best path, for oneToMany
+	vector<int> via;       // Overlay level of the edge into each vertex
+	vector<int> touched;
+};
+
+//////////////////////////
+/// Class CompactGraph ///
+//////////////////////////
+
+/**
+ * Read-only snapshot of the clear part of a Graph in compressed
+ * adjacency form (CSR): vertices are numbered 0..n-1 and the edges
+ * leaving vertex i are offsets[i]..offsets[i+1]-1. Accidented edges,
+ * and edges into accidented vertices, are left out.
+ *
+ * Unlike the Graph algorithms, the searches keep no state in the
+ * vertices, so any number of them can run at the same time.
+ */
+class CompactGraph {
+	vector<Vertex*> vertices;
+	unordered_map<const Vertex*, int> indexes;
+	vector<int> offsets;
+	vector<int> targets;
+	vector<Edge*> edges;
+	vector<double> lengths;
+	vector<double> times;
+	vector<double> xs, ys;
+	double scale;
+	double maxSpeed; // Km/h, fastest edge of the snapshot
+
+public:
+	explicit CompactGraph(const Graph *graph);
+
+	int getNumVertices() const;
+	int getNumEdges() const;
+	int getIndex(const Vertex *v) const;
+	Vertex *getVertex(int index) const;
+	int getFirstEdge(int index) const;
+	int getLastEdge(int index) const;
+	int getSource(int edge) const;
+	int getTarget(int edge) const;
+	Edge *getEdge(int edge) const;
+	double getCost(int edge, Metric metric) const;
+	double getX(int index) const;
+	double getY(int index) const;
+	double estimate(int from, int to, Metric metric) const;
+
+	void refreshCosts();
+
+	void oneToMany(int origin, const vector<int> &destinations, Metric metric,
+			vector<double> &result, SearchWorkspace &workspace, vector<vector<int>> *paths = nullptr) const;
+
+	double route(int origin, int destination, Metric metric, bool astar,
+			vector<int> &path, SearchWorkspace &workspace) const;
+};
+
+void parallelFor(int n, int threads, function<void(int i, int thread)> body);
+
+int defaultThreads();
@@ -0,0 +1,346 @@
+#include "Components.h"
+
+#include <algorithm>
+
+/*
+ * @brief Indexes the strongly connected components of graph
+ * as it is now, and follows its accidents and fixes from then on
+ */
+ComponentIndex::ComponentIndex(Graph *graph) : GraphMirror(graph), graph(graph) {
+	int n = vertices.size();
+	component.assign(n, 0);
+	stamp.assign(n, 0);
+	order.assign(n, -1);
+	low.assign(n, 0);
+
+	// All in one component, then split by Tarjan's algorithm
+	newComponent();
+	for (int i = 0; i < n; ++i)
+		members[0].push_back(i);
+	if (n > 0) split(0);
+
+	listener = graph->addListener([this](const vector<GraphChange> &changes) { changed(changes); });
+}
+
+ComponentIndex::~ComponentIndex() {
+	graph->removeListener(listener);
+}
+
+/*
+ * @brief (Private) An empty component, reusing a free id if any
+ */
+int ComponentIndex::newComponent() {
+	if (!freeComponents.empty()) {
+		int c = freeComponents.back();
+		freeComponents.pop_back();
+		return c;
+	}
+	members.emplace_back();
+	successors.emplace_back();
+	predecessors.emplace_back();
+	if (stamp.size() < members.size()) stamp.resize(members.size(), 0);
+	return members.size() - 1;
+}
+
+/*
+ * @brief (Private) Adds count graph edges to the DAG edge from -> to
+ */
+void ComponentIndex::link(int from, int to, int count) {
+	successors[from][to] += count;
+	predecessors[to][from] += count;
+}
+
+/*
+ * @brief (Private) Takes count graph edges from the DAG edge from -> to,
+ * dropping it once none is left
+ */
+void ComponentIndex::unlink(int from, int to, int count) {
+	if ((successors[from][to] -= count) <= 0) successors[from].erase(to);
+	if ((predecessors[to][from] -= count) <= 0) predecessors[to].erase(from);
+}
+
+/*
+ * @brief (Private) Drops every DAG edge into or out of component c
+ */
+void ComponentIndex::detach(int c) {
+	for (auto &pair : successors[c])
+		predecessors[pair.first].erase(c);
+	for (auto &pair : predecessors[c])
+		successors[pair.first].erase(c);
+	successors[c].clear();
+	predecessors[c].clear();
+}
+
+/*
+ * @brief (Private) Whether origin reaches (forward) or is reached
+ * from (backward) every vertex of ends, inside its component
+ */
+bool ComponentIndex::reachesAll(int origin, const vector<int> &ends, bool forward) const {
+	int c = component[origin];
+	++round;
+	int goal = ++round; // Ends are marked goal, reached vertices goal - 1
+	int remaining = 0;
+	for (int v : ends) {
+		if (stamp[v] != goal) {
+			stamp[v] = goal;
+			++remaining;
+		}
+	}
+
+	vector<int> queue = {origin};
+	--remaining;
+	stamp[origin] = goal - 1;
+	for (size_t head = 0; head < queue.size() && remaining > 0; ++head) {
+		int v = queue[head];
+		for (int e : forward ? outgoing[v] : incoming[v]) {
+			if (!usable[e]) continue;
+			int w = forward ? targets[e] : sources[e];
+			if (component[w] != c || stamp[w] == goal - 1) continue;
+			if (stamp[w] == goal) --remaining;
+			stamp[w] = goal - 1;
+			queue.push_back(w);
+		}
+	}
+	return remaining <= 0;
+}
+
+/*
+ * @brief (Private) Components reached from component c through the
+ * DAG, c included, following its edges forward or backward
+ * @param within If given, only components marked in it are visited
+ */
+vector<int> ComponentIndex::componentsFrom(int c, const vector<char> *within, bool forward) const {
+	++round;
+	vector<int> reached = {c};
+	stamp[c] = round;
+	for (size_t head = 0; head < reached.size(); ++head) {
+		for (auto &pair : forward ? successors[reached[head]] : predecessors[reached[head]]) {
+			int d = pair.first;
+			if (stamp[d] == round || (within != nullptr && !(*within)[d])) continue;
+			stamp[d] = round;
+			reached.push_back(d);
+		}
+	}
+	return reached;
+}
+
+/*
+ * @brief (Private) Splits component c into the strongly connected
+ * components of its vertices, by an iterative Tarjan's algorithm,
+ * and links them in the DAG. The first one keeps the id c.
+ */
+void ComponentIndex::split(int c) {
+	vector<int> group;
+	group.swap(members[c]);
+	detach(c);
+
+	int mark = ++round;
+	for (int v : group) {
+		stamp[v] = mark;
+		order[v] = -1;
+		component[v] = -1; // Until assigned; -1 and ordered means on the stack
+	}
+
+	int counter = 0, next = c;
+	vector<int> stack;
+	vector<pair<int, size_t>> calls; // Vertex and its next edge
+	for (int root : group) {
+		if (order[root] >= 0) continue;
+		order[root] = low[root] = counter++;
+		stack.push_back(root);
+		calls.push_back({root, 0});
+
+		while (!calls.empty()) {
+			int v = calls.back().first;
+			if (calls.back().second < outgoing[v].size()) {
+				int e = outgoing[v][calls.back().second++];
+				int w = targets[e];
+				if (!usable[e] || stamp[w] != mark) continue;
+				if (order[w] < 0) {
+					order[w] = low[w] = counter++;
+					stack.push_back(w);
+					calls.push_back({w, 0});
+				} else if (component[w] == -1) {
+					low[v] = min(low[v], order[w]);
+				}
+				continue;
+			}
+
+			calls.pop_back();
+			if (!calls.empty()) {
+				int parent = calls.back().first;
+				low[parent] = min(low[parent], low[v]);
+			}
+			if (low[v] == order[v]) {
+				int id = next >= 0 ? next : newComponent();
+				next = -1;
+				int w;
+				do {
+					w = stack.back();
+					stack.pop_back();
+					component[w] = id;
+					members[id].push_back(w);
+				} while (w != v);
+			}
+		}
+	}
+
+	// DAG edges out of the group, and into it from elsewhere
+	for (int v : group) {
+		for (int e : outgoing[v]) {
+			if (usable[e] && component[targets[e]] != component[v])
+				link(component[v], component[targets[e]], 1);
+		}
+		for (int e : incoming[v]) {
+			if (usable[e] && stamp[sources[e]] != mark)
+				link(component[sources[e]], component[v], 1);
+		}
+	}
+}
+
+/*
+ * @brief (Private) A new usable edge from component from to component
+ * to, which to already reaches: merges every component on a path from
+ * to back to from (those reached from to that also reach from)
+ */
+void ComponentIndex::merge(int from, int to) {
+	vector<char> ahead(members.size(), 0);
+	for (int c : componentsFrom(to))
+		ahead[c] = 1;
+	vector<int> cycle = componentsFrom(from, &ahead, false);
+
+	vector<char> inCycle(members.size(), 0);
+	int keep = cycle[0];
+	for (int c : cycle) {
+		inCycle[c] = 1;
+		if (members[c].size() > members[keep].size()) keep = c;
+	}
+
+	for (int c : cycle) {
+		if (c == keep) continue;
+		map<int, int> out = successors[c], in = predecessors[c];
+		detach(c);
+		for (auto &pair : out)
+			if (!inCycle[pair.first]) link(keep, pair.first, pair.second);
+		for (auto &pair : in)
+			if (!inCycle[pair.first]) link(pair.first, keep, pair.second);
+
+		for (int v : members[c]) {
+			component[v] = keep;
+			members[keep].push_back(v);
+		}
+		members[c].clear();
+		freeComponents.push_back(c);
+	}
+}
+
+/*
+ * @brief (Private) Listener of the graph: updates the index
+ * after accidents or fixes (see class description), all those
+ * of a bulk operation at once
+ */
+void ComponentIndex::changed(const vector<GraphChange> &changes) {
+	vector<int> added, removed, isolated, fixed;
+	update(changes, added, removed, isolated, fixed);
+
+	// Lost edges between components leave the DAG,
+	// those inside one leave ends that must still meet
+	map<int, vector<int>> lost;
+	for (int id : removed) {
+		int from = component[sources[id]], to = component[targets[id]];
+		if (from != to) unlink(from, to, 1);
+		else {
+			lost[from].push_back(sources[id]);
+			lost[from].push_back(targets[id]);
+		}
+	}
+
+	// An accidented vertex is left on its own
+	for (int x : isolated) {
+		if (!vertices[x]->isAccidented()) continue; // Fixed again since
+		int c = component[x];
+		if (members[c].size() > 1) {
+			members[c].erase(find(members[c].begin(), members[c].end(), x));
+			int id = newComponent();
+			component[x] = id;
+			members[id].push_back(x);
+		}
+		if (lost.count(c)) {
+			vector<int> &ends = lost[c];
+			ends.erase(remove(ends.begin(), ends.end(), x), ends.end());
+		}
+	}
+
+	for (auto &pair : lost) {
+		const vector<int> &ends = pair.second;
+		if (ends.empty()) continue;
+		if (!reachesAll(ends[0], ends, true) || !reachesAll(ends[0], ends, false))
+			split(pair.first);
+	}
+
+	for (int id : added) {
+		int from = component[sources[id]], to = component[targets[id]];
+		if (from == to) continue;
+		vector<int> reached = componentsFrom(to);
+		if (find(reached.begin(), reached.end(), from) != reached.end())
+			merge(from, to);
+		else
+			link(from, to, 1);
+	}
+}
+
+/*
+ * @brief Number of strongly connected components,
+ * accidented vertices counting as one each
+ */
+int ComponentIndex::getNumComponents() const {
+	return members.size() - freeComponents.size();
+}
+
+/*
+ * @brief Component id of vertex v, -1 if not indexed
+ */
+int ComponentIndex::getComponent(const Vertex *v) const {
+	auto it = indexes.find(v);
+	return it == indexes.end() ? -1 : component[it->second];
+}
+
+/*
+ * @brief Number of vertices in the component of v, 0 if not indexed
+ */
+int ComponentIndex::getComponentSize(const Vertex *v) const {
+	int c = getComponent(v);
+	return c < 0 ? 0 : members[c].size();
+}
+
+/*
+ * @brief Whether there is a path from one vertex to the other
+ * through clear edges and vertices: both in the same component,
+ * or the first one's component reaching the other's in the DAG
+ */
+bool ComponentIndex::reaches(const Vertex *from, const Vertex *to) const {
+	int a = getComponent(from), b = getComponent(to);
+	if (a < 0 || b < 0) return false;
+	if (a == b) return true;
+	vector<int> reached = componentsFrom(a);
+	return find(reached.begin(), reached.end(), b) != reached.end();
+}
+
+/*
+ * @brief Clear vertices with no path from vertex from,
+ * in a single pass over the components it reaches
+ */
+vector<Vertex*> ComponentIndex::getUnreachable(const Vertex *from) const {
+	vector<Vertex*> unreachable;
+	int a = getComponent(from);
+	if (a < 0) return unreachable;
+
+	vector<char> reached(members.size(), 0);
+	for (int c : componentsFrom(a))
+		reached[c] = 1;
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		if (!reached[component[i]] && !vertices[i]->isAccidented())
+			unreachable.push_back(vertices[i]);
+	}
+	return unreachable;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Graph.h"
+#include "GraphMirror.h"
+
+#include <map>
+
+using namespace std;
+
+//////////////////////////
+/// Class ComponentIndex /
+//////////////////////////
+
+/**
+ * Strongly connected components of the clear part of a Graph (the
+ * edges CompactGraph keeps: clear edges between clear vertices),
+ * with their condensation DAG. Vertices of a component reach each
+ * other; a vertex reaches another component only through the DAG,
+ * which road networks keep small (one large component and a few
+ * dead ends and one way stubs around it).
+ *
+ * The index follows accidents and fixes as they happen (see
+ * Graph::addListener):
+ * - An edge that becomes usable between two components either adds a
+ *   DAG edge or, if it closes a cycle in the DAG, merges every
+ *   component on that cycle.
+ * - An edge or vertex that stops being usable inside a component is
+ *   routed around: the component is only split again (by Tarjan's
+ *   algorithm over its own vertices) if the endpoints of what was
+ *   lost no longer reach each other.
+ *
+ * Vertices and edges added or removed after the index was built
+ * (e.g. by loadDelta) are not followed: build it again.
+ * The index must not outlive its graph.
+ */
+class ComponentIndex : GraphMirror {
+	Graph *graph;
+	int listener;
+
+	vector<int> component;              // Per vertex
+	vector<vector<int>> members;        // Per component, empty if unused
+	vector<map<int, int>> successors;   // DAG: edges between components,
+	vector<map<int, int>> predecessors; // with the number of graph edges
+	vector<int> freeComponents;
+
+	mutable vector<int> stamp;          // Per vertex or component, for searches
+	mutable int round = 0;
+	vector<int> order, low;             // Per vertex, for Tarjan's algorithm
+
+	int newComponent();
+	void link(int from, int to, int count);
+	void unlink(int from, int to, int count);
+	void detach(int c);
+	bool reachesAll(int origin, const vector<int> &ends, bool forward) const;
+	vector<int> componentsFrom(int c, const vector<char> *within = nullptr, bool forward = true) const;
+	void split(int c);
+	void merge(int from, int to);
+	void changed(const vector<GraphChange> &changes);
+
+public:
+	explicit ComponentIndex(Graph *graph);
+	~ComponentIndex();
+	ComponentIndex(const ComponentIndex&) = delete;
+	ComponentIndex &operator=(const ComponentIndex&) = delete;
+
+	int getNumComponents() const;
+	int getComponent(const Vertex *v) const;
+	int getComponentSize(const Vertex *v) const;
+	bool reaches(const Vertex *from, const Vertex *to) const;
+	vector<Vertex*> getUnreachable(const Vertex *from) const;
+};
@@ -9,13 +9,13 @@ void addCars(Edge* edge);
 void removeCars(Edge* edge);
 void printEdgeInfo(Edge* edge);
 
-void editRoadInfo() {
+void editRoadInfo(Graph *graph) {
 	Edge *edge = nullptr;
 
 	cout << "Edit road information " << endl << endl;
 
 	// Get origin
-	edge = selectEdge(true);
+	edge = selectEdge(graph, true);
 	if (edge == nullptr) return;
 
 	graph->setEdgeColor(edge, SELECTED_COLOR);
@@ -1,6 +1,8 @@
 #include "Interface.h"
 #include "SearchAlgorithms.h"
 
+#include <math.h>
+
 using namespace std::chrono;
 
 //////////////////////
@@ -16,21 +18,21 @@ Road * endRoad = NULL;
 // Functions Prototypes //
 //////////////////////////
 
-void evacuateClient();
-Road * exactSearch(string pattern);
-bool orderLessDiff(pair<int,string> pair1, pair<int,string> pair2);
-Road * approximateSearch(string pattern);
-Vertex * selectNode(Road * road, int position, int direction);
-Vertex * selectRoad(Road *& road);
-void pathFinder(Vertex *origin, Vertex *destination);
-void checkUnreachableNodes(Vertex* origin);
-void benchmarking(int N);
+void evacuateClient(Graph *graph, RouteCache &routes, ComponentIndex &components);
+Road * exactSearch(Graph *graph, string pattern);
+bool orderLessDiff(pair<int,Road *> pair1, pair<int,Road *> pair2);
+Road * approximateSearch(Graph *graph, string pattern);
+Vertex * selectNode(Graph *graph, Road * road, int position, int direction);
+Vertex * selectRoad(Graph *graph, Road *& road);
+void pathFinder(Graph *graph, RouteCache &routes, Vertex *origin, Vertex *destination);
+void checkUnreachableNodes(Graph *graph, const ComponentIndex &components, Vertex* origin);
+void benchmarking(Graph *graph, int N);
 
 /**
  * @brief Emergency line interface that allows user to choose algorithm to be used
  * in order to help me to be evacuated
  */
-void emergencyLine() {
+void emergencyLine(Graph *graph, RouteCache &routes, ComponentIndex &components) {
 
 	system("cls");
 	cout << "Emergency Line" << endl << endl;
@@ -67,20 +69,20 @@ void emergencyLine() {
 	else if(algorithm == 7) {
 		int iterations = selectIterations();
 		cout << endl << endl;
-		if (iterations == 0) return emergencyLine();
-		benchmarking(iterations);
+		if (iterations == 0) return emergencyLine(graph, routes, components);
+		benchmarking(graph, iterations);
 	}
 	else
-		evacuateClient();
+		evacuateClient(graph, routes, components);
 
-	return emergencyLine();
+	return emergencyLine(graph, routes, components);
 }
 
 /**
  * @brief Determines both location where user is going to be evacuated and where he
  * will be evacuated
  */
-void evacuateClient() {
+void evacuateClient(Graph *graph, RouteCache &routes, ComponentIndex &components) {
 
 	//Local variables
 	Vertex * startingNode;
@@ -92,12 +94,12 @@ void evacuateClient() {
 	cout << "Emergency Line" << endl << endl;
 	cout << "Evacuate From: " << endl << endl;
 
-	startingNode = selectRoad(startRoad);
+	startingNode = selectRoad(graph, startRoad);
 
 	if(startingNode == NULL)
 		return;
 	else
-		checkUnreachableNodes(startingNode);
+		checkUnreachableNodes(graph, components, startingNode);
 
 
 	//Determines evacuation destiny
@@ -105,7 +107,7 @@ void evacuateClient() {
 	cout << "Emergency Line" << endl << endl;
 	cout << "Evacuate To" << endl << endl;
 
-	reachingNode = selectRoad(endRoad);
+	reachingNode = selectRoad(graph, endRoad);
 
 	if(reachingNode == NULL)
 		return;
@@ -116,7 +118,7 @@ void evacuateClient() {
 	cout << "Evacuate To: " << endRoad->getName() << endl << endl;
 
 	//Animation relative to evacuation route
-	pathFinder(startingNode, reachingNode);
+	pathFinder(graph, routes, startingNode, reachingNode);
 
 	system("pause");
 }
@@ -129,36 +131,37 @@ void evacuateClient() {
  *
  * @return Returns pointer to the selected road
  */
-Road * exactSearch(string pattern) {
+Road * exactSearch(Graph *graph, string pattern) {
 
 	//Local variables
 	int option;
-	vector<string> availableRoads;
-	map<string,Road *>::iterator it = graph->getRoadsInfo().begin();
+	vector<Road *> availableRoads;
+	string normalizedPattern = normalizeText(pattern);
+	multimap<string,Road *>::iterator it = graph->getRoadsIndex().begin();
 
 	//Check pattern existence on all possible roads
-	while(it != graph->getRoadsInfo().end()) {
+	while(it != graph->getRoadsIndex().end()) {
 		bool result = false;
 
 		//Algorithm to be used
 		switch(algorithm) {
 		case 1:
-			result = naiveAlgorithm(it->first, pattern);
+			result = naiveAlgorithm(it->first, normalizedPattern);
 			break;
 		case 2:
-			result = rabinKarpAlgorithm(it->first, pattern);
+			result = rabinKarpAlgorithm(it->first, normalizedPattern);
 			break;
 		case 3:
-			result = finiteAutomataAlgorithm(it->first, pattern);
+			result = finiteAutomataAlgorithm(it->first, normalizedPattern);
 			break;
 		case 4:
-			result = knuthMorrisPrattAlgorithm(it->first, pattern);
+			result = knuthMorrisPrattAlgorithm(it->first, normalizedPattern);
 			break;
 		}
 
 		if(result && ((startRoad == NULL) || (startRoad != endRoad))) {
 			if(!it->first.empty()) {
-				availableRoads.push_back(it->first);
+				availableRoads.push_back(it->second);
 				if(availableRoads.size() >= 20)
 					break;
 			}
@@ -174,7 +177,7 @@ Road * exactSearch(string pattern) {
 	}
 
 	for(unsigned int i = 0; i < availableRoads.size(); i++)
-		cout << i + 1 << " - " << availableRoads.at(i) << endl;
+		cout << i + 1 << " - " << availableRoads.at(i)->getName() << endl;
 
 	cout << endl;
 	option = selectOption(availableRoads.size());
@@ -182,7 +185,7 @@ Road * exactSearch(string pattern) {
 	if(option > (int)(availableRoads.size()))
 		return NULL;
 	else
-		return graph->getRoadsInfo().find(availableRoads.at(option - 1))->second;
+		return availableRoads.at(option - 1);
 }
 
 /**
@@ -192,7 +195,7 @@ Road * exactSearch(string pattern) {
  *
  * @return True if pair1 < pair2. Otherwise returns false
  */
-bool orderLessDiff(pair<int,string> pair1, pair<int,string> pair2) {
+bool orderLessDiff(pair<int,Road *> pair1, pair<int,Road *> pair2) {
 	return pair1.first < pair2.first;
 }
 
@@ -204,32 +207,31 @@ bool orderLessDiff(pair<int,string> pair1, pair<int,string> pair2) {
  *
  * @return Returns pointer to the selected road
  */
-Road * approximateSearch(string pattern) {
+Road * approximateSearch(Graph *graph, string pattern) {
 
 	//Local variables
 	int option;
-	vector<pair<int,string>> availableRoads;
-	map<string,Road *>::iterator it = graph->getRoadsInfo().begin();
+	unsigned int shown;
+	vector<pair<int,Road *>> availableRoads;
+	string normalizedPattern = normalizeText(pattern);
+	multimap<string,Road *>::iterator it = graph->getRoadsIndex().begin();
 
 	//Check pattern existence
-	while(it != graph->getRoadsInfo().end()) {
+	while(it != graph->getRoadsIndex().end()) {
 		int result = -1;
 
 		if(!it->first.empty()) {
 			switch(algorithm) {
 			case 5:
-				result = editDistanceAlgorithm(it->first, pattern);
+				result = editDistanceAlgorithm(it->first, normalizedPattern);
 				break;
 			case 6:
-				result = hammingDistanceAlgorithm(it->first, pattern);
+				result = hammingDistanceAlgorithm(it->first, normalizedPattern);
 				break;
 			}
 
-			if((result >= 0) && ((startRoad == NULL) || (startRoad != endRoad))) {
-				if(!it->first.empty())
-					availableRoads.push_back(pair<int,string>(result,it->first));
-
-			}
+			if((result >= 0) && ((startRoad == NULL) || (startRoad != endRoad)))
+				availableRoads.push_back(pair<int,Road *>(result,it->second));
 		}
 
 		it++;
@@ -241,18 +243,20 @@ Road * approximateSearch(string pattern) {
 		return NULL;
 	}
 	else
-		sort(availableRoads.begin(), availableRoads.end(), orderLessDiff);
+		stable_sort(availableRoads.begin(), availableRoads.end(), orderLessDiff);
+
+	shown = min((unsigned int)availableRoads.size(), 20u);
 
-	for(unsigned int i = 0; i < 20; i++)
-		cout << i + 1 << " - " << availableRoads.at(i).second << endl;
+	for(unsigned int i = 0; i < shown; i++)
+		cout << i + 1 << " - " << availableRoads.at(i).second->getName() << endl;
 
 	cout << endl;
-	option = selectOption(20);
+	option = selectOption(shown);
 
-	if(option > 20)
+	if(option > (int)shown)
 		return NULL;
 	else
-		return graph->getRoadsInfo().find(availableRoads.at(option - 1).second)->second;
+		return availableRoads.at(option - 1).second;
 }
 
 /**
@@ -265,80 +269,33 @@ Road * approximateSearch(string pattern) {
  *
  * @return Return user vertex position
  */
-Vertex * selectNode(Road * road, int position, int direction) {
+Vertex * selectNode(Graph *graph, Road * road, int position, int direction) {
 
 	//Local variables
-	vector<int> edgeIDs;
-	double totalDistance = 0;
-	unsigned int nextID = 1;
-	int i = 0;
-	map<int, Edge *>::iterator it = graph->getSubRoadsInfo().begin();
+	int last = road->getNumSubroads() - 1;
+	int i = road->findSubroad(position, direction);
 
-	//Stores on edgeIDS the edge id of every edge that belongs to selected road
-	while(it != graph->getSubRoadsInfo().end()) {
-		if(road->getName() == it->second->getRoad()->getName())
-			edgeIDs.push_back(it->second->getID());
-
-		it++;
+	if(i < 0) {
+		cout << "Road <" << road->getName() << "> has no subroads" << endl << endl;
+		system("pause");
+		return NULL;
 	}
 
-	//Ascendent sort of the road edge ids
-	sort(edgeIDs.begin(), edgeIDs.end());
-
-	//Checks if it is necessary to increment road by 2 or just 1 (default nextID)
-	if(road->isBidirectional())
-		nextID = 2;
-
+	//Next subroad in the chosen direction, blocked ahead of the user
+	int next = (direction == 1) ? i + 1 : i - 1;
 
 	//Change graph state according to options chosen
-	if(direction == 1) //Begin to end
-	{
-		for(i = 0; i < (int)edgeIDs.size(); i += nextID) {
-			totalDistance += graph->findEdge(edgeIDs.at(i))->getDistance();
-
-			if((position <= totalDistance)){
-				graph->setVertexColor(graph->findEdge(edgeIDs.at(i))->getDest(), SELECTED_COLOR);
-				if(endRoad == NULL) {
-					if((i + nextID) < edgeIDs.size()) {
-						accidentedEdgeID = graph->findEdge(edgeIDs.at(i + nextID))->getID();
-						graph->accidentEdge(graph->findEdge(edgeIDs.at(i + nextID)));
-					}
-				}
-				break;
-			}
-			else if((i + nextID) >= edgeIDs.size()) {
-				i = edgeIDs.size() - 1;
-				graph->setVertexColor(graph->findEdge(edgeIDs.at(i))->getDest(), SELECTED_COLOR);
-				break;
-			}
-		}
-	}
-	else if(direction == 2) //End to begin
-	{
-		for(i = (edgeIDs.size() - 1); i >= 0; i -= nextID) {
-			totalDistance += graph->findEdge(edgeIDs.at(i))->getDistance();
-
-			if(position <= totalDistance) {
-				graph->setVertexColor(graph->findEdge(edgeIDs.at(i))->getDest(), SELECTED_COLOR);
-				if(endRoad == NULL) {
-					if((i - nextID) >= 0) {
-						accidentedEdgeID = graph->findEdge(edgeIDs.at(i - nextID))->getID();
-						graph->accidentEdge(graph->findEdge(edgeIDs.at(i - nextID)));
-					}
-				}
-				break;
-			}
-			else if((i - nextID) < 0) {
-				i = 0;
-				graph->setVertexColor(graph->findEdge(edgeIDs.at(i))->getDest(), SELECTED_COLOR);
-				break;
-			}
-		}
+	Vertex * node = road->getEdge(i, direction)->getDest();
+	graph->setVertexColor(node, SELECTED_COLOR);
+
+	if((endRoad == NULL) && (next >= 0) && (next <= last)) {
+		accidentedEdgeID = road->getEdge(next, direction)->getID();
+		graph->accidentEdge(road->getEdge(next, direction));
 	}
 
 	graph->update();
 	system("pause");
-	return graph->findEdge(edgeIDs.at(i))->getDest();
+	return node;
 }
 
 /**
@@ -349,7 +306,7 @@ Vertex * selectNode(Road * road, int position, int direction) {
  *
  * @return Return the vertex where user is at
  */
-Vertex * selectRoad(Road *& road) {
+Vertex * selectRoad(Graph *graph, Road *& road) {
 
 	//Local variables
 	int posMeters, direction;
@@ -364,9 +321,9 @@ Vertex * selectRoad(Road *& road) {
 
 	//Perform chosen algorithm
 	if(algorithm == 5 || algorithm == 6)
-		road = approximateSearch(pattern);
+		road = approximateSearch(graph, pattern);
 	else
-		road = exactSearch(pattern);
+		road = exactSearch(graph, pattern);
 
 	//Check road validity
 	if(road == NULL)
@@ -399,7 +356,7 @@ Vertex * selectRoad(Road *& road) {
 		return NULL;
 
 	cout << endl;
-	return selectNode(road, posMeters, direction);
+	return selectNode(graph, road, posMeters, direction);
 }
 
 
@@ -407,20 +364,20 @@ Vertex * selectRoad(Road *& road) {
  * @brief Function responsible to execute evacuation from
  * origin to destination and animate it
  *
+ * @param routes Evacuation routes already found, reused until
+ * an accident on them or a fix (see RouteCache)
+ *
  * @param origin Origin vertex
  *
  * @param destination Destination vertex
  */
-void pathFinder(Vertex *origin, Vertex *destination) {
-
-	//Local variables
-	microtime time;
+void pathFinder(Graph *graph, RouteCache &routes, Vertex *origin, Vertex *destination) {
 
-	// Perform A* algorithm (better performance)
-	graph->AstarDist(origin, destination, &time);
+	// Kept route, or A* algorithm (better performance)
+	CachedRoute route = routes.route(origin, destination, DISTANCE);
 
 	// Get shortest path and animate
-	vector<Vertex*> path = graph->getPath(origin, destination);
+	vector<Vertex*> path = route.path;
 
 	if(path.size() == 0)
 		cout << "Not possible to evacuate to the location specified" << endl << endl;
@@ -429,34 +386,31 @@ void pathFinder(Vertex *origin, Vertex *destination) {
 		graph->animatePath(path, 200, PATH_COLOR, true);
 		cout << endl << endl << "Done." << endl << endl;
 	}
+
+	RouteCacheStats stats = routes.getStats();
+	cout << "Route cache: " << stats.hits << " hits, " << stats.misses << " misses ("
+			<< (int)round(100 * stats.hitRate()) << "%), " << stats.routes << " routes, "
+			<< stats.memory / 1024 << " KB" << endl << endl;
 }
 
 /**
  * @brief After origin vertex is established this function determines
  * unreachable nodes from origin
  *
+ * @param components Reachability of the graph, kept for the session
  * @param origin Starting vertex (node)
  */
 
-void checkUnreachableNodes(Vertex* origin) {
-
-	//Calculate possible paths
-	graph->bfs(origin);
-
-	for (auto v : graph->getVertexSet()) { // Non-accidented vertices
-		if (v->getPath() == nullptr) {
-			graph->setVertexColor(v, UNREACHABLE_COLOR);
-		}
-	}
+void checkUnreachableNodes(Graph *graph, const ComponentIndex &components, Vertex* origin) {
 
+	colorUnreachableNodes(graph, components, origin);
 	graph->rearrange();
-	graph->clear();
 }
 
 /**
  * @brief Function used to check algorithms performance
  */
-void benchmarking(int N) {
+void benchmarking(Graph *graph, int N) {
 
 	system("cls");
 	cout << "##################" << endl;
@@ -466,14 +420,15 @@ void benchmarking(int N) {
 	//Local variables
 	string text = "";
 	string pattern;
-	map<string,Road *>::iterator it = graph->getRoadsInfo().begin();
+	multimap<string,Road *>::iterator it = graph->getRoadsIndex().begin();
 
 	//Select location name
 	cout << "Location name: ";
 	cin.ignore(1000,'\n');
 	getline(cin, pattern);
+	pattern = normalizeText(pattern);
 
-	while(it != graph->getRoadsInfo().end()) {
+	while(it != graph->getRoadsIndex().end()) {
 		text += it->first + " ";
 		it++;
 	}
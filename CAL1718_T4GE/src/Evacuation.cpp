@@ -0,0 +1,462 @@
+#include "Evacuation.h"
+#include "FlowNetwork.h"
+
+#include <limits>
+#include <queue>
+#include <algorithm>
+
+static const double infinity = numeric_limits<double>::infinity();
+
+/*
+ * @brief Builds the table of the routes to the nearest of safeZones,
+ * and follows the graph's accidents and fixes from then on
+ * @param metric Cost of the routes: meters, or hours at the current
+ * average speed of each edge
+ */
+SafeZoneTable::SafeZoneTable(Graph *graph, const vector<Vertex*> &safeZones, Metric metric) :
+		GraphMirror(graph), graph(graph), metric(metric) {
+	int n = vertices.size();
+	costs.resize(edges.size());
+
+	safe.assign(n, 0);
+	for (Vertex *v : safeZones) {
+		auto it = indexes.find(v);
+		if (it != indexes.end()) safe[it->second] = 1;
+	}
+
+	refresh();
+	listener = graph->addListener([this](const vector<GraphChange> &changes) { changed(changes); });
+}
+
+SafeZoneTable::~SafeZoneTable() {
+	graph->removeListener(listener);
+}
+
+/*
+ * @brief (Private) Whether vertex v is a safe zone routes may end at
+ */
+bool SafeZoneTable::isSeed(int v) const {
+	return safe[v] && !vertices[v]->isAccidented();
+}
+
+/*
+ * @brief (Private) Dijkstra backwards from the given vertices, whose
+ * cost is already set, improving whoever can reach them for less
+ */
+void SafeZoneTable::search(const vector<int> &seeds) {
+	using entry = pair<double, int>;
+	priority_queue<entry, vector<entry>, greater<entry>> q;
+	for (int v : seeds)
+		q.push({cost[v], v});
+
+	while (!q.empty()) {
+		entry top = q.top();
+		q.pop();
+		int v = top.second;
+		if (top.first > cost[v]) continue; // Stale entry
+
+		for (int e : incoming[v]) {
+			if (!usable[e]) continue;
+			int u = sources[e];
+			double newcost = top.first + costs[e];
+			if (newcost < cost[u]) {
+				cost[u] = newcost;
+				next[u] = e;
+				zone[u] = zone[v];
+				q.push({newcost, u});
+			}
+		}
+	}
+}
+
+/*
+ * @brief Builds the whole table again, reading the
+ * current travel times of the edges
+ */
+void SafeZoneTable::refresh() {
+	for (size_t e = 0; e < edges.size(); ++e)
+		costs[e] = metric == DISTANCE ? edges[e]->getDistance() : edges[e]->getWeight();
+
+	cost.assign(vertices.size(), infinity);
+	next.assign(vertices.size(), -1);
+	zone.assign(vertices.size(), -1);
+
+	vector<int> seeds;
+	for (size_t v = 0; v < vertices.size(); ++v) {
+		if (isSeed(v)) {
+			cost[v] = 0;
+			zone[v] = v;
+			seeds.push_back(v);
+		}
+	}
+	search(seeds);
+}
+
+/*
+ * @brief (Private) Listener of the graph: updates the routes
+ * after accidents or fixes (see class description), all those
+ * of a bulk operation at once
+ */
+void SafeZoneTable::changed(const vector<GraphChange> &changes) {
+	vector<int> added, removed, accidented, fixed;
+	update(changes, added, removed, accidented, fixed);
+
+	// Vertices whose route took a lost edge, and all routed through them
+	vector<int> lost;
+	for (int id : removed) {
+		if (next[sources[id]] == id) lost.push_back(sources[id]);
+	}
+	for (int x : accidented) {
+		if (vertices[x]->isAccidented()) lost.push_back(x);
+	}
+	for (int u : lost)
+		zone[u] = -2; // Marks the lost vertices until they are reset
+	for (size_t i = 0; i < lost.size(); ++i) {
+		for (int id : incoming[lost[i]]) {
+			int u = sources[id];
+			if (next[u] == id && zone[u] != -2) {
+				zone[u] = -2;
+				lost.push_back(u);
+			}
+		}
+	}
+	for (int u : lost) {
+		cost[u] = infinity;
+		next[u] = -1;
+		zone[u] = -1;
+	}
+
+	// They start over from their neighbours (or themselves, if safe)
+	vector<int> seeds;
+	for (int u : lost) {
+		if (isSeed(u)) {
+			cost[u] = 0;
+			zone[u] = u;
+		}
+		for (int id : outgoing[u]) {
+			int w = targets[id];
+			if (usable[id] && cost[w] + costs[id] < cost[u]) {
+				cost[u] = cost[w] + costs[id];
+				next[u] = id;
+				zone[u] = zone[w];
+			}
+		}
+		if (cost[u] < infinity) seeds.push_back(u);
+	}
+
+	// Edges back give better routes to their sources, or none
+	for (int id : added) {
+		int u = sources[id], w = targets[id];
+		if (cost[w] + costs[id] < cost[u]) {
+			cost[u] = cost[w] + costs[id];
+			next[u] = id;
+			zone[u] = zone[w];
+			seeds.push_back(u);
+		}
+	}
+	for (int x : fixed) {
+		if (isSeed(x) && cost[x] > 0) {
+			cost[x] = 0;
+			next[x] = -1;
+			zone[x] = x;
+			seeds.push_back(x);
+		}
+	}
+
+	search(seeds);
+}
+
+/*
+ * @brief Cost of the route from v to the nearest safe zone,
+ * infinity if none can be reached
+ */
+double SafeZoneTable::getCost(const Vertex *v) const {
+	auto it = indexes.find(v);
+	return it == indexes.end() ? infinity : cost[it->second];
+}
+
+/*
+ * @brief First edge of the route from v to the nearest safe zone,
+ * nullptr if v is a safe zone or none can be reached
+ */
+Edge* SafeZoneTable::getNextHop(const Vertex *v) const {
+	auto it = indexes.find(v);
+	if (it == indexes.end() || next[it->second] < 0) return nullptr;
+	return edges[next[it->second]];
+}
+
+/*
+ * @brief The safe zone nearest to v, nullptr if none can be reached
+ */
+Vertex* SafeZoneTable::getSafeZone(const Vertex *v) const {
+	auto it = indexes.find(v);
+	if (it == indexes.end() || zone[it->second] < 0) return nullptr;
+	return vertices[zone[it->second]];
+}
+
+/*
+ * @brief Route from v to the nearest safe zone, v first,
+ * empty if none can be reached
+ */
+vector<Vertex*> SafeZoneTable::getRoute(const Vertex *v) const {
+	vector<Vertex*> route;
+	auto it = indexes.find(v);
+	if (it == indexes.end() || cost[it->second] == infinity) return route;
+
+	for (int u = it->second; u >= 0; u = next[u] < 0 ? -1 : targets[next[u]])
+		route.push_back(vertices[u]);
+	return route;
+}
+
+/*
+ * @brief Number of vertices that can reach a safe zone
+ */
+int SafeZoneTable::getNumCovered() const {
+	int covered = 0;
+	for (double c : cost)
+		if (c < infinity) ++covered;
+	return covered;
+}
+
+
+
+//////////////////
+// Flow Network //
+//////////////////
+
+/*
+ * Flow network over the clear edges of a CompactGraph: arc 2e is edge
+ * e, with its flow capacity and travel time, and arc 2e+1 its residual
+ * reverse. A super source feeds the region and the safe zones feed a
+ * super sink, both without limit. Extends Dinic's maximum flow to the
+ * cheapest one.
+ */
+class EvacuationNetwork : public FlowNetwork {
+	vector<double> costs;       // Per arc
+	vector<double> potential;   // Per vertex, keeps the reduced costs non negative
+
+	void addArc(int u, int v, int forward, double cost) {
+		FlowNetwork::addArc(u, v, forward, 0);
+		costs.push_back(cost);
+		costs.push_back(-cost);
+	}
+
+	/*
+	 * Whether arc a may carry more of the cheapest flow:
+	 * with room left, and on a shortest path
+	 */
+	bool cheapest(int a) const {
+		return capacity[a] > 0 && costs[a] + potential[to[a ^ 1]] - potential[to[a]] <= FLOW_COST_EPSILON;
+	}
+
+	/*
+	 * Dijkstra from the source over the reduced costs; moves the
+	 * potentials so the arcs of the shortest paths cost zero.
+	 * Returns whether the sink is still reachable.
+	 */
+	bool shortestPaths() {
+		using entry = pair<double, int>;
+		vector<double> dist(head.size(), infinity);
+		priority_queue<entry, vector<entry>, greater<entry>> q;
+		dist[source] = 0;
+		q.push({0, source});
+		while (!q.empty()) {
+			entry top = q.top();
+			q.pop();
+			int u = top.second;
+			if (top.first > dist[u]) continue;
+			for (int a = head[u]; a >= 0; a = next[a]) {
+				if (capacity[a] <= 0) continue;
+				int v = to[a];
+				double newdist = top.first + max(0.0, costs[a] + potential[u] - potential[v]);
+				if (newdist < dist[v]) {
+					dist[v] = newdist;
+					q.push({newdist, v});
+				}
+			}
+		}
+		if (dist[sink] == infinity) return false;
+		for (size_t v = 0; v < head.size(); ++v)
+			potential[v] += min(dist[v], dist[sink]);
+		return true;
+	}
+
+public:
+	EvacuationNetwork(const CompactGraph &graph, const vector<int> &region, const vector<int> &safeZones) :
+			FlowNetwork(graph.getNumVertices()) {
+		int n = graph.getNumVertices();
+		potential.assign(n + 2, 0);
+
+		// Edge arcs first, so that edge e is arc 2e
+		for (int v = 0; v < n; ++v) {
+			for (int e = graph.getFirstEdge(v); e < graph.getLastEdge(v); ++e)
+				addArc(v, graph.getTarget(e), getFlowCapacity(graph.getEdge(e)), graph.getCost(e, TRAVEL_TIME));
+		}
+		for (int v : region)
+			addArc(source, v, FLOW_UNLIMITED, 0);
+		for (int v : safeZones)
+			addArc(v, sink, FLOW_UNLIMITED, 0);
+	}
+
+	/*
+	 * Successive shortest paths: the cheapest flow of limit vehicles (the
+	 * most it can, if negative or unreachable), sent along the shortest
+	 * paths of the residual network, all those of the same cost at once
+	 */
+	int minCostFlow(int limit) {
+		int flow = 0;
+		while ((limit < 0 || flow < limit) && shortestPaths())
+			flow += blockingFlows(limit < 0 ? -1 : limit - flow, [this](int a) { return cheapest(a); });
+		return flow;
+	}
+
+	/*
+	 * Flow sent along edge e of the graph
+	 */
+	int getFlow(int e) const {
+		return capacity[2 * e + 1];
+	}
+};
+
+
+
+//////////////////
+// Evacuation ///
+//////////////////
+
+/*
+ * @brief Vehicles per hour edge e can still take: the room left on it,
+ * which frees up once per traversal at its current average speed
+ * (at most once a second)
+ */
+int getFlowCapacity(const Edge *e) {
+	int room = e->getMaxCapacity() - e->getActualCapacity();
+	if (room <= 0) return 0;
+	return (int)(room / max(e->getWeight(), 1.0 / 3600));
+}
+
+/*
+ * @brief (Private) Indexes in graph of the clear vertices of region
+ * that are not safe zones, and of the clear safe zones
+ */
+static void terminals(const CompactGraph &graph, const vector<Vertex*> &region, const vector<Vertex*> &safeZones,
+		vector<int> &sources, vector<int> &sinks) {
+	vector<char> safe(graph.getNumVertices(), 0);
+	for (Vertex *v : safeZones) {
+		int i = graph.getIndex(v);
+		if (i >= 0 && !safe[i]) {
+			safe[i] = 1;
+			sinks.push_back(i);
+		}
+	}
+	vector<char> added(graph.getNumVertices(), 0);
+	for (Vertex *v : region) {
+		int i = graph.getIndex(v);
+		if (i >= 0 && !safe[i] && !added[i]) {
+			added[i] = 1;
+			sources.push_back(i);
+		}
+	}
+}
+
+/*
+ * @brief Most vehicles per hour that can leave region for the
+ * safe zones (those of the region already being safe)
+ */
+int maxEvacuationFlow(const CompactGraph &graph, const vector<Vertex*> &region, const vector<Vertex*> &safeZones) {
+	vector<int> sources, sinks;
+	terminals(graph, region, safeZones, sources, sinks);
+	if (sources.empty() || sinks.empty()) return 0;
+	return EvacuationNetwork(graph, sources, sinks).maxFlow();
+}
+
+/*
+ * @brief Evacuation plan of vehicles per hour from region to the safe
+ * zones at the least total travel time, split into routes. Sends the
+ * most that can leave the region if vehicles is negative or too many.
+ */
+EvacuationPlan planEvacuation(const CompactGraph &graph, const vector<Vertex*> &region,
+		const vector<Vertex*> &safeZones, int vehicles) {
+	EvacuationPlan plan;
+	vector<int> sources, sinks;
+	terminals(graph, region, safeZones, sources, sinks);
+	if (sources.empty() || sinks.empty()) return plan;
+
+	plan.maxFlow = EvacuationNetwork(graph, sources, sinks).maxFlow();
+	EvacuationNetwork network(graph, sources, sinks);
+	plan.flow = network.minCostFlow(vehicles < 0 ? plan.maxFlow : min(vehicles, plan.maxFlow));
+
+	int n = graph.getNumVertices();
+	vector<int> flows(graph.getNumEdges());
+	for (int e = 0; e < graph.getNumEdges(); ++e) {
+		flows[e] = network.getFlow(e);
+		if (flows[e] == 0) continue;
+		plan.edgeFlows[graph.getEdge(e)] = flows[e];
+		plan.cost += flows[e] * graph.getCost(e, TRAVEL_TIME);
+	}
+
+	// Routes: from each source, follow the flow to the first safe zone
+	vector<char> safe(n, 0);
+	for (int v : sinks)
+		safe[v] = 1;
+	vector<int> out(n, 0), first(n);
+	for (int v = 0; v < n; ++v) {
+		first[v] = graph.getFirstEdge(v);
+		for (int e = graph.getFirstEdge(v); e < graph.getLastEdge(v); ++e)
+			out[v] += flows[e];
+	}
+	vector<int> onPath(n, -1); // Position in the current path
+
+	for (int origin : sources) {
+		while (out[origin] > 0) {
+			vector<int> path = {origin}, edges;
+			onPath[origin] = 0;
+			int v = origin;
+			while (!safe[v] && out[v] > 0) {
+				while (flows[first[v]] == 0) ++first[v];
+				int e = first[v], w = graph.getTarget(e);
+				edges.push_back(e);
+				if (onPath[w] < 0) {
+					onPath[w] = path.size();
+					path.push_back(w);
+					v = w;
+					continue;
+				}
+				// A cycle of flow moves nobody anywhere: cancel it
+				int bottleneck = FLOW_UNLIMITED;
+				for (size_t i = onPath[w]; i < edges.size(); ++i)
+					bottleneck = min(bottleneck, flows[edges[i]]);
+				for (size_t i = onPath[w]; i < edges.size(); ++i) {
+					flows[edges[i]] -= bottleneck;
+					out[path[i]] -= bottleneck;
+				}
+				for (size_t i = onPath[w] + 1; i < path.size(); ++i)
+					onPath[path[i]] = -1;
+				path.resize(onPath[w] + 1);
+				edges.resize(onPath[w]);
+				v = w;
+			}
+
+			EvacuationRoute route;
+			route.vehicles = FLOW_UNLIMITED;
+			for (int e : edges)
+				route.vehicles = min(route.vehicles, flows[e]);
+			for (size_t i = 0; i < edges.size(); ++i) {
+				flows[edges[i]] -= route.vehicles;
+				out[path[i]] -= route.vehicles;
+				route.edges.push_back(graph.getEdge(edges[i]));
+				route.time += graph.getCost(edges[i], TRAVEL_TIME);
+			}
+			for (int u : path) {
+				route.path.push_back(graph.getVertex(u));
+				onPath[u] = -1;
+			}
+			if (!edges.empty() && route.vehicles > 0) plan.routes.push_back(route);
+		}
+	}
+
+	sort(plan.routes.begin(), plan.routes.end(), [](const EvacuationRoute &a, const EvacuationRoute &b) {
+		return a.time < b.time;
+	});
+	return plan;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Graph.h"
+#include "CompactGraph.h"
+#include "GraphMirror.h"
+
+using namespace std;
+
+// Evacuation flows: reduced costs within this many hours count as zero
+#define FLOW_COST_EPSILON      1e-9
+
+//////////////////////////
+/// Class SafeZoneTable //
+//////////////////////////
+
+/**
+ * Evacuation table: for every vertex, the cost of the best route to
+ * the nearest of a set of safe zones (hospitals, shelters...) and the
+ * next edge to take on it. Built by one multi-source Dijkstra from all
+ * the safe zones at once, following the edges backwards.
+ *
+ * Only clear edges between clear vertices are used, and the table
+ * follows accidents and fixes as they happen (see Graph::addListener):
+ * - When an edge of the table's routes is lost, only the vertices
+ *   routed through it are searched again, from their neighbours.
+ * - When an edge comes back, the vertices it gives a better route are
+ *   improved, and from them whoever routes through them.
+ * Travel times are read when the table is built (or refreshed), not
+ * followed as capacities change. Vertices and edges added or removed
+ * after the table was built are not followed either: build it again.
+ * The table must not outlive its graph.
+ */
+class SafeZoneTable : GraphMirror {
+	Graph *graph;
+	int listener;
+	Metric metric;
+
+	vector<double> costs;           // Per edge
+	vector<char> safe;              // Per vertex
+
+	vector<double> cost;            // Per vertex, to the nearest safe zone
+	vector<int> next;               // Per vertex, first edge of its route, -1 if none
+	vector<int> zone;               // Per vertex, nearest safe zone, -1 if none
+
+	bool isSeed(int v) const;
+	void search(const vector<int> &seeds);
+	void changed(const vector<GraphChange> &changes);
+
+public:
+	SafeZoneTable(Graph *graph, const vector<Vertex*> &safeZones, Metric metric = DISTANCE);
+	~SafeZoneTable();
+	SafeZoneTable(const SafeZoneTable&) = delete;
+	SafeZoneTable &operator=(const SafeZoneTable&) = delete;
+
+	void refresh();
+
+	double getCost(const Vertex *v) const;
+	Edge *getNextHop(const Vertex *v) const;
+	Vertex *getSafeZone(const Vertex *v) const;
+	vector<Vertex*> getRoute(const Vertex *v) const;
+	int getNumCovered() const;
+};
+
+
+
+/*
+ * One route of an evacuation plan and the vehicles it carries
+ */
+struct EvacuationRoute {
+	vector<Vertex*> path;     // From a vertex of the region to a safe zone
+	vector<Edge*> edges;
+	int vehicles = 0;         // Per hour
+	double time = 0;          // Hours along the route
+};
+
+/*
+ * Evacuation of a region to a set of safe zones through the clear
+ * road network, each edge taking at most getFlowCapacity vehicles
+ */
+struct EvacuationPlan {
+	int maxFlow = 0;                  // Most vehicles per hour that can leave the region
+	int flow = 0;                     // Vehicles per hour the plan sends
+	double cost = 0;                  // Vehicle hours: vehicles times the time of their routes
+	unordered_map<Edge*, int> edgeFlows;
+	vector<EvacuationRoute> routes;   // Fastest first
+};
+
+///// ***** Flows
+int getFlowCapacity(const Edge *e);
+int maxEvacuationFlow(const CompactGraph &graph, const vector<Vertex*> &region, const vector<Vertex*> &safeZones);
+EvacuationPlan planEvacuation(const CompactGraph &graph, const vector<Vertex*> &region,
+		const vector<Vertex*> &safeZones, int vehicles = -1);
+/////
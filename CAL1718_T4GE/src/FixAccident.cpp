@@ -4,49 +4,54 @@
 // Functions Prototypes //
 //////////////////////////
 
-void fixIntersectionAccident();
-void fixRoadAccident();
+void fixIntersectionAccident(Graph *graph);
+void fixRoadAccident(Graph *graph);
+void fixAreaAccident(Graph *graph);
 
 /*
  * Fix Accident Menu UI
  */
-void fixAccident() {
+void fixAccident(Graph *graph) {
 	int option;
 
 	cout << "Fix accident" << endl << endl;
 
 	cout << "1 - Intersection accident" << endl;
-	cout << "2 - Road accident" << endl << endl;
+	cout << "2 - Road accident" << endl;
+	cout << "3 - Area accident" << endl << endl;
 
-	option = selectOption(2);
-	if (option == 3) return;
+	option = selectOption(3);
+	if (option == 4) return;
 
 	system("cls");
 
 	switch(option)
 	{
 	case 1:
-		fixIntersectionAccident();
+		fixIntersectionAccident(graph);
 		break;
 	case 2:
-		fixRoadAccident();
+		fixRoadAccident(graph);
+		break;
+	case 3:
+		fixAreaAccident(graph);
 		break;
 	}
 
 	system("cls");
-	return fixAccident();
+	return fixAccident(graph);
 }
 
 /*
  * Fix Node accident UI
  */
-void fixIntersectionAccident() {
+void fixIntersectionAccident(Graph *graph) {
 	Vertex *vertex = nullptr;
 
 	cout << "Fix an accident" << endl << endl;
 
 	// Get node
-	vertex = selectVertex(true);
+	vertex = selectVertex(graph, true);
 	if (vertex == nullptr) return;
 
 	// Fix node
@@ -57,16 +62,32 @@ void fixIntersectionAccident() {
 /*
  * Fix Edge accident UI
  */
-void fixRoadAccident() {
+void fixRoadAccident(Graph *graph) {
 	Edge *edge = nullptr;
 
 	cout << "Fix an accident" << endl << endl;
 
 	// Get edge
-	edge = selectEdge(true);
+	edge = selectEdge(graph, true);
 	if (edge == nullptr) return;
 
 	// Fix edge
 	edge->fix();
 	graph->rearrange();
 }
+
+/*
+ * Fix Area accident UI
+ */
+void fixAreaAccident(Graph *graph) {
+	cout << "Fix an accident" << endl << endl;
+
+	// Get area
+	vector<pair<double, double>> area = selectArea(graph);
+	if (area.empty()) return;
+
+	// Fix every node and road inside
+	int fixed = graph->fixArea(area);
+	cout << fixed << " nodes and roads fixed" << endl;
+	system("pause");
+}
@@ -0,0 +1,66 @@
+#include "FlowNetwork.h"
+
+/*
+ * @brief Network of size vertices, plus the super source and
+ * sink, without arcs
+ */
+FlowNetwork::FlowNetwork(int size) : source(size), sink(size + 1) {
+	head.assign(size + 2, -1);
+}
+
+/*
+ * @brief (Private) Adds the arc u -> v with capacity forward, and
+ * its reverse with capacity backward
+ * @return The index of the arc u -> v (its reverse is the next one)
+ */
+int FlowNetwork::addArc(int u, int v, int forward, int backward) {
+	to.push_back(v); capacity.push_back(forward); next.push_back(head[u]); head[u] = to.size() - 1;
+	to.push_back(u); capacity.push_back(backward); next.push_back(head[v]); head[v] = to.size() - 1;
+	return to.size() - 2;
+}
+
+int FlowNetwork::getSource() const {
+	return source;
+}
+
+int FlowNetwork::getSink() const {
+	return sink;
+}
+
+/*
+ * @brief Dinic's maximum flow from the source to the sink,
+ * which equals the minimum cut between them
+ */
+int FlowNetwork::maxFlow() {
+	return blockingFlows(-1, [this](int a) { return capacity[a] > 0; });
+}
+
+/*
+ * @brief After maxFlow: whether vertex u is reachable from the source in the
+ * residual network (the source's side of the closest minimum cut)
+ */
+bool FlowNetwork::reachedFromSource(int u) const {
+	return level[u] >= 0;
+}
+
+/*
+ * @brief After maxFlow: whether vertex u can reach the sink in the residual
+ * network (the sink's side of the closest minimum cut to the sink)
+ */
+bool FlowNetwork::reachesTheSink(int u) {
+	if (reachesSink.empty()) {
+		reachesSink.assign(head.size(), 0);
+		vector<int> queue = {sink};
+		reachesSink[sink] = 1;
+		for (size_t i = 0; i < queue.size(); ++i) {
+			int v = queue[i];
+			for (int a = head[v]; a >= 0; a = next[a]) {
+				if (capacity[a ^ 1] > 0 && !reachesSink[to[a]]) {
+					reachesSink[to[a]] = 1;
+					queue.push_back(to[a]);
+				}
+			}
+		}
+	}
+	return reachesSink[u];
+}
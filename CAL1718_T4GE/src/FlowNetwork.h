@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+using namespace std;
+
+#define FLOW_UNLIMITED         (numeric_limits<int>::max() / 2) // Capacity of arcs without limit
+
+//////////////////////////
+/// Class FlowNetwork ////
+//////////////////////////
+
+/**
+ * Integer flow network of vertices 0..size-1, plus a super source
+ * (size) and a super sink (size + 1), for Dinic's maximum flow. Arcs
+ * come in pairs: arc a and its residual reverse a ^ 1.
+ *
+ * The partitioner (see inertialFlow) cuts with it, and the evacuation
+ * planner (see planEvacuation) extends it to the cheapest flow, by
+ * running the blocking flows over the arcs it admits.
+ */
+class FlowNetwork {
+protected:
+	vector<int> head, next, to, capacity;
+	vector<int> level, current;
+	vector<char> reachesSink;
+	int source, sink;
+
+	int addArc(int u, int v, int forward, int backward);
+
+	/*
+	 * Levels of the vertices from the source over the arcs admitted,
+	 * for Dinic's algorithm. Returns whether the sink was reached.
+	 */
+	template <typename Admissible>
+	bool levels(Admissible admissible) {
+		level.assign(head.size(), -1);
+		vector<int> queue = {source};
+		level[source] = 0;
+		for (size_t i = 0; i < queue.size(); ++i) {
+			int u = queue[i];
+			for (int a = head[u]; a >= 0; a = next[a]) {
+				if (admissible(a) && level[to[a]] < 0) {
+					level[to[a]] = level[u] + 1;
+					queue.push_back(to[a]);
+				}
+			}
+		}
+		return level[sink] >= 0;
+	}
+
+	/*
+	 * Pushes up to flow from u to the sink along one path of
+	 * increasing levels. Returns the flow pushed.
+	 */
+	template <typename Admissible>
+	int augment(int u, int flow, Admissible admissible) {
+		if (u == sink) return flow;
+		for (int &a = current[u]; a >= 0; a = next[a]) {
+			int v = to[a];
+			if (admissible(a) && level[v] == level[u] + 1) {
+				int pushed = augment(v, min(flow, capacity[a]), admissible);
+				if (pushed > 0) {
+					capacity[a] -= pushed;
+					capacity[a ^ 1] += pushed;
+					return pushed;
+				}
+			}
+		}
+		return 0;
+	}
+
+	/*
+	 * Dinic's blocking flows from the source to the sink, up to limit
+	 * (none if negative), only through the arcs admitted (which must
+	 * have capacity left)
+	 */
+	template <typename Admissible>
+	int blockingFlows(int limit, Admissible admissible) {
+		int flow = 0;
+		while ((limit < 0 || flow < limit) && levels(admissible)) {
+			current = head;
+			while (int pushed = augment(source, limit < 0 ? FLOW_UNLIMITED : limit - flow, admissible)) {
+				flow += pushed;
+				if (limit >= 0 && flow >= limit) break;
+			}
+		}
+		reachesSink.clear();
+		return flow;
+	}
+
+public:
+	explicit FlowNetwork(int size);
+
+	int getSource() const;
+	int getSink() const;
+
+	int maxFlow();
+	bool reachedFromSource(int u) const;
+	bool reachesTheSink(int u);
+};
@@ -1,8 +1,13 @@
 #include "Graph.h"
+#include "SearchAlgorithms.h"
+#include "Random.h"
 
 #include <iostream>
 #include <deque>
+#include <unordered_set>
 #include <algorithm>
+#include <thread>
+#include <chrono>
 #include <math.h>
 
 
@@ -17,14 +22,35 @@ bool Graph::withinBounds(int x, int y) const {
 	return x >= 0 && y >= 0 && x <= width && y <= height;
 }
 
+/*
+ * @brief (Private) Appends vertex v to set
+ * (vertexSet or accidentedVertexSet), keeping its position
+ */
+void Graph::insertVertex(vector<Vertex*> &set, Vertex *v) {
+	v->setIndex = set.size();
+	set.push_back(v);
+}
+
+/*
+ * @brief (Private) Removes vertex v from set in constant
+ * time, moving the last vertex of the set to its position.
+ * v is in set.
+ */
+void Graph::eraseVertex(vector<Vertex*> &set, Vertex *v) {
+	Vertex *last = set.back();
+	set[v->setIndex] = last;
+	last->setIndex = v->setIndex;
+	set.pop_back();
+}
+
 /*
  * @brief (Private) Moves vertex v from
  * accidentedVertexSet to vertexSet.
  * v is in accidentedVertexSet.
  */
 void Graph::moveToVertexSet(Vertex *v) {
-	accidentedVertexSet.erase(remove(accidentedVertexSet.begin(),accidentedVertexSet.end(), v), accidentedVertexSet.end());
-	vertexSet.push_back(v);
+	eraseVertex(accidentedVertexSet, v);
+	insertVertex(vertexSet, v);
 	update();
 }
 
@@ -34,16 +60,72 @@ void Graph::moveToVertexSet(Vertex *v) {
  * v is in vertexSet.
  */
 void Graph::moveToAccidentedVertexSet(Vertex *v) {
-	vertexSet.erase(remove(vertexSet.begin(),vertexSet.end(), v),vertexSet.end());
-	accidentedVertexSet.push_back(v);
+	eraseVertex(vertexSet, v);
+	insertVertex(accidentedVertexSet, v);
 	update();
 }
 
+/*
+ * @brief (Private) Starts a bulk operation: GraphViewer
+ * updates are held back until the matching endBulk
+ */
+void Graph::beginBulk() {
+	++refresh.deferred;
+}
+
+/*
+ * @brief (Private) Ends a bulk operation, updating
+ * GraphViewer once if anything asked for it meanwhile,
+ * and reporting all its changes to the listeners at once
+ */
+void Graph::endBulk() {
+	if (--refresh.deferred > 0) return;
+
+	if (!refresh.changes.empty()) {
+		vector<GraphChange> changes;
+		changes.swap(refresh.changes);
+		for (auto &pair : listeners)
+			pair.second(changes);
+	}
+
+	if (!refresh.pending) return;
+	refresh.pending = false;
+	update();
+}
+
+/*
+ * @brief (Private) Reports a change to every listener,
+ * or holds it back until the bulk operation in progress ends
+ */
+void Graph::notify(GraphEvent event, Vertex *v, Edge *e) const {
+	if (refresh.deferred > 0) {
+		refresh.changes.push_back({event, v, e});
+		return;
+	}
+	vector<GraphChange> changes = {{event, v, e}};
+	for (auto &pair : listeners)
+		pair.second(changes);
+}
+
+/*
+ * @brief (Private) Sorts again the edges of the vertices whose
+ * accidents and fixes moved them out of order (see
+ * Vertex::eraseEdge), before the next search
+ */
+void Graph::sortAdjacencies() const {
+	for (int id : unsortedAdj) {
+		Vertex *v = findVertex(id);
+		if (v != nullptr && !v->adjSorted) v->sortAdj();
+	}
+	unsortedAdj.clear();
+}
+
 /**
  * @brief Clear previous invocation of a pathing
  * algorithm.
  */
 void Graph::clear() const {
+	sortAdjacencies();
 	for (auto v : vertexSet) {
 		v->priority = 0;
 		v->cost = 0;
@@ -64,6 +146,11 @@ void Graph::clear() const {
  * @brief Updates the graph window with the new info
  */
 void Graph::update() const {
+	if (gv == nullptr) return;
+	if (refresh.deferred > 0) {
+		refresh.pending = true;
+		return;
+	}
 	gv->rearrange();
 }
 
@@ -72,6 +159,7 @@ void Graph::update() const {
  * @brief Updates the graph window with the new info
  */
 void Graph::rearrange() const {
+	if (gv == nullptr) return;
 	gv->rearrange();
 }
 
@@ -80,7 +168,7 @@ void Graph::rearrange() const {
  * @brief Define the color of a particular vertex
  */
 bool Graph::setVertexColor(Vertex *v, string color) const {
-	if (v == nullptr) return false;
+	if (v == nullptr || gv == nullptr) return false;
 	return gv->setVertexColor(v->getID(), color);
 }
 
@@ -104,7 +192,7 @@ bool Graph::setVertexDefaultColor(Vertex *v) const {
  * @brief Define the color of a particular edge
  */
 bool Graph::setEdgeColor(Edge *e, string color) const {
-	if (e == nullptr) return false;
+	if (e == nullptr || gv == nullptr) return false;
 	return gv->setEdgeColor(e->getID(), color);
 }
 
@@ -170,6 +258,7 @@ void Graph::resetEdgeColors() const {
  * its boundaries.
  */
 void Graph::showBoundaries() const {
+	if (gv == nullptr) return;
 	int ID = -1337;
 
 	// Corners
@@ -218,6 +307,7 @@ void Graph::showBoundaries() const {
  */
 void Graph::showAllVertexLabels() const {
 	show.vertexLabels = true;
+	if (gv == nullptr) return;
 	for (auto v : vertexSet) {
 		gv->setVertexLabel(v->getID(), to_string(v->getID()));
 	}
@@ -232,6 +322,7 @@ void Graph::showAllVertexLabels() const {
  */
 void Graph::hideAllVertexLabels() const {
 	show.vertexLabels = false;
+	if (gv == nullptr) return;
 	for (auto v : vertexSet) {
 		gv->clearVertexLabel(v->getID());
 	}
@@ -246,6 +337,7 @@ void Graph::hideAllVertexLabels() const {
  */
 void Graph::showAllEdgeLabels() const {
 	show.edgeLabels = true;
+	if (gv == nullptr) return;
 	for (auto v : vertexSet) {
 		for (auto e : v->adj) {
 			gv->setEdgeLabel(e->getID(), to_string(e->getID()));
@@ -270,6 +362,7 @@ void Graph::showAllEdgeLabels() const {
  */
 void Graph::hideAllEdgeLabels() const {
 	show.edgeLabels = false;
+	if (gv == nullptr) return;
 	for (auto v : vertexSet) {
 		for (auto e : v->adj) {
 			gv->clearEdgeLabel(e->getID());
@@ -301,6 +394,7 @@ void Graph::showEdgeSimulationLabels() const {
 	};
 
 	show.edgeLabels = true;
+	if (gv == nullptr) return;
 	for (auto v : vertexSet) {
 		for (auto e : v->adj) {
 			gv->setEdgeLabel(e->getID(), lambda(e));
@@ -322,22 +416,31 @@ void Graph::showEdgeSimulationLabels() const {
 
 
 bool Graph::setBackground(string path) const {
+	if (gv == nullptr) return false;
 	return gv->setBackground(path);
 }
 
 bool Graph::straightEdges() const {
+	if (gv == nullptr) return false;
 	return gv->defineEdgeCurved(false);
 }
 
+/*
+ * @brief Checks if the graph has a GraphViewer window
+ */
+bool Graph::hasViewer() const {
+	return gv != nullptr;
+}
+
 
 
 ///// ***** Animation
 
 void Graph::animatePath(vector<Vertex*> path, int interval, color color, bool last) const {
-	if (path.empty()) return;
+	if (path.empty() || gv == nullptr) return;
 
 	for (unsigned int i = 1; i < path.size(); ++i) {
-		if (i > 1 && interval > 5) Sleep(interval);
+		if (i > 1 && interval > 5) this_thread::sleep_for(chrono::milliseconds(interval));
 		setVertexColor(path.at(i), color);
 		setEdgeColor(path.at(i - 1)->findEdge(path.at(i)), color);
 		rearrange();
@@ -348,10 +451,10 @@ void Graph::animatePath(vector<Vertex*> path, int interval, color color, bool la
 }
 
 void Graph::clearPath(vector<Vertex*> path, int interval, bool last) const {
-	if (path.empty()) return;
+	if (path.empty() || gv == nullptr) return;
 
 	for (unsigned int i = 1; i < path.size(); ++i) {
-		if (i > 1 && interval > 5) Sleep(interval);
+		if (i > 1 && interval > 5) this_thread::sleep_for(chrono::milliseconds(interval));
 		setVertexDefaultColor(path.at(i));
 		setEdgeDefaultColor(path.at(i - 1)->findEdge(path.at(i)));
 		rearrange();
@@ -366,8 +469,12 @@ void Graph::clearPath(vector<Vertex*> path, int interval, bool last) const {
 /*
  * @brief Graph constructor, taking
  * display width and display height in grid entries
+ * @param viewer Whether to open a GraphViewer window. A graph
+ * without one (headless) runs every operation, displaying nothing.
  */
-Graph::Graph(int width, int height, double scale): width(width), height(height), scale(scale) {
+Graph::Graph(int width, int height, double scale, bool viewer): width(width), height(height), scale(scale) {
+	gv = nullptr;
+	if (!viewer) return;
 	gv = new GraphViewer(width, height, false);
 	gv->createWindow(GRAPH_VIEWER_WIDTH, GRAPH_VIEWER_HEIGHT);
 	gv->defineVertexColor(VERTEX_CLEAR_COLOR);
@@ -375,20 +482,58 @@ Graph::Graph(int width, int height, double scale): width(width), height(height),
 }
 
 /*
- * @brief Graph destructor, destroys
- * GraphViewer, vertices and edges
+ * @brief Graph destructor, destroys GraphViewer, vertices,
+ * edges, subroads and roads. A subroad is shared by an edge
+ * and its reverse, and a road by its subroads: each is
+ * deleted once.
  */
 Graph::~Graph() {
-	gv->closeWindow();
+	if (gv != nullptr) gv->closeWindow();
+
+	unordered_set<Subroad*> subroads;
+	unordered_set<Road*> roads;
+	for (auto &pair : roadsInfo)
+		roads.insert(pair.second);
+	for (auto &pair : subRoadsInfo) {
+		Subroad *subroad = pair.second->subroad;
+		if (subroad == nullptr) continue;
+		subroads.insert(subroad);
+		if (subroad->getRoad() != nullptr) roads.insert(subroad->getRoad());
+	}
+
 	for (auto vertex : vertexSet) {
 		delete vertex;
 	}
 	for (auto vertex : accidentedVertexSet) {
 		delete vertex;
 	}
+	for (auto subroad : subroads) {
+		delete subroad;
+	}
+	for (auto road : roads) {
+		delete road;
+	}
 	delete gv;
 }
 
+/*
+ * @brief Registers a function called after every accident
+ * or fix of a vertex or edge, and every change of the weight
+ * of an edge, for whatever is kept over the graph (indexes,
+ * caches...) to follow its state. The changes of a bulk
+ * operation (accidentVertices, accidentArea...) are reported
+ * together, in one call, when it ends.
+ * @return The listener's id, for removeListener
+ */
+int Graph::addListener(GraphListener listener) {
+	listeners[nextListener] = listener;
+	return nextListener++;
+}
+
+void Graph::removeListener(int id) {
+	listeners.erase(id);
+}
+
 /*
  * @brief Adds a vertex with the given data to the
  * appropriate vertex set of the graph
@@ -425,19 +570,28 @@ bool Graph::addVertex(Vertex* v) {
 	} else {
 		int id = v->getID();
 		v->_sgraph(this);
+		vertexIds[id] = v;
 		if (v->isAccidented()) {
-			accidentedVertexSet.push_back(v);
-			gv->setVertexColor(id, ACCIDENTED_COLOR);
+			insertVertex(accidentedVertexSet, v);
 		} else {
-			vertexSet.push_back(v);
+			insertVertex(vertexSet, v);
 		}
-		gv->addNode(id, v->getX(), v->getY());
 
-		// * Set Vertex Label
-		if (show.vertexLabels)
-			gv->setVertexLabel(id, to_string(id));
+		if (gv != nullptr) {
+			gv->addNode(id, v->getX(), v->getY());
 
-		gv->setVertexSize(id, VERTEX_SIZE);
+			// * Set Vertex Color
+			if (v->isAccidented())
+				gv->setVertexColor(id, ACCIDENTED_COLOR);
+
+			// * Set Vertex Label
+			if (show.vertexLabels)
+				gv->setVertexLabel(id, to_string(id));
+
+			gv->setVertexSize(id, VERTEX_SIZE);
+		}
+
+		spatialIndex.insert(v);
 
 		// No graph->update()
 		return true;
@@ -457,17 +611,9 @@ Vertex* Graph::findVertex(int id) const {
  * @return The vertex if found, nullptr otherwise
  */
 Vertex* Graph::getVertex(int id) const {
-	const auto getId = [&id](Vertex *v) -> int { return v->getID() == id; };
-
-	// Look for vertex in vertexSet
-	auto it = find_if(vertexSet.cbegin(), vertexSet.cend(), getId);
-	if (it != vertexSet.cend())
-		return *it;
-
-	// Look for vertex in accidentedVertexSet
-	it = find_if(accidentedVertexSet.cbegin(), accidentedVertexSet.cend(), getId);
-	if (it != accidentedVertexSet.cend())
-		return *it;
+	auto it = vertexIds.find(id);
+	if (it != vertexIds.cend())
+		return it->second;
 
 	// Vertex not found
 	return nullptr;
@@ -542,6 +688,13 @@ vector<Vertex*> Graph::getPath(Vertex* origin, Vertex* dest) const {
 	return res;
 }
 
+/*
+ * @brief Meters per unit of the vertices' coordinates
+ */
+double Graph::getScale() const {
+	return scale;
+}
+
 /* @brief Computes the distance between vertices
  * v1 and v2.
  * @throws invalid_argument if either Vertex is nullptr
@@ -618,25 +771,303 @@ void Graph::removeVertex(int id) {
 }
 
 /*
- * @brief Removes a vertex v from the graph
+ * @brief Removes a vertex v from the graph, along with
+ * the subroads leaving or reaching it (see removeSubroad).
+ * Linear in the number of edges, to find those reaching it.
  * @throws invalid_argument if Vertex is nullptr
  */
 void Graph::removeVertex(Vertex* v) {
 	if (v == nullptr) {
 		throw std::invalid_argument("Vertex not found");
 	}
+	vector<int> incident;
+	for (auto &pair : subRoadsInfo) {
+		if (pair.second->getSource() == v || pair.second->getDest() == v)
+			incident.push_back(pair.first);
+	}
+	for (int eid : incident) {
+		// The reverse of an earlier edge may already be gone
+		Edge *e = findEdge(eid);
+		if (e != nullptr) removeSubroad(e);
+	}
+
+	int id = v->getID();
+	spatialIndex.remove(v);
+	vertexIds.erase(id);
 	if (v->isAccidented()) {
-		auto it = find(accidentedVertexSet.begin(), accidentedVertexSet.end(), v);
-		delete v;
-		accidentedVertexSet.erase(it);
+		eraseVertex(accidentedVertexSet, v);
 	} else {
-		int id = v->getID();
-		auto it = find(vertexSet.begin(), vertexSet.end(), v);
-		delete v;
-		vertexSet.erase(it);
-		gv->removeNode(id);
-		// No graph->update()
+		eraseVertex(vertexSet, v);
 	}
+	delete v;
+	if (gv != nullptr) gv->removeNode(id);
+	// No graph->update()
+}
+
+/*
+ * @brief Builds the spatial indexes over the coordinates
+ * of all vertices and the segments of all edges.
+ * Vertices and edges added or removed afterwards
+ * are kept in the indexes.
+ */
+void Graph::buildSpatialIndex() {
+	spatialIndex.build(getAllVertexSet(), width, height);
+	edgeIndex.build(spatialIndex.getCellSize(), width, height);
+	for (auto &pair : subRoadsInfo)
+		edgeIndex.insert(pair.second);
+}
+
+/*
+ * @brief (Auxiliary) Position of point (x, y) along a Hilbert
+ * curve filling a side x side square, side a power of 2
+ */
+static long long hilbertIndex(long long x, long long y, long long side) {
+	long long d = 0;
+	for (long long s = side / 2; s > 0; s /= 2) {
+		long long rx = (x & s) > 0, ry = (y & s) > 0;
+		d += s * s * ((3 * rx) ^ ry);
+		// Rotate the quadrant
+		if (ry == 0) {
+			if (rx == 1) {
+				x = side - 1 - x;
+				y = side - 1 - y;
+			}
+			swap(x, y);
+		}
+	}
+	return d;
+}
+
+/*
+ * @brief Renumbers the vertices in memory so that vertices close on the
+ * map are close in memory: the vertex sets (and so CompactGraph indexes)
+ * follow the given order, each vertex is reallocated in that order,
+ * and adjacency lists are sorted by the position of their destination.
+ *
+ * Vertex IDs, and so the GraphViewer nodes, are left unchanged. Vertex
+ * pointers held outside the graph are invalidated: look vertices up by ID.
+ * Best called right after loading, see loadMap.
+ */
+void Graph::reorderVertices(VertexOrder order) {
+	vector<Vertex*> all = getAllVertexSet();
+	int n = all.size();
+	vector<long long> key(n);
+
+	if (order == ID_ORDER) {
+		for (int i = 0; i < n; ++i)
+			key[i] = all[i]->getID();
+	}
+	else if (order == HILBERT_ORDER) {
+		long long side = 1;
+		while (side < max(width, height) + 1) side *= 2;
+		for (int i = 0; i < n; ++i)
+			key[i] = hilbertIndex(all[i]->getX(), all[i]->getY(), side);
+	}
+	else if (order == BFS_ORDER) {
+		unordered_map<Vertex*, int> position;
+		for (int i = 0; i < n; ++i)
+			position[all[i]] = i;
+
+		// Neighbours in either direction, through any edge
+		vector<vector<int>> neighbours(n);
+		for (int i = 0; i < n; ++i) {
+			for (auto list : {&all[i]->adj, &all[i]->accidentedAdj}) {
+				for (Edge *e : *list) {
+					auto it = position.find(e->dest);
+					if (it == position.end()) continue;
+					neighbours[i].push_back(it->second);
+					neighbours[it->second].push_back(i);
+				}
+			}
+		}
+
+		// One search per component, from its first vertex as loaded
+		vector<int> byID(n);
+		for (int i = 0; i < n; ++i)
+			byID[i] = i;
+		sort(byID.begin(), byID.end(), [&](int a, int b) { return all[a]->getID() < all[b]->getID(); });
+
+		key.assign(n, -1);
+		long long next = 0;
+		deque<int> q;
+		for (int start : byID) {
+			if (key[start] >= 0) continue;
+			key[start] = next++;
+			q.push_back(start);
+			while (!q.empty()) {
+				int v = q.front();
+				q.pop_front();
+				for (int w : neighbours[v]) {
+					if (key[w] < 0) {
+						key[w] = next++;
+						q.push_back(w);
+					}
+				}
+			}
+		}
+	}
+
+	vector<int> sorted(n);
+	for (int i = 0; i < n; ++i)
+		sorted[i] = i;
+	stable_sort(sorted.begin(), sorted.end(), [&](int a, int b) {
+		return key[a] < key[b] || (key[a] == key[b] && all[a]->getID() < all[b]->getID());
+	});
+
+	// Reallocate the vertices in the new order
+	unordered_map<Vertex*, Vertex*> relocated;
+	vector<Vertex*> vertices;
+	for (int i : sorted) {
+		Vertex *old = all[i];
+		Vertex *v = new Vertex(old->id, old->x, old->y, old->accidented);
+		v->graph = this;
+		v->adj = move(old->adj);
+		v->accidentedAdj = move(old->accidentedAdj);
+		relocated[old] = v;
+		v->rank = vertices.size();
+		vertices.push_back(v);
+	}
+
+	vertexSet.clear();
+	accidentedVertexSet.clear();
+	for (Vertex *v : vertices) {
+		for (auto list : {&v->adj, &v->accidentedAdj}) {
+			for (Edge *e : *list) {
+				e->source = v;
+				auto it = relocated.find(e->dest);
+				if (it != relocated.end()) e->dest = it->second;
+			}
+		}
+		v->sortAdj();
+		vertexIds[v->getID()] = v;
+		if (v->isAccidented()) insertVertex(accidentedVertexSet, v);
+		else insertVertex(vertexSet, v);
+	}
+
+	for (Vertex *old : all)
+		delete old;
+
+	buildSpatialIndex();
+}
+
+/*
+ * @brief Approximate memory (bytes) held by the graph: vertices, edges,
+ * subroads, roads, their indexes and the spatial indexes. Allocator
+ * overheads are estimated, so use it to compare graphs, not as exact.
+ */
+size_t Graph::getMemoryUsage() const {
+	static const size_t node = 4 * sizeof(void*); // Overhead of a map or hash table entry
+
+	size_t bytes = sizeof(Graph);
+	for (auto set : {&vertexSet, &accidentedVertexSet}) {
+		bytes += set->capacity() * sizeof(Vertex*);
+		for (Vertex *v : *set)
+			bytes += sizeof(Vertex) + (v->adj.capacity() + v->accidentedAdj.capacity()) * sizeof(Edge*);
+	}
+	bytes += vertexIds.size() * (node + sizeof(int) + sizeof(Vertex*));
+
+	// Each subroad: its edge (two if bothways), its entry in its road and the indexes
+	bytes += subRoadsInfo.size() * (2 * sizeof(Edge) + sizeof(Subroad) + 2 * sizeof(Edge*) + sizeof(double)
+			+ node + sizeof(int) + sizeof(Edge*));
+	for (auto &road : roadsInfo)
+		bytes += sizeof(Road) + 2 * (road.first.capacity() + node + sizeof(string) + sizeof(Road*));
+
+	// Spatial indexes: one entry per vertex and a few per edge
+	bytes += getTotalVertices() * sizeof(Vertex*) + subRoadsInfo.size() * 4 * sizeof(Edge*);
+	return bytes;
+}
+
+/*
+ * @brief Returns the vertex closest to the point (x, y)
+ * @param maybeAccidented If the vertex may be accidented
+ * @return The vertex, or nullptr if there is none
+ */
+Vertex* Graph::findNearestVertex(double x, double y, bool maybeAccidented) const {
+	if (maybeAccidented)
+		return spatialIndex.nearest(x, y);
+	return spatialIndex.nearest(x, y, [](Vertex *v) { return !v->isAccidented(); });
+}
+
+/*
+ * @brief Returns the k vertices closest to the point (x, y),
+ * closest first
+ * @param maybeAccidented If the vertices may be accidented
+ */
+vector<Vertex*> Graph::findNearestVertices(double x, double y, int k, bool maybeAccidented) const {
+	if (maybeAccidented)
+		return spatialIndex.nearest(x, y, k);
+	return spatialIndex.nearest(x, y, k, [](Vertex *v) { return !v->isAccidented(); });
+}
+
+/*
+ * @brief Returns all vertices inside the rectangle with
+ * corners (x1, y1) and (x2, y2)
+ * @param maybeAccidented If the vertices may be accidented
+ */
+vector<Vertex*> Graph::findVerticesInRange(double x1, double y1, double x2, double y2, bool maybeAccidented) const {
+	if (maybeAccidented)
+		return spatialIndex.range(x1, y1, x2, y2);
+	return spatialIndex.range(x1, y1, x2, y2, [](Vertex *v) { return !v->isAccidented(); });
+}
+
+/*
+ * @brief Returns all vertices inside the polygon with the
+ * given (x, y) corners, in order, by the even-odd rule
+ * @param maybeAccidented If the vertices may be accidented
+ */
+vector<Vertex*> Graph::findVerticesInPolygon(const vector<pair<double, double>> &polygon, bool maybeAccidented) const {
+	vector<Vertex*> inside;
+	if (polygon.size() < 3) return inside;
+
+	double x1 = polygon[0].first, x2 = x1;
+	double y1 = polygon[0].second, y2 = y1;
+	for (auto &corner : polygon) {
+		x1 = min(x1, corner.first);
+		x2 = max(x2, corner.first);
+		y1 = min(y1, corner.second);
+		y2 = max(y2, corner.second);
+	}
+
+	for (Vertex *v : findVerticesInRange(x1, y1, x2, y2, maybeAccidented)) {
+		bool in = false;
+		for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+			double xi = polygon[i].first, yi = polygon[i].second;
+			double xj = polygon[j].first, yj = polygon[j].second;
+			if ((yi > v->getY()) != (yj > v->getY())
+					&& v->getX() < xi + (xj - xi) * (v->getY() - yi) / (yj - yi))
+				in = !in;
+		}
+		if (in) inside.push_back(v);
+	}
+	return inside;
+}
+
+/*
+ * @brief Finds the point of the road network closest to the
+ * point (x, y): the closest edge, how far along it the point
+ * lies and the point itself
+ * @param maybeAccidented If the edge (or its endpoints) may be accidented
+ */
+EdgeSnap Graph::snapToEdge(double x, double y, bool maybeAccidented) const {
+	EdgeSnap snap;
+	double t;
+
+	if (maybeAccidented)
+		snap.edge = edgeIndex.nearest(x, y, t);
+	else
+		snap.edge = edgeIndex.nearest(x, y, t, [](Edge *e) {
+			return !e->isAccidented() && !e->getSource()->isAccidented() && !e->getDest()->isAccidented();
+		});
+
+	if (snap.edge == nullptr)
+		return snap;
+
+	Vertex *a = snap.edge->getSource(), *b = snap.edge->getDest();
+	snap.x = a->getX() + t * (b->getX() - a->getX());
+	snap.y = a->getY() + t * (b->getY() - a->getY());
+	snap.offset = t * snap.edge->getDistance();
+	snap.distance = scale * sqrt((snap.x - x) * (snap.x - x) + (snap.y - y) * (snap.y - y));
+	return snap;
 }
 
 /*
@@ -670,9 +1101,10 @@ bool Graph::addEdge(int eid, Vertex* vsource, Vertex* vdest,
 		throw std::logic_error("Repeated edge id");
 	}
 	Edge* e = new Edge(eid, vsource, vdest, subroad, accidented);
-	subRoadsInfo.insert({eid, e});
 	// Delegate to vertex
 	if (vsource->addEdge(e)) {
+		subRoadsInfo.insert({eid, e});
+		edgeIndex.insert(e);
 		return true;
 	} else {
 		delete e;
@@ -697,7 +1129,12 @@ bool Graph::addEdge(Edge *e) {
 		throw std::logic_error("Repeated edge id");
 	}
 	// Delegate to vertex
-	return vsource->addEdge(e);
+	if (vsource->addEdge(e)) {
+		subRoadsInfo.insert({e->getID(), e});
+		edgeIndex.insert(e);
+		return true;
+	}
+	return false;
 }
 
 /*
@@ -713,18 +1150,10 @@ Edge* Graph::findEdge(int eid) const {
  * @return The edge pointer, or nullptr if not found
  */
 Edge* Graph::getEdge(int eid) const {
-	// Look for the edge in vertexSet first
-	// Delegate to vertices
-	for (auto vertex : vertexSet) {
-		Edge* e = vertex->getEdge(eid);
-		if (e != nullptr)
-			return e;
-	}
-	for (auto vertex : accidentedVertexSet) {
-		Edge* e = vertex->getEdge(eid);
-		if (e != nullptr)
-			return e;
-	}
+	// Look the edge up in the edge index
+	auto it = subRoadsInfo.find(eid);
+	if (it != subRoadsInfo.end())
+		return it->second;
 	return nullptr;
 }
 
@@ -803,23 +1232,335 @@ void Graph::removeEdge(Edge* e) {
 	e->getSource()->removeEdge(e);
 }
 
+
+
+/*
+ * @brief Causes an accident on every vertex of the set,
+ * as accidentVertex, updating GraphViewer only once
+ * @return The number of vertices previously clear
+ */
+int Graph::accidentVertices(const vector<Vertex*> &vertices) {
+	int changed = 0;
+	beginBulk();
+	for (Vertex *v : vertices) {
+		if (v != nullptr && v->accident()) ++changed;
+	}
+	endBulk();
+	return changed;
+}
+
+/*
+ * @brief Fixes every vertex of the set, as fixVertex,
+ * updating GraphViewer only once
+ * @return The number of vertices previously accidented
+ */
+int Graph::fixVertices(const vector<Vertex*> &vertices) {
+	int changed = 0;
+	beginBulk();
+	for (Vertex *v : vertices) {
+		if (v != nullptr && v->fix()) ++changed;
+	}
+	endBulk();
+	return changed;
+}
+
+/*
+ * @brief Causes an accident on every edge of the set,
+ * as accidentEdge, updating GraphViewer only once
+ * @return The number of edges previously clear
+ */
+int Graph::accidentEdges(const vector<Edge*> &edges) {
+	int changed = 0;
+	beginBulk();
+	for (Edge *e : edges) {
+		if (e != nullptr && e->accident()) ++changed;
+	}
+	endBulk();
+	return changed;
+}
+
+/*
+ * @brief Fixes every edge of the set, as fixEdge,
+ * updating GraphViewer only once
+ * @return The number of edges previously accidented
+ */
+int Graph::fixEdges(const vector<Edge*> &edges) {
+	int changed = 0;
+	beginBulk();
+	for (Edge *e : edges) {
+		if (e != nullptr && e->fix()) ++changed;
+	}
+	endBulk();
+	return changed;
+}
+
+/*
+ * @brief Closes an area: causes an accident on every vertex
+ * inside the polygon (see findVerticesInPolygon), and so on
+ * the edges leaving them, updating GraphViewer only once
+ * @return The number of vertices previously clear
+ */
+int Graph::accidentArea(const vector<pair<double, double>> &polygon) {
+	return accidentVertices(findVerticesInPolygon(polygon, false));
+}
+
+/*
+ * @brief Reopens an area: fixes every vertex inside the
+ * polygon and every edge leaving them, updating
+ * GraphViewer only once
+ * @return The number of vertices and edges previously accidented
+ */
+int Graph::fixArea(const vector<pair<double, double>> &polygon) {
+	vector<Vertex*> vertices = findVerticesInPolygon(polygon);
+	vector<Edge*> edges;
+	for (Vertex *v : vertices) {
+		edges.insert(edges.end(), v->accidentedAdj.begin(), v->accidentedAdj.end());
+	}
+
+	beginBulk();
+	int changed = fixEdges(edges) + fixVertices(vertices);
+	endBulk();
+	return changed;
+}
+
+
+
+/*
+ * @brief Returns the road with the given name
+ * @return The road, or nullptr if not found
+ */
+Road* Graph::findRoad(const string &name) const {
+	auto it = roadsInfo.find(name);
+	if (it != roadsInfo.end())
+		return it->second;
+	return nullptr;
+}
+
+/*
+ * @brief Adds a road, with no subroads yet, to the
+ * road information and to the road search index
+ * @return False if a road with the same name already existed
+ * @throws invalid_argument if Road is nullptr
+ */
+bool Graph::addRoad(Road *road) {
+	if (road == nullptr) {
+		throw std::invalid_argument("Road not found");
+	}
+	if (!roadsInfo.insert({road->getName(), road}).second)
+		return false;
+	roadsIndex.insert({normalizeText(road->getName()), road});
+	return true;
+}
+
+/*
+ * @brief Adds a subroad of road between vertices v1 and v2,
+ * with an edge from v1 to v2 and, if the road is bidirectional,
+ * its reverse edge. Edge ids follow the highest in the graph.
+ * The subroad is appended to the road, whose total distance
+ * is updated.
+ * @return The edge from v1 to v2, nullptr if one already existed
+ * @throws invalid_argument if the Road or either Vertex is nullptr
+ */
+Edge* Graph::addSubroad(Road *road, Vertex *v1, Vertex *v2) {
+	if (road == nullptr) {
+		throw std::invalid_argument("Road not found");
+	}
+	if (v1 == nullptr || v2 == nullptr) {
+		throw std::invalid_argument("Vertex not found");
+	}
+	if (v1->getEdge(v2) != nullptr || (road->isBidirectional() && v2->getEdge(v1) != nullptr))
+		return nullptr;
+
+	int eid = subRoadsInfo.empty() ? 1 : subRoadsInfo.rbegin()->first + 1;
+	Subroad *subroad = new Subroad(distance(v1, v2), road);
+	addEdge(eid, v1, v2, subroad);
+	Edge *edge = getEdge(eid);
+	Edge *reverse = nullptr;
+	if (road->isBidirectional()) {
+		addEdge(eid + 1, v2, v1, subroad);
+		reverse = getEdge(eid + 1);
+	}
+
+	road->addEdges(edge, reverse);
+	road->updateTotalDistance();
+	maxSpeed = max(maxSpeed, road->getMaxSpeed());
+	return edge;
+}
+
+/*
+ * @brief Removes the subroad of edge e: the edge itself
+ * and its reverse edge, if any, which share the subroad.
+ * The subroad is dropped from its road, whose total
+ * distance is updated. A road left without edges is deleted
+ * too unless it is in the road information (loadMap keeps
+ * there one road per name, the others only behind their edges).
+ * @throws invalid_argument if Edge is nullptr
+ */
+void Graph::removeSubroad(Edge *e) {
+	if (e == nullptr) {
+		throw std::invalid_argument("Edge not found");
+	}
+	Road *road = e->subroad != nullptr ? e->subroad->getRoad() : nullptr;
+	eraseSubroad(e);
+
+	if (road == nullptr || road->getNumSubroads() > 0) return;
+	auto it = roadsInfo.find(road->getName());
+	if (it != roadsInfo.end() && it->second == road) return;
+	for (auto &pair : subRoadsInfo) {
+		if (pair.second->subroad != nullptr && pair.second->subroad->getRoad() == road) return;
+	}
+	delete road;
+}
+
+/*
+ * @brief (Private) Removes the edge e and its reverse edge,
+ * if any, and deletes their subroad, see removeSubroad
+ */
+void Graph::eraseSubroad(Edge *e) {
+	Subroad *subroad = e->subroad;
+
+	// The reverse edge is the one back sharing the subroad,
+	// not a parallel edge of another subroad
+	Edge *reverse = nullptr;
+	Vertex *dest = e->getDest();
+	for (auto list : {&dest->adj, &dest->accidentedAdj}) {
+		for (Edge *other : *list) {
+			if (other != e && other->dest == e->source && other->subroad == subroad)
+				reverse = other;
+		}
+	}
+
+	removeEdge(e);
+	if (reverse != nullptr)
+		removeEdge(reverse);
+	delete subroad;
+}
+
+/*
+ * @brief Removes a road with all its subroads from the
+ * graph, the road information and the road search index,
+ * and deletes it
+ * @throws invalid_argument if Road is nullptr
+ */
+void Graph::removeRoad(Road *road) {
+	if (road == nullptr) {
+		throw std::invalid_argument("Road not found");
+	}
+	while (road->getNumSubroads() > 0)
+		eraseSubroad(road->getEdge(road->getNumSubroads() - 1));
+
+	auto it = roadsInfo.find(road->getName());
+	if (it != roadsInfo.end() && it->second == road)
+		roadsInfo.erase(it);
+	auto range = roadsIndex.equal_range(normalizeText(road->getName()));
+	for (auto index = range.first; index != range.second; ++index) {
+		if (index->second == road) {
+			roadsIndex.erase(index);
+			break;
+		}
+	}
+	delete road;
+}
+
+/*
+ * @brief Fastest maximum speed (km/h) of the roads behind the
+ * edges, at least 1, as of the last updateMaxSpeed (or higher)
+ */
+int Graph::getMaxSpeed() const {
+	return maxSpeed;
+}
+
+/*
+ * @brief Takes the fastest maximum speed again, over the roads behind
+ * every edge (roadsInfo holds only one road per name). Done by loadMap
+ * and loadDelta; to be done again after the speed of a road changes.
+ */
+void Graph::updateMaxSpeed() {
+	maxSpeed = 1;
+	for (auto &pair : subRoadsInfo) {
+		Subroad *subroad = pair.second->subroad;
+		if (subroad != nullptr && subroad->getRoad() != nullptr)
+			maxSpeed = max(maxSpeed, subroad->getRoad()->getMaxSpeed());
+	}
+}
+
 map<string, Road *> & Graph::getRoadsInfo() {
 	return roadsInfo;
 }
 
+/*
+ * @brief Returns the road search index: every road in
+ * roadsInfo keyed by its normalized name (see normalizeText)
+ */
+multimap<string, Road *> & Graph::getRoadsIndex() {
+	return roadsIndex;
+}
+
 map<int,Edge *> & Graph::getSubRoadsInfo() {
 	return subRoadsInfo;
 }
 
 
 
+/*
+ * @brief (Private) Appends edge e to list
+ * (adj or accidentedAdj), keeping its position
+ */
+void Vertex::insertEdge(vector<Edge*> &list, Edge *e) {
+	if (!list.empty() && list.back()->dest->rank > e->dest->rank)
+		markUnsorted();
+	e->adjIndex = list.size();
+	list.push_back(e);
+}
+
+/*
+ * @brief (Private) Removes edge e from list in constant
+ * time, moving the last edge of the list to its position.
+ * That breaks the order by destination rank, which is
+ * brought back before the next search (see markUnsorted).
+ * e is in list.
+ */
+void Vertex::eraseEdge(vector<Edge*> &list, Edge *e) {
+	Edge *last = list.back();
+	if (last != e) markUnsorted();
+	list[e->adjIndex] = last;
+	last->adjIndex = e->adjIndex;
+	list.pop_back();
+}
+
+/*
+ * @brief (Private) Leaves the edges to be sorted again
+ * by Graph::clear, so that a burst of accidents and fixes
+ * sorts each vertex once
+ */
+void Vertex::markUnsorted() {
+	if (!adjSorted) return;
+	adjSorted = false;
+	if (graph != nullptr) graph->unsortedAdj.push_back(id);
+}
+
+/*
+ * @brief (Private) Sorts adj and accidentedAdj by the rank of
+ * the destinations, so that searches visit them in memory order
+ */
+void Vertex::sortAdj() {
+	for (auto list : {&adj, &accidentedAdj}) {
+		stable_sort(list->begin(), list->end(), [](Edge *a, Edge *b) {
+			return a->dest->rank < b->dest->rank;
+		});
+		for (size_t i = 0; i < list->size(); ++i)
+			(*list)[i]->adjIndex = i;
+	}
+	adjSorted = true;
+}
+
 /*
  * @brief (Private) Moves edge e from accidentedAdj to adj.
  * e is in accidentedAdj.
  */
 void Vertex::moveToAdj(Edge *e) {
-	accidentedAdj.erase(remove(accidentedAdj.begin(),accidentedAdj.end(), e),accidentedAdj.end());
-	adj.push_back(e);
+	eraseEdge(accidentedAdj, e);
+	insertEdge(adj, e);
 	graph->update();
 }
 
@@ -828,8 +1569,8 @@ void Vertex::moveToAdj(Edge *e) {
  * e is in adj.
  */
 void Vertex::moveToAccidentedAdj(Edge *e) {
-	adj.erase(remove(adj.begin(),adj.end(), e),adj.end());
-	accidentedAdj.push_back(e);
+	eraseEdge(adj, e);
+	insertEdge(accidentedAdj, e);
 	graph->update();
 }
 
@@ -851,8 +1592,15 @@ Vertex::Vertex(int id, int x, int y, bool accidented):
 
 /*
  * @brief Vertex destructor, destroys all its own edges
+ * (not their subroads, see Graph::~Graph)
  */
 Vertex::~Vertex() {
+	for (auto edge : adj) {
+		delete edge;
+	}
+	for (auto edge : accidentedAdj) {
+		delete edge;
+	}
 }
 
 /*
@@ -959,19 +1707,21 @@ bool Vertex::addEdge(Edge* e) {
 		return false; // An edge already on the spot, delete it first
 	}
 	if (e->isAccidented()) {
-		accidentedAdj.push_back(e);
+		insertEdge(accidentedAdj, e);
 	} else {
-		adj.push_back(e);
+		insertEdge(adj, e);
 	}
 	int id = e->getID();
 	e->_sgraph(graph);
-	graph->gv->addEdge(id, e->getSource()->getID(), e->getDest()->getID(), EdgeType::DIRECTED);
-	// * Set Edge Label
-	if (graph->show.edgeLabels)
-		graph->gv->setEdgeLabel(id, to_string(id));
-	// * Set Edge Color
-	if (e->isAccidented())
-		graph->gv->setEdgeColor(id, ACCIDENTED_COLOR);
+	if (graph->gv != nullptr) {
+		graph->gv->addEdge(id, e->getSource()->getID(), e->getDest()->getID(), EdgeType::DIRECTED);
+		// * Set Edge Label
+		if (graph->show.edgeLabels)
+			graph->gv->setEdgeLabel(id, to_string(id));
+		// * Set Edge Color
+		if (e->isAccidented())
+			graph->gv->setEdgeColor(id, ACCIDENTED_COLOR);
+	}
 	// No graph->update()
 	return true;
 }
@@ -1039,11 +1789,13 @@ bool Vertex::fix() {
 		// * Set Vertex Color
 		graph->setVertexColor(this, VERTEX_CLEAR_COLOR);
 		// * Fix edges ?
-		for (Edge *e : accidentedAdj) {
-			e->fix();
+		// (each fix moves the last edge out of accidentedAdj)
+		while (!accidentedAdj.empty()) {
+			accidentedAdj.back()->fix();
 		}
 		// Move back to vertexSet
 		graph->moveToVertexSet(this);
+		graph->notify(VERTEX_FIXED, this, nullptr);
 		return true;
 	} else {
 		return false;
@@ -1060,11 +1812,13 @@ bool Vertex::accident() {
 		// * Set Vertex Color
 		graph->setVertexColor(this, ACCIDENTED_COLOR);
 		// * Accident edges ?
-		for (Edge *e : adj) {
-			e->accident();
+		// (each accident moves the last edge out of adj)
+		while (!adj.empty()) {
+			adj.back()->accident();
 		}
 		// Move to accidentedVertexSet
 		graph->moveToAccidentedVertexSet(this);
+		graph->notify(VERTEX_ACCIDENTED, this, nullptr);
 		return true;
 	} else {
 		return false;
@@ -1129,28 +1883,28 @@ void Vertex::removeEdge(Edge* edge) {
 	if (edge == nullptr) {
 		throw std::invalid_argument("Edge not found");
 	}
-	if (!findEdge(edge->getID())) {
+	if (edge->source != this) {
 		throw std::invalid_argument("Edge not from this vertex");
 	}
+	int id = edge->getID();
+	graph->subRoadsInfo.erase(id);
+	graph->edgeIndex.remove(edge);
+	if (edge->subroad != nullptr && edge->getRoad() != nullptr)
+		edge->getRoad()->removeEdges(edge);
 	if (edge->isAccidented()) {
-		auto it = find(accidentedAdj.begin(),
-				accidentedAdj.end(), edge);
-		delete edge;
-		accidentedAdj.erase(it);
+		eraseEdge(accidentedAdj, edge);
 	} else {
-		int id = edge->getID();
-		auto it = find(adj.begin(), adj.end(), edge);
-		delete edge;
-		adj.erase(it);
-		graph->gv->removeEdge(id);
-		// No graph->update()
+		eraseEdge(adj, edge);
 	}
+	delete edge;
+	if (graph->gv != nullptr) graph->gv->removeEdge(id);
+	// No graph->update()
 }
 
 /*
  * @brief Return true if "vertex" have greater distance
  */
-bool Vertex::operator<(Vertex vertex) const {
+bool Vertex::operator<(const Vertex &vertex) const {
 	return this->priority < vertex.priority;
 }
 
@@ -1210,6 +1964,14 @@ double Edge::getWeight() const {
 	return (subroad->getDistance()/(double)1000)/subroad->calculateAverageSpeed();
 }
 
+/*
+ * @brief Time-dependent travel time of the edge, in hours,
+ * leaving at departure (hours since midnight)
+ */
+double Edge::getTravelTime(double departure) const {
+	return subroad->getTravelTime(departure);
+}
+
 /*
  * @brief Return's the edge's Road (not Subroad)
  */
@@ -1217,6 +1979,13 @@ Road* Edge::getRoad() const {
 	return subroad->getRoad();
 }
 
+/*
+ * @brief Return's the edge's Subroad, shared with its reverse edge
+ */
+Subroad* Edge::getSubroad() const {
+	return subroad;
+}
+
 /*
  * @brief Check whether the edge is accidented
  */
@@ -1265,6 +2034,7 @@ bool Edge::fix() {
 		graph->setEdgeColor(this, EDGE_CLEAR_COLOR);
 		// Move back to adj
 		source->moveToAdj(this);
+		graph->notify(EDGE_FIXED, source, this);
 		return true;
 	} else {
 		return false;
@@ -1283,6 +2053,7 @@ bool Edge::accident() {
 		graph->setEdgeColor(this, ACCIDENTED_COLOR);
 		// Move to accidentedAdj
 		source->moveToAccidentedAdj(this);
+		graph->notify(EDGE_ACCIDENTED, source, this);
 		return true;
 	} else {
 		return false;
@@ -1290,43 +2061,55 @@ bool Edge::accident() {
 }
 
 /*
- * @brief Sets the edge's actual Car capacity
+ * @brief Sets the edge's actual Car capacity (shared with
+ * its reverse edge, if any). If the weight changes, both
+ * edges are reported as reweighted.
  * @return True if within the bounds set by max capacity
  *         False otherwise
  */
 bool Edge::setActualCapacity(int capacity) {
-	return subroad->setActualCapacity(capacity);
-}
-
+	double weight = getWeight();
+	if (!subroad->setActualCapacity(capacity))
+		return false;
 
+	if (getWeight() != weight) {
+		graph->notify(EDGE_REWEIGHTED, source, this);
+		Edge *reverse = dest->getEdge(source);
+		if (reverse != nullptr && reverse->subroad == subroad)
+			graph->notify(EDGE_REWEIGHTED, dest, reverse);
+	}
+	return true;
+}
 
 
 
 
-void Graph::generateGraphNewStatus(vector<Vertex*> path) {
-	//For every edge generate new capacity
-	vector<Vertex*> everyVextex = getAllVertexSet();
 
-	for (auto vertex : everyVextex) {
-		if ((vertex != path[0]) || (vertex != path[1]) || (vertex != path[path.size()-1])){
-			int newStatus = rand() % 501;
 
-			if(newStatus > 498){
-				if(vertex->isAccidented())
-					vertex->fix();
-				else
-					vertex->accident();
-			}
-		}
+/*
+ * @brief Random step of the accidents of the graph, between two stops
+ * of a vehicle along path (its current vertex first): every clear
+ * vertex but the current, the next and the last of path has an
+ * accident with probability 2/501, all in one bulk operation. Each
+ * vertex draws from its own stream for this step (see RandomStream),
+ * so the same seed gives the same accidents whatever the order of the
+ * vertices. Nothing is fixed: a simulation (see TrafficSimulation)
+ * only knows the roads that were clear when it was built.
+ * @return The number of vertices accidented
+ */
+int Graph::generateGraphNewStatus(const vector<Vertex*> &path) {
+	int step = statusSteps++;
+	if (path.empty()) return 0;
 
-		for (auto edge : vertex->adj) {
-			if (edge != nullptr) {
-				int newActualCapacity = (rand() % edge->getMaxCapacity());
-				edge->setActualCapacity(newActualCapacity);
-			}
+	vector<Vertex*> accidents;
+	for (auto vertex : vertexSet) {
+		if ((vertex != path[0]) && (path.size() < 2 || vertex != path[1]) && (vertex != path.back())) {
+			int newStatus = RandomStream(RANDOM_STREAM_ACCIDENT, vertex->getID(), step).below(501);
+			if (newStatus > 498) accidents.push_back(vertex);
 		}
 	}
 
+	return accidentVertices(accidents);
 }
 
 
@@ -1352,6 +2135,8 @@ void Graph::bfs(Vertex *origin) {
 }
 
 
+// Search labels of a vertex: cost, priority, path and queueIndex
+static const long long labelBytes = 2 * sizeof(long double) + sizeof(Vertex*) + sizeof(int);
 
 /**
  * Performs Greedy Best-First Search in the graph,
@@ -1359,18 +2144,22 @@ void Graph::bfs(Vertex *origin) {
  * The resulting path obtainable by getPath(vsource, vdest)
  * is not necessarily the best (shortest) path.
  */
-void Graph::gbfsDist(Vertex *vsource, Vertex *vdest, microtime *time) {
+void Graph::gbfsDist(Vertex *vsource, Vertex *vdest, microtime *time, SearchStats *stats) {
 	clear();
+	SearchStats st;
 
 	auto start = chrono::high_resolution_clock::now();
 
 	MutablePriorityQueue<Vertex> q;
 	q.insert(vsource);
+	st.maxHeapSize = st.reached = 1;
 	while (!q.empty()) {
 		auto current = q.extractMin();
+		++st.settled;
 		if (current == vdest) break;
 
 		for (auto e : current->adj) { // Non-accidented only
+			++st.relaxed;
 			auto next = e->dest;
 			if (next->path != nullptr) continue; // If visited, skip
 			if (next->isAccidented()) continue; // If accidented, skip
@@ -1379,11 +2168,17 @@ void Graph::gbfsDist(Vertex *vsource, Vertex *vdest, microtime *time) {
 
 			next->path = current;
 			q.insert(next);
+			++st.reached;
+			st.maxHeapSize = max(st.maxHeapSize, (long long)q.size());
 		}
 	}
 
 	auto end = chrono::high_resolution_clock::now();
 	if (time) *time = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	if (stats) {
+		st.bytesAllocated = q.allocatedBytes() + st.reached * labelBytes;
+		*stats = st;
+	}
 }
 
 
@@ -1393,16 +2188,20 @@ void Graph::gbfsDist(Vertex *vsource, Vertex *vdest, microtime *time) {
  * source vertex but no predetermined destination vertex,
  * so it finds the best path for all reachable vertices.
  */
-void Graph::dijkstraDist(Vertex *vsource, microtime *time) {
+void Graph::dijkstraDist(Vertex *vsource, microtime *time, SearchStats *stats) {
 	clear();
+	SearchStats st;
 
 	auto start = chrono::high_resolution_clock::now();
 
 	MutablePriorityQueue<Vertex> q;
 	q.insert(vsource);
+	st.maxHeapSize = st.reached = 1;
 	while (!q.empty()) {
 		auto current = q.extractMin();
+		++st.settled;
 		for (auto e : current->adj) { // Non-accidented only
+			++st.relaxed;
 			auto next = e->dest;
 			if (next->isAccidented()) continue; // If accidented, skip
 
@@ -1413,18 +2212,25 @@ void Graph::dijkstraDist(Vertex *vsource, microtime *time) {
 				next->priority = newcost;
 				next->path = current;
 				q.insert(next);
+				++st.reached;
+				st.maxHeapSize = max(st.maxHeapSize, (long long)q.size());
 			}
 			else if (newcost < next->cost) {
 				next->cost = newcost;
 				next->priority = newcost;
 				next->path = current;
 				q.decreaseKey(next);
+				++st.decreaseKeys;
 			}
 		}
 	}
 
 	auto end = chrono::high_resolution_clock::now();
 	if (time) *time = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	if (stats) {
+		st.bytesAllocated = q.allocatedBytes() + st.reached * labelBytes;
+		*stats = st;
+	}
 }
 
 
@@ -1434,17 +2240,21 @@ void Graph::dijkstraDist(Vertex *vsource, microtime *time) {
  * source and destination vertices, stopping once the best
  * path from vsource to vdest is found.
  */
-void Graph::dijkstraDist(Vertex *vsource, Vertex *vdest, microtime *time) {
+void Graph::dijkstraDist(Vertex *vsource, Vertex *vdest, microtime *time, SearchStats *stats) {
 	clear();
+	SearchStats st;
 
 	auto start = chrono::high_resolution_clock::now();
 
 	MutablePriorityQueue<Vertex> q;
 	q.insert(vsource);
+	st.maxHeapSize = st.reached = 1;
 	while (!q.empty()) {
 		auto current = q.extractMin();
+		++st.settled;
 		if (current == vdest) break;
 		for (auto e : current->adj) { // Non-accidented only
+			++st.relaxed;
 			auto next = e->dest;
 			if (next->isAccidented()) continue; // If accidented, skip
 
@@ -1455,18 +2265,25 @@ void Graph::dijkstraDist(Vertex *vsource, Vertex *vdest, microtime *time) {
 				next->priority = newcost;
 				next->path = current;
 				q.insert(next);
+				++st.reached;
+				st.maxHeapSize = max(st.maxHeapSize, (long long)q.size());
 			}
 			else if (newcost < next->cost) {
 				next->cost = newcost;
 				next->priority = newcost;
 				next->path = current;
 				q.decreaseKey(next);
+				++st.decreaseKeys;
 			}
 		}
 	}
 
 	auto end = chrono::high_resolution_clock::now();
 	if (time) *time = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	if (stats) {
+		st.bytesAllocated = q.allocatedBytes() + st.reached * labelBytes;
+		*stats = st;
+	}
 }
 
 
@@ -1475,17 +2292,21 @@ void Graph::dijkstraDist(Vertex *vsource, Vertex *vdest, microtime *time) {
  * Performs A* in the graph, given origin and destination vertices,
  * stopping once the best path from vsource to vdest is found.
  */
-void Graph::AstarDist(Vertex *vsource, Vertex *vdest, microtime *time) {
+void Graph::AstarDist(Vertex *vsource, Vertex *vdest, microtime *time, SearchStats *stats) {
 	clear();
+	SearchStats st;
 
 	auto start = chrono::high_resolution_clock::now();
 
 	MutablePriorityQueue<Vertex> q;
 	q.insert(vsource);
+	st.maxHeapSize = st.reached = 1;
 	while (!q.empty()) {
 		auto current = q.extractMin();
+		++st.settled;
 		if (current == vdest) break;
 		for (auto e : current->adj) { // Non-accidented only
+			++st.relaxed;
 			auto next = e->dest;
 			if (next->isAccidented()) continue; // If accidented, skip
 
@@ -1496,18 +2317,25 @@ void Graph::AstarDist(Vertex *vsource, Vertex *vdest, microtime *time) {
 				next->priority = newcost + distance(next, vdest); // <- A*
 				next->path = current;
 				q.insert(next);
+				++st.reached;
+				st.maxHeapSize = max(st.maxHeapSize, (long long)q.size());
 			}
 			else if (newcost < next->cost) {
 				next->cost = newcost;
 				next->priority = newcost + distance(next, vdest); // <- A*
 				next->path = current;
 				q.decreaseKey(next);
+				++st.decreaseKeys;
 			}
 		}
 	}
 
 	auto end = chrono::high_resolution_clock::now();
 	if (time) *time = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	if (stats) {
+		st.bytesAllocated = q.allocatedBytes() + st.reached * labelBytes;
+		*stats = st;
+	}
 }
 
 
@@ -1516,17 +2344,21 @@ void Graph::AstarDist(Vertex *vsource, Vertex *vdest, microtime *time) {
  * Performs Dijkstra in the graph, computing the fastest path, in terms
  * of travel time, given source and destination vertices.
  */
-void Graph::dijkstraSimulation(Vertex *vsource, Vertex *vdest, microtime *time) {
+void Graph::dijkstraSimulation(Vertex *vsource, Vertex *vdest, microtime *time, SearchStats *stats) {
 	clear();
+	SearchStats st;
 
 	auto start = chrono::high_resolution_clock::now();
 
 	MutablePriorityQueue<Vertex> q;
 	q.insert(vsource);
+	st.maxHeapSize = st.reached = 1;
 	while (!q.empty()) {
 		auto current = q.extractMin();
+		++st.settled;
 		if (current == vdest) break;
 		for (auto e : current->adj) { // Non-accidented only
+			++st.relaxed;
 			auto next = e->dest;
 			if (next->isAccidented()) continue; // If accidented, skip
 
@@ -1537,20 +2369,136 @@ void Graph::dijkstraSimulation(Vertex *vsource, Vertex *vdest, microtime *time)
 				next->priority = newcost;
 				next->path = current;
 				q.insert(next);
+				++st.reached;
+				st.maxHeapSize = max(st.maxHeapSize, (long long)q.size());
 			}
 			else if (newcost < next->cost) {
 				next->cost = newcost;
 				next->priority = newcost;
 				next->path = current;
 				q.decreaseKey(next);
+				++st.decreaseKeys;
 			}
 		}
 	}
 
 	auto end = chrono::high_resolution_clock::now();
 	if (time) *time = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	if (stats) {
+		st.bytesAllocated = q.allocatedBytes() + st.reached * labelBytes;
+		*stats = st;
+	}
+}
+
+
+
+/**
+ * Performs Dijkstra in the graph, computing the path with the earliest
+ * arrival at vdest when leaving vsource at departure (hours since
+ * midnight), with each edge's travel time depending on when it is entered.
+ * The arrival time is vdest's cost, in hours since the same midnight.
+ */
+void Graph::dijkstraTimeDependent(Vertex *vsource, Vertex *vdest, double departure, microtime *time, SearchStats *stats) {
+	timeDependentSearch(vsource, vdest, departure, false, time, stats);
 }
 
+/**
+ * Same as dijkstraTimeDependent, guided by the time to
+ * travel the straight line distance at the maximum speed.
+ */
+void Graph::AstarTimeDependent(Vertex *vsource, Vertex *vdest, double departure, microtime *time, SearchStats *stats) {
+	timeDependentSearch(vsource, vdest, departure, true, time, stats);
+}
 
+/*
+ * Label-setting search shared by both of the above. Since travel times
+ * are FIFO (see TravelTimeProfile), arriving earlier at a vertex never
+ * leads to arriving later at the next, so Dijkstra remains exact.
+ */
+void Graph::timeDependentSearch(Vertex *vsource, Vertex *vdest, double departure, bool astar,
+		microtime *time, SearchStats *stats) {
+	clear();
+	SearchStats st;
 
+	// Fastest speed of any road (see updateMaxSpeed), bounding the remaining travel time
+	const auto estimate = [&](Vertex *v) -> double {
+		return astar ? (distance(v, vdest) / 1000) / maxSpeed : 0;
+	};
 
+	auto start = chrono::high_resolution_clock::now();
+
+	MutablePriorityQueue<Vertex> q;
+	vsource->cost = departure;
+	vsource->priority = departure + estimate(vsource);
+	q.insert(vsource);
+	st.maxHeapSize = st.reached = 1;
+	while (!q.empty()) {
+		auto current = q.extractMin();
+		++st.settled;
+		if (current == vdest) break;
+		for (auto e : current->adj) { // Non-accidented only
+			++st.relaxed;
+			auto next = e->dest;
+			if (next->isAccidented() || next == vsource) continue; // If accidented, skip
+
+			long double newcost = current->cost + e->getTravelTime(current->cost); // <- Time-dependent
+
+			if (next->path == nullptr) {
+				next->cost = newcost;
+				next->priority = newcost + estimate(next);
+				next->path = current;
+				q.insert(next);
+				++st.reached;
+				st.maxHeapSize = max(st.maxHeapSize, (long long)q.size());
+			}
+			else if (newcost < next->cost) {
+				next->cost = newcost;
+				next->priority = newcost + estimate(next);
+				next->path = current;
+				q.decreaseKey(next);
+				++st.decreaseKeys;
+			}
+		}
+	}
+
+	auto end = chrono::high_resolution_clock::now();
+	if (time) *time = chrono::duration_cast<chrono::microseconds>(end - start).count();
+	if (stats) {
+		st.bytesAllocated = q.allocatedBytes() + st.reached * labelBytes;
+		*stats = st;
+	}
+}
+
+
+
+/**
+ * Computes the cost of the best path from every origin to every
+ * destination (table[i][j] from origins[i] to destinations[j],
+ * infinity if unreachable), in meters or hours depending on metric.
+ * Runs one Dijkstra per origin that stops once all destinations are
+ * settled, over a compact snapshot of the graph, with the origins
+ * spread over the given number of threads (0 for all cores).
+ * Does not touch the vertices' path/cost, so no clear() is needed.
+ */
+vector<vector<double>> Graph::distanceTable(const vector<Vertex*> &origins, const vector<Vertex*> &destinations,
+		Metric metric, int threads) const {
+	CompactGraph compact(this);
+	vector<int> targets;
+	vector<vector<double>> table(origins.size());
+
+	for (auto v : destinations)
+		targets.push_back(compact.getIndex(v));
+
+	if (threads <= 0) threads = defaultThreads();
+	vector<SearchWorkspace> workspaces(threads);
+
+	parallelFor(origins.size(), threads, [&](int i, int t) {
+		int origin = compact.getIndex(origins[i]);
+		if (origin < 0)
+			table[i].assign(targets.size(), numeric_limits<double>::infinity());
+		else
+			compact.oneToMany(origin, targets, metric, table[i], workspaces[t]);
+	});
+
+	return table;
+}
@@ -2,10 +2,15 @@
 
 #include "graphviewer.h"
 #include "MutablePriorityQueue.h"
+#include "SpatialIndex.h"
+#include "CompactGraph.h"
+#include "TimeProfile.h"
 
 #include <limits>
 #include <chrono>
 #include <map>
+#include <unordered_map>
+#include <functional>
 
 using namespace std;
 
@@ -32,11 +37,68 @@ class Vertex;
 class Road;
 class Subroad;
 
-extern Graph* graph;
-
 using microtime = chrono::duration<int64_t,micro>::rep;
 using color = string;
 
+/*
+ * Work done by one search (see the Algorithms in Graph)
+ */
+struct SearchStats {
+	long long settled = 0;          // Vertices extracted from the queue
+	long long relaxed = 0;          // Edges scanned from settled vertices
+	long long decreaseKeys = 0;     // Queue entries improved in place
+	long long maxHeapSize = 0;      // Largest queue size reached
+	long long reached = 0;          // Vertices given a cost (queued at least once)
+	long long bytesAllocated = 0;   // Memory of the search: its queue plus the labels of the vertices reached
+};
+
+/*
+ * Order of the vertices in memory, see Graph::reorderVertices
+ */
+enum VertexOrder {
+	ID_ORDER,        // As loaded: IDs follow the lines of the nodes file
+	BFS_ORDER,       // Breadth-first from the first vertex, either direction
+	HILBERT_ORDER    // Along a Hilbert curve over the coordinates
+};
+
+// Loading order. The other orders are kept to be measured (see
+// RoutingBenchmark --orders), and have not yet beaten the IDs
+#define DEFAULT_VERTEX_ORDER   ID_ORDER
+
+/*
+ * Changes reported to the listeners of a Graph, see Graph::addListener
+ */
+enum GraphEvent {
+	EDGE_ACCIDENTED,
+	EDGE_FIXED,
+	VERTEX_ACCIDENTED,   // After its edges were, each reported on its own
+	VERTEX_FIXED,        // After its edges were, each reported on its own
+	EDGE_REWEIGHTED      // Its weight changed with its actual capacity (both directions reported)
+};
+
+/*
+ * One change to a Graph: the vertex (an edge's source) and the edge,
+ * nullptr for vertex events
+ */
+struct GraphChange {
+	GraphEvent event;
+	Vertex *vertex;
+	Edge *edge;
+};
+
+// Changes in the order they happened: one, or all those of a bulk operation
+using GraphListener = function<void(const vector<GraphChange> &changes)>;
+
+/*
+ * Closest point of the road network to a given location
+ */
+struct EdgeSnap {
+	Edge *edge = nullptr;    // Closest edge, nullptr if none
+	double offset = 0;       // Meters along the edge, from its source
+	double x = 0, y = 0;     // Projected point, in graph coordinates
+	double distance = 0;     // Meters from the location to the projected point
+};
+
 //////////////////////////
 /////// Class Graph //////
 //////////////////////////
@@ -45,20 +107,46 @@ class Graph {
 	const int width, height;
 	vector<Vertex*> vertexSet;
 	vector<Vertex*> accidentedVertexSet;
+	unordered_map<int, Vertex*> vertexIds;
 	GraphViewer *gv;
 	double scale;
 	map<string,Road *> roadsInfo;
+	multimap<string,Road *> roadsIndex;
 	map<int, Edge *> subRoadsInfo;
+	SpatialGrid spatialIndex;
+	SegmentGrid edgeIndex;
 
 	mutable struct Mode {
 		bool vertexLabels = false;
 		bool edgeLabels = false;
 	} show;
 
+	map<int, GraphListener> listeners;
+	int nextListener = 0;
+	int statusSteps = 0;         // Calls to generateGraphNewStatus, the step of its random streams
+	int maxSpeed = 1;            // Km/h, fastest road behind any edge (see updateMaxSpeed)
+
+	mutable vector<int> unsortedAdj;  // IDs of the vertices whose edges left their order
+
+	mutable struct Refresh {
+		int deferred = 0;       // Bulk operations in progress
+		bool pending = false;   // An update was asked for meanwhile
+		vector<GraphChange> changes; // Held back from the listeners meanwhile
+	} refresh;
+
 	///// ***** Auxiliary
 	bool withinBounds(int x, int y) const;
+	void insertVertex(vector<Vertex*> &set, Vertex *v);
+	void eraseVertex(vector<Vertex*> &set, Vertex *v);
 	void moveToVertexSet(Vertex *v);
 	void moveToAccidentedVertexSet(Vertex *v);
+	void sortAdjacencies() const;
+	void eraseSubroad(Edge *e);
+	void beginBulk();
+	void endBulk();
+	void notify(GraphEvent event, Vertex *v, Edge *e) const;
+	void timeDependentSearch(Vertex *vsource, Vertex *vdest, double departure, bool astar,
+			microtime *time, SearchStats *stats);
 
 public:
 	///// ***** Visual GraphViewer API
@@ -87,6 +175,7 @@ public:
 	// Advanced API
 	bool setBackground(string path) const;
 	bool straightEdges() const;
+	bool hasViewer() const;
 	/////
 
 	///// ***** Animation
@@ -95,10 +184,15 @@ public:
 	/////
 
 	///// ***** Constructors and destructor
-	explicit Graph(int width, int height, double scale = 1);
+	explicit Graph(int width, int height, double scale = 1, bool viewer = true);
 	~Graph();
 	/////
 
+	///// ***** Listeners
+	int addListener(GraphListener listener);
+	void removeListener(int id);
+	/////
+
 	///// ***** Vertex CRUD
 	bool addVertex(int id, int x, int y, bool accidented = false);
 	bool addVertex(Vertex *v);
@@ -112,6 +206,7 @@ public:
 	vector<Vertex*> getAccidentedVertexSet() const;
 	vector<Vertex*> getAllVertexSet() const;
 	vector<Vertex*> getPath(Vertex* origin, Vertex* dest) const;
+	double getScale() const;
 	double distance(Vertex *v1, Vertex *v2) const;
 	double length(Edge *e) const;
 	bool connectedTo(Vertex *v1, Vertex *v2, bool bothways = false) const;
@@ -123,6 +218,20 @@ public:
 	void removeVertex(Vertex *v);
 	/////
 
+	///// ***** Spatial queries
+	void buildSpatialIndex();
+	Vertex *findNearestVertex(double x, double y, bool maybeAccidented = false) const;
+	vector<Vertex*> findNearestVertices(double x, double y, int k, bool maybeAccidented = false) const;
+	vector<Vertex*> findVerticesInRange(double x1, double y1, double x2, double y2, bool maybeAccidented = true) const;
+	vector<Vertex*> findVerticesInPolygon(const vector<pair<double, double>> &polygon, bool maybeAccidented = true) const;
+	EdgeSnap snapToEdge(double x, double y, bool maybeAccidented = false) const;
+	/////
+
+	///// ***** Memory layout
+	void reorderVertices(VertexOrder order);
+	size_t getMemoryUsage() const;
+	/////
+
 	///// ***** Edge CRUD
 	bool addEdge(int eid, int sourceId, int destId, Subroad* road, bool accidented = false);
 	bool addEdge(int eid, Vertex *vsource, Vertex *vdest, Subroad* road, bool accidented = false);
@@ -140,7 +249,26 @@ public:
 	void removeEdge(Edge *e);
 	/////
 
-	void generateGraphNewStatus(vector<Vertex*> path);
+	///// ***** Bulk accidents
+	int accidentVertices(const vector<Vertex*> &vertices);
+	int fixVertices(const vector<Vertex*> &vertices);
+	int accidentEdges(const vector<Edge*> &edges);
+	int fixEdges(const vector<Edge*> &edges);
+	int accidentArea(const vector<pair<double, double>> &polygon);
+	int fixArea(const vector<pair<double, double>> &polygon);
+	/////
+
+	///// ***** Road CRUD
+	Road *findRoad(const string &name) const;
+	bool addRoad(Road *road);
+	Edge *addSubroad(Road *road, Vertex *v1, Vertex *v2);
+	void removeSubroad(Edge *e);
+	int getMaxSpeed() const;
+	void updateMaxSpeed();
+	void removeRoad(Road *road);
+	/////
+
+	int generateGraphNewStatus(const vector<Vertex*> &path);
 
 	///// ***** Algorithms
 	void clear() const;
@@ -149,23 +277,32 @@ public:
 	void bfs(Vertex *origin);
 
 	// Greedy Best-First Search.
-	void gbfsDist(Vertex *origin, Vertex *destination, microtime *time = nullptr);
+	void gbfsDist(Vertex *origin, Vertex *destination, microtime *time = nullptr, SearchStats *stats = nullptr);
 
 	// Dijkstra by distance, single source. Find shortest paths to all other vertices
-	void dijkstraDist(Vertex *origin, microtime *time = nullptr);
+	void dijkstraDist(Vertex *origin, microtime *time = nullptr, SearchStats *stats = nullptr);
 
 	// Dijkstra by distance, with destination. Find shortest paths destination vertex
-	void dijkstraDist(Vertex *vsource, Vertex *vdest, microtime *time = nullptr);
+	void dijkstraDist(Vertex *vsource, Vertex *vdest, microtime *time = nullptr, SearchStats *stats = nullptr);
 
 	// A* by distance. Find shortest path to destination vertex only
-	void AstarDist(Vertex *vsource, Vertex *vdest, microtime *time = nullptr);
+	void AstarDist(Vertex *vsource, Vertex *vdest, microtime *time = nullptr, SearchStats *stats = nullptr);
 
 	// Dijkstra by travel time, with destination. Find the quickest path to destination vertex
-	void dijkstraSimulation(Vertex *vsource, Vertex *vdest, microtime *time = nullptr);
+	void dijkstraSimulation(Vertex *vsource, Vertex *vdest, microtime *time = nullptr, SearchStats *stats = nullptr);
+
+	// Dijkstra and A* by time-dependent travel time. Earliest arrival at destination vertex, leaving at departure
+	void dijkstraTimeDependent(Vertex *vsource, Vertex *vdest, double departure, microtime *time = nullptr, SearchStats *stats = nullptr);
+	void AstarTimeDependent(Vertex *vsource, Vertex *vdest, double departure, microtime *time = nullptr, SearchStats *stats = nullptr);
+
+	// Multi-target Dijkstra per origin, in parallel. Cost from every origin to every destination
+	vector<vector<double>> distanceTable(const vector<Vertex*> &origins, const vector<Vertex*> &destinations,
+			Metric metric = DISTANCE, int threads = 0) const;
 	/////
 
 	///// ***** Operations
 	map<string, Road *> & getRoadsInfo();
+	multimap<string, Road *> & getRoadsIndex();
 	map<int, Edge *> & getSubRoadsInfo();
 	friend class Vertex;
 	friend class Edge;
@@ -190,7 +327,14 @@ class Vertex {
 	vector<Edge*> adj;
 	vector<Edge*> accidentedAdj;
 	Graph* graph = nullptr;
-
+	int setIndex = 0;    // Position in vertexSet or accidentedVertexSet
+	int rank = 0;        // Position in memory, see Graph::reorderVertices
+	bool adjSorted = true; // Whether adj and accidentedAdj are by destination rank
+
+	void insertEdge(vector<Edge*> &list, Edge *e);
+	void eraseEdge(vector<Edge*> &list, Edge *e);
+	void markUnsorted();
+	void sortAdj();
 	void moveToAdj(Edge *e);
 	void moveToAccidentedAdj(Edge *e);
 
@@ -200,6 +344,8 @@ public:
 	///// ***** Constructor
 	void _sgraph(Graph* graph);
 	explicit Vertex(int id, int x, int y, bool accidented = false);
+	Vertex(const Vertex&) = delete;            // Owns its edges
+	Vertex &operator=(const Vertex&) = delete;
 	~Vertex();
 
 	///// ***** Vertex CRUD
@@ -234,7 +380,7 @@ public:
 	/////
 
 	///// ***** Operations
-	bool operator<(Vertex v) const;
+	bool operator<(const Vertex &v) const;
 	friend class Graph;
 	friend class Edge;
 };
@@ -254,6 +400,7 @@ class Edge {
 	bool accidented;
 	Graph* graph = nullptr;
 	Subroad* subroad;
+	int adjIndex = 0;    // Position in the source's adj or accidentedAdj
 
 public:
 	///// ***** Constructor
@@ -268,7 +415,9 @@ public:
 	///// ***** Edge CRUD
 	int getID() const;
 	double getWeight() const;
+	double getTravelTime(double departure) const;
 	Road *getRoad() const;
+	Subroad *getSubroad() const;
 	bool isAccidented() const;
 	double getDistance() const;
 	int getActualCapacity() const;
@@ -299,6 +448,11 @@ class Road {
 	const bool bothways;
 	double totalDistance = 0;
 	int maxSpeed = 0;
+	bool fixedSpeed = false;     // Set by setMaxSpeed, not estimated from the length
+
+	vector<Edge*> edges;         // Subroad edges, begin to end
+	vector<Edge*> reverseEdges;  // Reverse edges, bidirectional roads only
+	vector<double> distances;    // Cumulative distance at the end of each subroad
 
 public:
 	explicit Road(int rid, string name, bool bothways = false);
@@ -308,8 +462,15 @@ public:
 	bool isBidirectional() const;
 	double getTotalDistance() const;
 	int getMaxSpeed() const;
+	int getNumSubroads() const;
+	Edge *getEdge(int index, int direction = 1) const;
+	int findSubroad(double position, int direction = 1) const;
 
 	bool setTotalDistance(double distance);
+	bool setMaxSpeed(int speed);
+	void addEdges(Edge *edge, Edge *reverse = nullptr);
+	bool removeEdges(Edge *edge);
+	void updateTotalDistance();
 
 	friend class Subroad;
 };
@@ -328,6 +489,7 @@ class Subroad {
 
 	int actualCapacity = 0;
 	int maxCapacity = 0;
+	unsigned char timeProfile = DEFAULT_TIME_PROFILE;
 
 public:
 	explicit Subroad(double distance, Road* road);
@@ -337,8 +499,13 @@ public:
 	int getActualCapacity() const;
 	int getMaxCapacity() const;
 	int calculateAverageSpeed() const;
+	int calculateAverageSpeed(double occupancy) const;
+	int getTimeProfile() const;
+	double getFreeFlowTime() const;
+	double getTravelTime(double departure) const;
 
 	bool setActualCapacity(int actualCapacity);
+	bool setTimeProfile(int profile);
 
 	friend class Road;
 };
@@ -0,0 +1,75 @@
+#include "GraphMirror.h"
+
+/*
+ * @brief Numbers the vertices and edges of graph as it is now
+ */
+GraphMirror::GraphMirror(const Graph *graph) {
+	vertices = graph->getAllVertexSet();
+	int n = vertices.size();
+	indexes.reserve(n);
+	for (int i = 0; i < n; ++i)
+		indexes[vertices[i]] = i;
+
+	outgoing.resize(n);
+	incoming.resize(n);
+	for (int i = 0; i < n; ++i) {
+		for (auto list : {vertices[i]->getAdj(), vertices[i]->getAccidentedAdj()}) {
+			for (Edge *e : list) {
+				auto dest = indexes.find(e->getDest());
+				if (dest == indexes.end()) continue;
+				int id = edges.size();
+				edges.push_back(e);
+				edgeIndexes[e] = id;
+				sources.push_back(i);
+				targets.push_back(dest->second);
+				usable.push_back(isUsable(e));
+				outgoing[i].push_back(id);
+				incoming[dest->second].push_back(id);
+			}
+		}
+	}
+}
+
+/*
+ * @brief Whether a search may take edge e:
+ * the edge and both its ends are clear
+ */
+bool GraphMirror::isUsable(const Edge *e) {
+	return !e->isAccidented() && !e->getSource()->isAccidented() && !e->getDest()->isAccidented();
+}
+
+/*
+ * @brief Brings usable up to date after the changes reported to a
+ * listener (see Graph::addListener)
+ * @param added Set to the edges that can be taken again
+ * @param removed Set to the edges that can no longer be taken
+ * @param accidented Set to the vertices reported accidented
+ * @param fixed Set to the vertices reported fixed
+ */
+void GraphMirror::update(const vector<GraphChange> &changes, vector<int> &added, vector<int> &removed,
+		vector<int> &accidented, vector<int> &fixed) {
+	// Edges whose state may have changed
+	vector<int> affected;
+	for (const GraphChange &change : changes) {
+		if (change.event == EDGE_ACCIDENTED || change.event == EDGE_FIXED) {
+			// Edges of an accidented vertex are seen with the vertex
+			if (change.vertex->isAccidented()) continue;
+			auto it = edgeIndexes.find(change.edge);
+			if (it != edgeIndexes.end()) affected.push_back(it->second);
+		} else if (change.event == VERTEX_ACCIDENTED || change.event == VERTEX_FIXED) {
+			auto it = indexes.find(change.vertex);
+			if (it == indexes.end()) continue;
+			int x = it->second;
+			affected.insert(affected.end(), outgoing[x].begin(), outgoing[x].end());
+			affected.insert(affected.end(), incoming[x].begin(), incoming[x].end());
+			(change.event == VERTEX_ACCIDENTED ? accidented : fixed).push_back(x);
+		}
+	}
+
+	for (int id : affected) {
+		bool now = isUsable(edges[id]);
+		if (now == (bool)usable[id]) continue;
+		usable[id] = now;
+		(now ? added : removed).push_back(id);
+	}
+}
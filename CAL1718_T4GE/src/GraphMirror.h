@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Graph.h"
+
+using namespace std;
+
+//////////////////////////
+/// Class GraphMirror ////
+//////////////////////////
+
+/**
+ * Every vertex and edge of a Graph as it was when the mirror was
+ * built, accidented or not, numbered, with the edges in and out of
+ * each vertex and whether each edge could be taken when last seen.
+ * The base of the indexes that follow the graph's accidents and
+ * fixes (ComponentIndex, SafeZoneTable).
+ */
+class GraphMirror {
+protected:
+	vector<Vertex*> vertices;
+	unordered_map<const Vertex*, int> indexes;
+	vector<Edge*> edges;
+	unordered_map<const Edge*, int> edgeIndexes;
+	vector<int> sources, targets;       // Per edge
+	vector<vector<int>> outgoing;       // Every edge out of each vertex
+	vector<vector<int>> incoming;       // Every edge into each vertex
+	vector<char> usable;                // Per edge, as last seen
+
+	explicit GraphMirror(const Graph *graph);
+
+	static bool isUsable(const Edge *e);
+	void update(const vector<GraphChange> &changes, vector<int> &added, vector<int> &removed,
+			vector<int> &accidented, vector<int> &fixed);
+};
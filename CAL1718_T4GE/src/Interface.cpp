@@ -1,5 +1,7 @@
 #include "Interface.h"
 
+#include <memory>
+
 
 // 'esc' or 'q' or 'quit'
 static const regex esc("^\\s*(?:esc|quit|q)[\\.,;]?\\s*$", regex::icase);
@@ -38,6 +40,29 @@ bool validNumberInput(string input, int max) {
 }
 
 
+// Choose a time of day (hh:mm), in hours since midnight. -1 to quit.
+double selectDepartureTime() {
+	static const regex hhmm("^\\s*([01]?\\d|2[0-3]):([0-5]\\d)\\s*$");
+
+	while (1) {
+		string input;
+		smatch match;
+		cout << endl << "Departure time, hh:mm (esc to quit): ";
+		cin >> input;
+
+		if (regex_match(input, match, hhmm)) {
+			return stoi(match[1]) + stoi(match[2]) / 60.0;
+		}
+		else if (regex_match(input, esc)) {
+			return -1;
+		} else {
+			cout << "Invalid time (" << input << "). Try again !" << endl << endl;
+		}
+	}
+}
+
+
+
 // Choose an option from the range 1..MAX.
 int selectIterations() {
 	while (1) {
@@ -85,7 +110,7 @@ int selectOption(int max) {
  * node IDs are hidden once again.
  * @param maybeAccidented If the vertex may be accidented.
  */
-Vertex* selectVertex(bool maybeAccidented) {
+Vertex* selectVertex(Graph *graph, bool maybeAccidented) {
 	graph->showAllVertexLabels();
 	graph->update();
 	Vertex* selected;
@@ -137,7 +162,7 @@ Vertex* selectVertex(bool maybeAccidented) {
  * node IDs are hidden once again.
  * @param maybeAccidented If the vertex may be accidented.
  */
-Vertex* selectOriginVertex(bool maybeAccidented) {
+Vertex* selectOriginVertex(Graph *graph, bool maybeAccidented) {
 	graph->showAllVertexLabels();
 	graph->update();
 	Vertex* selected;
@@ -192,14 +217,14 @@ Vertex* selectOriginVertex(bool maybeAccidented) {
  * are temporarily displayed. Once finished the
  * node IDs are hidden once again.
  * @param maybeAccidented If the vertex may be accidented
- * @param mustBeReachable If the vertex has to be reachable from origin
+ * @param reachable If given, the vertex has to be reachable from origin
+ * by this component index of the graph
  * (1) maybeAccidented -> if the destination vertex can be accidented or not
- * (2) mustBeReachable -> if the destination vertex must be tagged as reachable (->getPath() not null)
+ * (2) reachable -> if the destination vertex must be reachable from origin
  */
-Vertex* selectDestinationVertex(Vertex* origin, bool maybeAccidented, bool mustBeReachable) {
+Vertex* selectDestinationVertex(Graph *graph, Vertex* origin, bool maybeAccidented, const ComponentIndex *reachable) {
 	graph->showAllVertexLabels();
 	graph->update();
-	if (mustBeReachable) graph->bfs(origin);
 	Vertex* selected;
 
 	while (1) {
@@ -216,7 +241,7 @@ Vertex* selectDestinationVertex(Vertex* origin, bool maybeAccidented, bool mustB
 					cout << "Accidented node (" << v->getID() << "). Try again !" << endl << endl;
 					continue;
 				}
-				else if (mustBeReachable && !v->getPath()) { // Unreachable vertex
+				else if (reachable != nullptr && !reachable->reaches(origin, v)) { // Unreachable vertex
 					cout << "Node not reachable (" << v->getID() << "). Try again !" << endl << endl;
 					continue;
 				}
@@ -242,7 +267,6 @@ Vertex* selectDestinationVertex(Vertex* origin, bool maybeAccidented, bool mustB
 
 	graph->hideAllVertexLabels();
 	graph->update();
-	if (mustBeReachable) graph->clear();
 	return selected;
 }
 
@@ -254,7 +278,7 @@ Vertex* selectDestinationVertex(Vertex* origin, bool maybeAccidented, bool mustB
  * edge IDs are hidden once again.
  * @param maybeAccidented If the vertex may be accidented.
  */
-Edge* selectEdge(bool maybeAccidented) {
+Edge* selectEdge(Graph *graph, bool maybeAccidented) {
 	graph->showAllEdgeLabels();
 	graph->update();
 	Edge* selected;
@@ -298,17 +322,52 @@ Edge* selectEdge(bool maybeAccidented) {
 	return selected;
 }
 
+/**
+ * @brief Choose an area of the Graph, as the polygon
+ * with the chosen nodes for corners, in order.
+ * Corners are chosen until esc (see selectVertex).
+ * @return The corners' coordinates, empty if fewer than 3
+ */
+vector<pair<double, double>> selectArea(Graph *graph) {
+	vector<pair<double, double>> corners;
+
+	cout << "Select the area's corners, in order" << endl;
+	while (Vertex *v = selectVertex(graph, true)) {
+		corners.push_back({v->getX(), v->getY()});
+		cout << corners.size() << " corners selected" << endl << endl;
+	}
+
+	if (corners.size() < 3) {
+		cout << "An area needs at least 3 corners" << endl;
+		corners.clear();
+	}
+	return corners;
+}
+
 
 /**
  * @brief Initialises and loops the interactive Menu tree.
+ * @param maps The loaded maps
+ * @param name The map to start with, loaded in maps
  */
-void mainMenu() {
+void mainMenu(MapRegistry &maps, string name) {
 	system("cls");
 
 	int option;
 
+	// Evacuation routes and reachability of each map, dropped with it
+	map<string, unique_ptr<RouteCache>> routes;
+	map<string, unique_ptr<ComponentIndex>> components;
+	maps.setUnloadHandler([&](const string &name, Graph*) {
+		routes.erase(name);
+		components.erase(name);
+	});
+
 	while (1) {
-		cout << "Main Menu" << endl << endl;
+		Graph *graph = maps.get(name);
+		if (!components[name]) components[name].reset(new ComponentIndex(graph));
+
+		cout << "Main Menu (" << name << ")" << endl << endl;
 
 		cout << "1 - Cause an accident" << endl;
 		cout << "2 - Fix accident" << endl;
@@ -316,33 +375,48 @@ void mainMenu() {
 		cout << "4 - Get shortest path" << endl;
 		cout << "5 - Emergency line" << endl;
 		cout << "6 - System information" << endl;
-		cout << "7 - Exit" << endl << endl;
-
-		option = selectOption(7);
-		if ((option == 7) || (option == 8))  return;
+		cout << "7 - Apply map changes" << endl;
+		cout << "8 - Switch map" << endl;
+		cout << "9 - Exit" << endl << endl;
+
+		option = selectOption(9);
+		if ((option == 9) || (option == 10)) {
+			maps.setUnloadHandler(nullptr);
+			return;
+		}
 
 		system("cls");
 
 		switch (option)
 		{
 		case 1:
-			causeAccident();
+			causeAccident(graph);
 			break;
 		case 2:
-			fixAccident();
+			fixAccident(graph);
 			break;
 		case 3:
-			editRoadInfo();
+			editRoadInfo(graph);
 			break;
 		case 4:
-			shortestPathUI();
+			shortestPathUI(graph, *components[name]);
 			break;
 		case 5:
-			emergencyLine();
+			if (!routes[name]) routes[name].reset(new RouteCache(graph));
+			emergencyLine(graph, *routes[name], *components[name]);
 			break;
 		case 6:
 			systemInformation();
 			break;
+		case 7:
+			// Built again from the changed graph on next use
+			routes.erase(name);
+			components.erase(name);
+			applyMapChanges(maps, name);
+			break;
+		case 8:
+			name = selectMap(maps, name);
+			break;
 		}
 
 		system("cls");
@@ -366,3 +440,71 @@ void systemInformation() {
 
 	system("pause");
 }
+
+
+/**
+ * @brief Choose the map to work on, loading it if not loaded yet
+ * (which may unload the least recently used ones).
+ * @param current The map in use
+ * @return The chosen map, current if none was chosen
+ */
+string selectMap(MapRegistry &maps, string current) {
+	cout << "Switch map" << endl << endl;
+
+	cout << "Loaded maps (" << maps.getMemoryUsage() / 1024 << " of "
+			<< maps.getBudget() / 1024 << " KB):" << endl;
+	for (const string &name : maps.getLoaded()) {
+		cout << " " << name << " (" << maps.getMemoryUsage(name) / 1024 << " KB)"
+				<< (name == current ? " <- current" : "") << endl;
+	}
+	cout << endl;
+
+	while (1) {
+		string input;
+		cout << "Map name (esc to quit): ";
+		cin >> input;
+
+		if (regex_match(input, esc)) {
+			return current;
+		}
+		else if (!maps.exists(input)) {
+			cout << "Invalid map (" << input << "). Try again !" << endl << endl;
+			continue;
+		}
+
+		if (!maps.isLoaded(input)) cout << endl << "Loading map information ..";
+		if (maps.get(input) != nullptr) return input;
+		cout << "Could not load map " << input << ". Try again !" << endl << endl;
+	}
+}
+
+
+/**
+ * @brief Applies the changes of a delta file (see loadDelta)
+ * to the current map, e.g. roads opened or closed since it was loaded
+ * @param name The current map, loaded in maps
+ */
+void applyMapChanges(MapRegistry &maps, const string &name) {
+	cout << "Apply map changes (" << name << ")" << endl << endl;
+
+	string input;
+	cout << "Delta file (q to quit): ";
+	cin >> input;
+	if (regex_match(input, esc)) return;
+
+	Graph *graph = maps.get(name);
+	int vertices = graph->getNumVertices();
+	int roads = graph->getRoadsInfo().size();
+
+	int result = maps.applyDelta(name, input);
+	if (result == -1) {
+		cout << "Could not open " << input << "." << endl << endl;
+	}
+	else {
+		if (result != 0) cout << "Only the changes before that line were applied." << endl;
+		cout << "Nodes: " << vertices << " -> " << graph->getNumVertices() << endl;
+		cout << "Roads: " << roads << " -> " << graph->getRoadsInfo().size() << endl << endl;
+	}
+
+	system("pause");
+}
@@ -6,30 +6,41 @@
 #include <regex>
 
 #include "Graph.h"
+#include "MapRegistry.h"
+#include "Components.h"
+#include "RouteCache.h"
 
 //////////////////////////
 // Functions Prototypes //
 //////////////////////////
 
-void mainMenu();
-void causeAccident();
-void fixAccident();
-void editRoadInfo();
-void shortestPathUI();
-void emergencyLine();
+void mainMenu(MapRegistry &maps, string name);
+void causeAccident(Graph *graph);
+void fixAccident(Graph *graph);
+void editRoadInfo(Graph *graph);
+void shortestPathUI(Graph *graph, ComponentIndex &components);
+void emergencyLine(Graph *graph, RouteCache &routes, ComponentIndex &components);
 void systemInformation();
+string selectMap(MapRegistry &maps, string current);
+void applyMapChanges(MapRegistry &maps, const string &name);
 
 
 bool validNumberInput(string input, int max = 0);
 
 int selectIterations();
 
+double selectDepartureTime();
+
 int selectOption(int max);
 
-Vertex* selectVertex(bool maybeAccidented = true);
+Vertex* selectVertex(Graph *graph, bool maybeAccidented = true);
+
+Vertex* selectOriginVertex(Graph *graph, bool maybeAccidented = true);
+
+bool colorUnreachableNodes(Graph *graph, const ComponentIndex &components, Vertex *origin, Vertex *destination = nullptr);
 
-Vertex* selectOriginVertex(bool maybeAccidented = true);
+Vertex* selectDestinationVertex(Graph *graph, Vertex* origin, bool maybeAccidented = true, const ComponentIndex *reachable = nullptr);
 
-Vertex* selectDestinationVertex(Vertex* origin, bool maybeAccidented = true, bool mustBeReachable = false);
+Edge* selectEdge(Graph *graph, bool maybeAccidented = true);
 
-Edge* selectEdge(bool maybeAccidented = true);
+vector<pair<double, double>> selectArea(Graph *graph);
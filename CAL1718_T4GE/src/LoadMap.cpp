@@ -1,4 +1,5 @@
 #include "LoadMap.h"
+#include "SearchAlgorithms.h"
 
 #include <fstream>
 #include <iostream>
@@ -6,6 +7,7 @@
 #include <stdexcept>
 #include <stdlib.h>
 #include <regex>
+#include <set>
 #include <math.h>
 
 static map<long long, int> nodeIdMap;
@@ -32,14 +34,45 @@ static bool toBool(string match) {
 	return static_cast<bool>(stoi(match));
 }
 
+/*
+ * For use by the load functions
+ * Reads a line, dropping the carriage return of CRLF
+ * terminated files when not read in text mode
+ */
+static istream& readLine(istream &file, string &line) {
+	getline(file, line);
+	if (!line.empty() && line.back() == '\r')
+		line.pop_back();
+	return file;
+}
+
+/*
+ * For use by getX and toGraphCoordinates
+ * @param longitude The longitude.
+ * @return The exact (unrounded) X coordinate on the GraphViewer map.
+ */
+static long double projectX(long double longitude, const MetaData &meta) {
+	// X grows from left to right
+	return meta.width * ((longitude - meta.min_longitude) / (meta.max_longitude - meta.min_longitude));
+}
+
+/*
+ * For use by getY and toGraphCoordinates
+ * @param latitude The latitude.
+ * @return The exact (unrounded) Y coordinate on the GraphViewer map.
+ */
+static long double projectY(long double latitude, const MetaData &meta) {
+	// Y grows from top to bottom
+	return meta.height * ((meta.max_latitude - latitude) / (meta.max_latitude - meta.min_latitude));
+}
+
 /*
  * For use by loadNodes
  * @param longitude The node's longitude.
  * @return The node's assigned X coordinate on the GraphViewer map.
  */
 static int getX(long double longitude, MetaData &meta) {
-	// X grows from left to right
-	return floor(meta.width * ((longitude - meta.min_longitude) / (meta.max_longitude - meta.min_longitude)));
+	return floor(projectX(longitude, meta));
 }
 
 /*
@@ -48,8 +81,7 @@ static int getX(long double longitude, MetaData &meta) {
  * @return The node's assigned Y coordinate on the GraphViewer map.
  */
 static int getY(long double latitude, MetaData &meta) {
-	// Y grows from top to bottom
-	return floor(meta.height * ((meta.max_latitude - latitude) / (meta.max_latitude - meta.min_latitude)));
+	return floor(projectY(latitude, meta));
 }
 
 /*
@@ -182,19 +214,31 @@ bool checkFilename(string filename) {
  * @return Standard Success/Error
  */
 int loadMap(string filename, Graph* &graph, bool boundaries) {
+	MetaData meta;
+	return loadMap(filename, graph, meta, boundaries);
+}
+
+/*
+ * @brief Same as loadMap above, also keeping the map's
+ * meta data, needed to place geographic coordinates
+ * on the graph (see toGraphCoordinates)
+ * @param meta Filled with the map's meta data
+ * @param viewer Whether to display the map in a GraphViewer window
+ * @param order Order of the vertices in memory (see Graph::reorderVertices)
+ */
+int loadMap(string filename, Graph* &graph, MetaData &meta, bool boundaries, bool viewer, VertexOrder order) {
 	// Exit if any of the 4 files is not found
 	if (!checkFilename(filename)) {
 		return -1;
 	}
 
 	// Load meta data
-	MetaData meta;
 	if (loadMeta(filename + meta_suffix, meta) != 0) {
 		return -1;
 	}
 
 	// Initialize the graph
-	graph = new Graph(meta.width, meta.height, meta.scale);
+	graph = new Graph(meta.width, meta.height, meta.scale, viewer);
 
 	if (meta.boundaries) graph->showBoundaries();
 
@@ -206,6 +250,7 @@ int loadMap(string filename, Graph* &graph, bool boundaries) {
 	if (loadNodes(filename + nodes_suffix, meta, graph) != 0) {
 		return -1;
 	}
+	graph->buildSpatialIndex();
 	if (loadRoads(filename + roads_suffix, meta, graph) != 0) {
 		return -1;
 	}
@@ -213,7 +258,34 @@ int loadMap(string filename, Graph* &graph, bool boundaries) {
 		return -1;
 	}
 
-	// Release auxiliary memory
+	// Optional: changes since the map files were generated
+	ifstream delta(filename + delta_suffix);
+	if (delta.is_open()) {
+		delta.close();
+		if (loadDelta(filename + delta_suffix, meta, graph) != 0) {
+			return -1;
+		}
+	}
+
+	// Vertices close on the map close in memory
+	graph->reorderVertices(order);
+	graph->updateMaxSpeed();
+
+	// Release auxiliary memory, and the roads the graph does not
+	// own: those named as another and with no edge
+	set<Road*> used;
+	for (auto &pair : graph->getRoadsInfo())
+		used.insert(pair.second);
+	for (auto vertex : graph->getAllVertexSet()) {
+		for (auto list : {vertex->getAdj(), vertex->getAccidentedAdj()}) {
+			for (auto edge : list)
+				used.insert(edge->getRoad());
+		}
+	}
+	for (auto &pair : roadMap) {
+		if (used.find(pair.second) == used.end())
+			delete pair.second;
+	}
 	nodeIdMap.clear();
 	roadIdMap.clear();
 	roadMap.clear();
@@ -222,6 +294,28 @@ int loadMap(string filename, Graph* &graph, bool boundaries) {
 	return 0;
 }
 
+/*
+ * @brief Converts a geographic position to the (exact, unrounded)
+ * graph coordinates used by the vertices of the map described by meta
+ */
+void toGraphCoordinates(long double latitude, long double longitude, const MetaData &meta, double &x, double &y) {
+	x = projectX(longitude, meta);
+	y = projectY(latitude, meta);
+}
+
+/*
+ * @brief Finds the point of the road network closest to a
+ * geographic position (e.g. a GPS reading), so that routing
+ * can start in the middle of a subroad
+ * @param maybeAccidented If the edge may be accidented
+ * @return The closest edge, the offset along it and the projected point
+ */
+EdgeSnap snapToEdge(long double latitude, long double longitude, const MetaData &meta, Graph* graph, bool maybeAccidented) {
+	double x, y;
+	toGraphCoordinates(latitude, longitude, meta, x, y);
+	return graph->snapToEdge(x, y, maybeAccidented);
+}
+
 // ** Meta: attr=val;
 //    attr ?= ?(-?\d+\.?\d*)[.;,]       for long doubles
 //    attr ?= ?(\d+)[.;,]               for ints
@@ -355,7 +449,7 @@ int loadNodes(string filename, MetaData &meta, Graph* graph) {
 		return -1;
 
 	string line;
-	getline(file, line);
+	readLine(file, line);
 
 	int newNodes = 0, lineID = 1;
 
@@ -398,13 +492,15 @@ int loadNodes(string filename, MetaData &meta, Graph* graph) {
 		}
 
 		++lineID;
-		getline(file, line);
+		readLine(file, line);
 	}
 
 	if (newNodes != meta.nodes) {
 		cout << "Warning: Loaded only " << newNodes << " out of " << meta.nodes << " nodes." << endl;
-		cout << "Press OK to continue..." << endl;
-		system("pause");
+		if (graph->hasViewer()) {
+			cout << "Press OK to continue..." << endl;
+			system("pause");
+		}
 	}
 
 	file.close();
@@ -428,7 +524,7 @@ int loadRoads(string filename, MetaData &meta, Graph* graph) {
 		return -1;
 
 	string line;
-	getline(file, line);
+	readLine(file, line);
 
 	int newRoads = 0, lineID = 1;
 
@@ -457,8 +553,11 @@ int loadRoads(string filename, MetaData &meta, Graph* graph) {
 				Road* road = new Road(lineID, name, bothways);
 
 				// Add road information to map if dont exist already
-				if (graph->getRoadsInfo().find(name) == graph->getRoadsInfo().end())
+				// and index it by its normalized name for searching
+				if (graph->getRoadsInfo().find(name) == graph->getRoadsInfo().end()) {
 					graph->getRoadsInfo().insert({name, road});
+					graph->getRoadsIndex().insert({normalizeText(name), road});
+				}
 
 				roadMap[lineID] = road;
 				++newRoads;
@@ -472,7 +571,7 @@ int loadRoads(string filename, MetaData &meta, Graph* graph) {
 		}
 
 		++lineID;
-		getline(file, line);
+		readLine(file, line);
 	}
 
 	file.close();
@@ -495,11 +594,12 @@ int loadSubroads(string filename, MetaData &meta, Graph* graph) {
 		return -1;
 
 	string line;
-	getline(file, line);
+	readLine(file, line);
 
 	int newSubroads = 0, subRoadID = 1, lineID = 1;
 	Road* currentRoad = nullptr;
 	vector<Subroad*> subroads;
+	vector<Subroad*> unused;    // Subroads none of whose edges could be added
 
 	while (!file.eof() && !file.fail()) {
 		smatch match;
@@ -543,14 +643,24 @@ int loadSubroads(string filename, MetaData &meta, Graph* graph) {
 				// Load subroad
 				Subroad* subroad = new Subroad(distance, currentRoad);
 				subroads.push_back(subroad);
-				graph->addEdge(subRoadID, v1, v2, subroad);
+				Edge* edge = nullptr;
+				Edge* reverse = nullptr;
+				if (graph->addEdge(subRoadID, v1, v2, subroad))
+					edge = graph->getEdge(subRoadID);
 				++newSubroads;
 				++subRoadID;
 				if (currentRoad->isBidirectional()) {
 					// Add reverse edge
-					graph->addEdge(subRoadID, v2, v1, subroad);
+					if (graph->addEdge(subRoadID, v2, v1, subroad))
+						reverse = graph->getEdge(subRoadID);
 					++subRoadID;
 				}
+
+				// Index the subroad's edges in its Road
+				if (edge != nullptr && (reverse != nullptr || !currentRoad->isBidirectional()))
+					currentRoad->addEdges(edge, reverse);
+				else if (edge == nullptr && reverse == nullptr)
+					unused.push_back(subroad);
 			} catch (exception &e) {
 				cerr << e.what() << endl;
 				cerr << "Error on file " << filename << endl;
@@ -561,7 +671,7 @@ int loadSubroads(string filename, MetaData &meta, Graph* graph) {
 		}
 
 		++lineID;
-		getline(file, line);
+		readLine(file, line);
 	}
 
 	if (currentRoad != nullptr) {
@@ -573,6 +683,10 @@ int loadSubroads(string filename, MetaData &meta, Graph* graph) {
 		subroads.clear();
 	}
 
+	// The graph only owns the subroads of its edges
+	for (auto subroad : unused)
+		delete subroad;
+
 	if (newSubroads != meta.edges) {
 		cout << "Warning: Loaded only " << newSubroads << " out of " << meta.edges << " subroads." << endl;
 		cout << "Press OK to continue..." << endl;
@@ -583,6 +697,132 @@ int loadSubroads(string filename, MetaData &meta, Graph* graph) {
 	return 0;
 }
 
+// ** Delta: operation;arguments...   (one change per line, in order)
+//    add_node;node_id;lat_deg;long_deg
+//    remove_node;node_id
+//    add_road;road_name;two_way
+//    remove_road;road_name
+//    set_road;road_name;max_speed
+//    add_subroad;road_name;node1_id;node2_id
+//    remove_subroad;node1_id;node2_id
+// -> ECMAScript (icase)
+// Node ids are the graph's vertex ids (the line of the node in the
+// nodes file), not the ids in the file: those are gone after loading.
+// Roads are named as in roadsInfo. Empty lines and lines starting
+// with # are skipped. Applies to an already loaded graph, keeping
+// its indexes, roadsInfo and the roads' total distance up to date;
+// snapshots taken from the graph (CompactGraph, OverlayGraph...)
+// must be built again.
+int loadDelta(string filename, MetaData &meta, Graph* graph) {
+	static const regex reg_add_node("^add_node;(\\d+);(-?\\d+.?\\d*);(-?\\d+.?\\d*);?$", regex::icase);
+	static const regex reg_remove_node("^remove_node;(\\d+);?$", regex::icase);
+	static const regex reg_add_road("^add_road;(.*?);(False|True);?$", regex::icase);
+	static const regex reg_remove_road("^remove_road;(.*?);?$", regex::icase);
+	static const regex reg_set_road("^set_road;(.*?);(\\d+);?$", regex::icase);
+	static const regex reg_add_subroad("^add_subroad;(.*?);(\\d+);(\\d+);?$", regex::icase);
+	static const regex reg_remove_subroad("^remove_subroad;(\\d+);(\\d+);?$", regex::icase);
+
+	ifstream file(filename);
+	if (!file.is_open())
+		return -1;
+
+	// Ids for new roads follow the highest in use
+	int roadID = 0;
+	for (auto &pair : graph->getRoadsInfo())
+		roadID = max(roadID, pair.second->getID());
+
+	const auto getVertex = [&graph](string id) -> Vertex* {
+		Vertex *v = graph->getVertex(stoi(id));
+		if (v == nullptr) throw invalid_argument("Vertex " + id + " not found");
+		return v;
+	};
+	const auto getRoad = [&graph](string name) -> Road* {
+		Road *road = graph->findRoad(name);
+		if (road == nullptr) throw invalid_argument("Road " + name + " not found");
+		return road;
+	};
+
+	string line;
+	int lineID = 0;
+
+	while (readLine(file, line)) {
+		smatch match;
+		++lineID;
+
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		try {
+			if (regex_match(line, match, reg_add_node)) {
+				// Add Node
+				long double latitude = stold(match[2]);
+				long double longitude = stold(match[3]);
+				if (!graph->addVertex(stoi(match[1]), getX(longitude, meta), getY(latitude, meta)))
+					throw logic_error("Repeated node " + string(match[1]));
+			}
+			else if (regex_match(line, match, reg_remove_node)) {
+				// Remove Node, with its subroads
+				graph->removeVertex(getVertex(match[1]));
+			}
+			else if (regex_match(line, match, reg_add_road)) {
+				// Add Road, with the same direction rules as loadRoads
+				bool bothways;
+				if (meta.bothways)
+					bothways = true;
+				else if (meta.oneway)
+					bothways = false;
+				else
+					bothways = toBool(match[2]);
+
+				Road* road = new Road(++roadID, match[1], bothways);
+				if (!graph->addRoad(road)) {
+					delete road;
+					throw logic_error("Repeated road " + string(match[1]));
+				}
+			}
+			else if (regex_match(line, match, reg_remove_road)) {
+				// Remove Road, with its subroads
+				graph->removeRoad(getRoad(match[1]));
+			}
+			else if (regex_match(line, match, reg_set_road)) {
+				// Set Road maximum speed
+				if (!getRoad(match[1])->setMaxSpeed(stoi(match[2])))
+					throw out_of_range("Invalid maximum speed " + string(match[2]));
+			}
+			else if (regex_match(line, match, reg_add_subroad)) {
+				// Add Subroad at the end of its Road
+				Vertex* v1 = getVertex(match[2]);
+				Vertex* v2 = getVertex(match[3]);
+				if (graph->addSubroad(getRoad(match[1]), v1, v2) == nullptr)
+					throw logic_error("Repeated subroad");
+			}
+			else if (regex_match(line, match, reg_remove_subroad)) {
+				// Remove Subroad, both directions
+				Vertex* v1 = getVertex(match[1]);
+				Vertex* v2 = getVertex(match[2]);
+				Edge* edge = v1->getEdge(v2);
+				if (edge == nullptr) throw invalid_argument("Subroad not found");
+				graph->removeSubroad(edge);
+			}
+			else {
+				throw invalid_argument("Unknown operation");
+			}
+		} catch (exception &e) {
+			cerr << e.what() << endl;
+			cerr << "Error on file " << filename << endl;
+			cerr << "Line: " << lineID << endl;
+			// The lines before were applied
+			graph->updateMaxSpeed();
+			return -2;
+		}
+	}
+
+	file.close();
+	graph->updateMaxSpeed();
+	graph->update();
+	return 0;
+}
+
 
 ////////////////////
 // Test Functions //
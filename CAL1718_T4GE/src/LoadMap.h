@@ -8,6 +8,7 @@ static const string meta_suffix = "_meta.txt";
 static const string nodes_suffix = "_nodes.txt";
 static const string roads_suffix = "_roads.txt";
 static const string subroads_suffix = "_subroads.txt";
+static const string delta_suffix = "_delta.txt";
 static constexpr long double default_density = 0.000100;
 
 
@@ -31,6 +32,13 @@ bool checkFilename(string filename);
 
 int loadMap(string filename, Graph* &graph, bool boundaries = false);
 
+int loadMap(string filename, Graph* &graph, MetaData &meta, bool boundaries = false, bool viewer = true,
+		VertexOrder order = DEFAULT_VERTEX_ORDER);
+
+void toGraphCoordinates(long double latitude, long double longitude, const MetaData &meta, double &x, double &y);
+
+EdgeSnap snapToEdge(long double latitude, long double longitude, const MetaData &meta, Graph* graph, bool maybeAccidented = false);
+
 int loadMeta(string filename, MetaData &meta);
 
 int loadNodes(string filename, MetaData &meta, Graph* graph);
@@ -39,6 +47,8 @@ int loadRoads(string filename, MetaData &meta, Graph* graph);
 
 int loadSubroads(string filename, MetaData &meta, Graph* graph);
 
+int loadDelta(string filename, MetaData &meta, Graph* graph);
+
 int testLoadMeta(string path);
 
 int testLoadNodes(string path);
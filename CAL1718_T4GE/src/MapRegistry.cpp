@@ -0,0 +1,173 @@
+#include "MapRegistry.h"
+
+#include <algorithm>
+
+/*
+ * @brief Empty registry
+ * @param resource Folder of the map files, ending in a separator
+ * @param budget Memory the loaded maps may hold, in bytes
+ * @param viewer Whether each map opens its own GraphViewer window
+ */
+MapRegistry::MapRegistry(const string &resource, size_t budget, bool viewer) :
+		resource(resource), budget(budget), viewer(viewer) {}
+
+/*
+ * @brief Unloads every map
+ */
+MapRegistry::~MapRegistry() {
+	while (!recent.empty())
+		unload(recent.back());
+}
+
+/*
+ * @brief (Private) Marks a loaded map as the most recently used
+ */
+void MapRegistry::use(const string &name) {
+	auto it = find(recent.begin(), recent.end(), name);
+	if (it != recent.begin()) recent.splice(recent.begin(), recent, it);
+}
+
+/*
+ * @brief (Private) Unloads the least recently used maps,
+ * other than keep, until the loaded maps fit the budget
+ */
+void MapRegistry::evict(const string &keep) {
+	while (getMemoryUsage() > budget) {
+		auto victim = find_if(recent.rbegin(), recent.rend(), [&](const string &name) { return name != keep; });
+		if (victim == recent.rend()) return;
+		unload(*victim);
+	}
+}
+
+/*
+ * @brief Files of a map: bare names are looked up in the
+ * resource folder, anything with a separator is taken as a path
+ */
+string MapRegistry::getFilename(const string &name) const {
+	if (name.find_first_of("/\\") != string::npos) return name;
+	return resource + name;
+}
+
+/*
+ * @brief Checks if the files of a map exist, loaded or not
+ */
+bool MapRegistry::exists(const string &name) const {
+	return isLoaded(name) || checkFilename(getFilename(name));
+}
+
+bool MapRegistry::isLoaded(const string &name) const {
+	return maps.count(name) > 0;
+}
+
+/*
+ * @brief Returns the graph of a map, loading it first if needed,
+ * which may unload other maps (see class description)
+ * @return The map's graph, nullptr if it could not be loaded
+ */
+Graph* MapRegistry::get(const string &name) {
+	auto it = maps.find(name);
+	if (it != maps.end()) {
+		use(name);
+		return it->second.graph;
+	}
+
+	if (!checkFilename(getFilename(name))) return nullptr;
+
+	Entry entry;
+	if (loadMap(getFilename(name), entry.graph, entry.meta, false, viewer) != 0) {
+		delete entry.graph;
+		return nullptr;
+	}
+	entry.memory = entry.graph->getMemoryUsage();
+
+	maps[name] = entry;
+	recent.push_front(name);
+	evict(name);
+	return entry.graph;
+}
+
+/*
+ * @brief Returns the meta data of a loaded map, nullptr if not loaded
+ */
+const MetaData* MapRegistry::getMeta(const string &name) const {
+	auto it = maps.find(name);
+	return it != maps.end() ? &it->second.meta : nullptr;
+}
+
+/*
+ * @brief Applies the changes of a delta file (see loadDelta) to a
+ * loaded map, which may unload others if it grows over the budget.
+ * Snapshots taken from its graph must be built again.
+ * @return That of loadDelta, -1 if the map is not loaded
+ */
+int MapRegistry::applyDelta(const string &name, const string &filename) {
+	auto it = maps.find(name);
+	if (it == maps.end()) return -1;
+
+	use(name);
+	int result = loadDelta(filename, it->second.meta, it->second.graph);
+	it->second.memory = it->second.graph->getMemoryUsage();
+	evict(name);
+	return result;
+}
+
+/*
+ * @brief Unloads a map, destroying its graph
+ * @return false if the map was not loaded
+ */
+bool MapRegistry::unload(const string &name) {
+	auto it = maps.find(name);
+	if (it == maps.end()) return false;
+
+	if (unloadHandler) unloadHandler(name, it->second.graph);
+	delete it->second.graph;
+	maps.erase(it);
+	recent.remove(name);
+	return true;
+}
+
+/*
+ * @brief Names of the loaded maps, most recently used first
+ */
+vector<string> MapRegistry::getLoaded() const {
+	return vector<string>(recent.begin(), recent.end());
+}
+
+/*
+ * @brief Memory held by all loaded maps, in bytes
+ */
+size_t MapRegistry::getMemoryUsage() const {
+	size_t total = 0;
+	for (auto &pair : maps)
+		total += pair.second.memory;
+	return total;
+}
+
+/*
+ * @brief Memory held by one map when it was loaded, 0 if not loaded
+ */
+size_t MapRegistry::getMemoryUsage(const string &name) const {
+	auto it = maps.find(name);
+	return it != maps.end() ? it->second.memory : 0;
+}
+
+size_t MapRegistry::getBudget() const {
+	return budget;
+}
+
+/*
+ * @brief Changes the budget, unloading maps (all but the most
+ * recently used) until the loaded ones fit in it
+ */
+void MapRegistry::setBudget(size_t budget) {
+	this->budget = budget;
+	if (!recent.empty()) evict(recent.front());
+}
+
+/*
+ * @brief Sets a function called with each map about to be unloaded,
+ * for whatever was built over its graph to be dropped
+ */
+void MapRegistry::setUnloadHandler(function<void(const string &name, Graph *graph)> handler) {
+	unloadHandler = handler;
+}
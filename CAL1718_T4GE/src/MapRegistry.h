@@ -0,0 +1,68 @@
+#pragma once
+
+#include "LoadMap.h"
+
+#include <functional>
+#include <list>
+#include <map>
+
+using namespace std;
+
+#define MAP_RESOURCE_PREFIX    "./resource/"
+#define MAP_MEMORY_BUDGET      ((size_t)512 << 20) // Bytes
+
+//////////////////////////
+/// Class MapRegistry ////
+//////////////////////////
+
+/**
+ * Several maps loaded at once, by name (e.g. porto, coimbra, paris).
+ * Each map has its own Graph, with its own indexes and viewer, and
+ * shares nothing with the others.
+ *
+ * Maps are loaded on first use. When the memory held by the loaded
+ * maps (see Graph::getMemoryUsage) goes over the budget, the least
+ * recently used are unloaded, always keeping the one just requested.
+ * Graph pointers of a map are invalid once it is unloaded.
+ */
+class MapRegistry {
+	struct Entry {
+		Graph *graph = nullptr;
+		MetaData meta;
+		size_t memory = 0;
+	};
+
+	string resource;
+	size_t budget;
+	bool viewer;
+	map<string, Entry> maps;
+	list<string> recent;     // Loaded maps, most recently used first
+	function<void(const string&, Graph*)> unloadHandler;
+
+	void use(const string &name);
+	void evict(const string &keep);
+
+public:
+	explicit MapRegistry(const string &resource = MAP_RESOURCE_PREFIX,
+			size_t budget = MAP_MEMORY_BUDGET, bool viewer = true);
+	~MapRegistry();
+	MapRegistry(const MapRegistry&) = delete;
+	MapRegistry &operator=(const MapRegistry&) = delete;
+
+	string getFilename(const string &name) const;
+	bool exists(const string &name) const;
+	bool isLoaded(const string &name) const;
+
+	Graph *get(const string &name);
+	const MetaData *getMeta(const string &name) const;
+	int applyDelta(const string &name, const string &filename);
+	bool unload(const string &name);
+
+	vector<string> getLoaded() const;
+	size_t getMemoryUsage() const;
+	size_t getMemoryUsage(const string &name) const;
+	size_t getBudget() const;
+	void setBudget(size_t budget);
+
+	void setUnloadHandler(function<void(const string &name, Graph *graph)> handler);
+};
@@ -30,6 +30,8 @@ public:
 	T* extractMin();
 	void decreaseKey(T* x);
 	bool empty();
+	unsigned size() const;
+	size_t allocatedBytes() const;
 };
 
 // Index calculations
@@ -48,6 +50,16 @@ bool MutablePriorityQueue<T>::empty() {
 	return H.size() == 1;
 }
 
+template <class T>
+unsigned MutablePriorityQueue<T>::size() const {
+	return H.size() - 1;
+}
+
+template <class T>
+size_t MutablePriorityQueue<T>::allocatedBytes() const {
+	return H.capacity() * sizeof(T*);
+}
+
 template <class T>
 T* MutablePriorityQueue<T>::extractMin() {
 	auto x = H[1];
@@ -0,0 +1,321 @@
+#include "Overlay.h"
+#include "Graph.h"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+static const double infinity = numeric_limits<double>::infinity();
+using entry = pair<double, int>;
+
+/*
+ * @brief Builds the overlay of graph over a coordinate bisection
+ * with the given cell sizes, and customizes it
+ */
+OverlayGraph::OverlayGraph(const Graph *graph, const vector<int> &cellSizes, Metric metric) :
+		OverlayGraph(graph, bisectByCoordinates(CompactGraph(graph), cellSizes), metric) {}
+
+/*
+ * @brief Builds the overlay of graph over the given partition of its
+ * vertices (as numbered by CompactGraph), and customizes it
+ */
+OverlayGraph::OverlayGraph(const Graph *graph, const Partition &partition, Metric metric) :
+		compact(graph), partition(partition), metric(metric) {
+	int n = compact.getNumVertices();
+
+	// Boundary vertices: endpoints of edges between different cells
+	for (int l = 0; l < partition.getNumLevels(); ++l) {
+		Level level;
+		level.boundary = boundaryVertices(compact, partition, l);
+		level.position.assign(n, -1);
+		for (auto &b : level.boundary) {
+			for (size_t i = 0; i < b.size(); ++i)
+				level.position[b[i]] = i;
+		}
+
+		int offset = 0;
+		for (auto &b : level.boundary) {
+			level.offsets.push_back(offset);
+			offset += b.size() * b.size();
+		}
+		level.weights.assign(offset, infinity);
+		levels.push_back(level);
+	}
+
+	customize();
+}
+
+const CompactGraph& OverlayGraph::getCompactGraph() const {
+	return compact;
+}
+
+const Partition& OverlayGraph::getPartition() const {
+	return partition;
+}
+
+int OverlayGraph::getNumLevels() const {
+	return levels.size();
+}
+
+int OverlayGraph::getNumBoundaryVertices(int level) const {
+	int count = 0;
+	for (auto &b : levels[level].boundary)
+		count += b.size();
+	return count;
+}
+
+/*
+ * @brief Computes the cost between every pair of boundary vertices of
+ * one cell: over the original edges inside it on level 0, and over
+ * the shortcuts of its subcells and the edges between them above
+ */
+void OverlayGraph::customizeCell(int l, int cell, SearchWorkspace &workspace) {
+	Level &level = levels[l];
+	const vector<int> &boundary = level.boundary[cell];
+	const vector<int> &cells = partition.cells[l];
+	int size = boundary.size();
+	if (size == 0) return;
+
+	vector<double> &cost = workspace.cost;
+	if (cost.size() != (size_t)compact.getNumVertices())
+		cost.assign(compact.getNumVertices(), infinity);
+
+	for (int i = 0; i < size; ++i) {
+		priority_queue<entry, vector<entry>, greater<entry>> q;
+		cost[boundary[i]] = 0;
+		workspace.touched.push_back(boundary[i]);
+		q.push({0, boundary[i]});
+
+		const auto relax = [&](int w, double newcost) {
+			if (newcost < cost[w]) {
+				if (cost[w] == infinity)
+					workspace.touched.push_back(w);
+				cost[w] = newcost;
+				q.push({newcost, w});
+			}
+		};
+
+		while (!q.empty()) {
+			entry top = q.top();
+			q.pop();
+			int v = top.second;
+			if (top.first > cost[v]) continue; // Stale entry
+
+			if (l == 0) {
+				for (int e = compact.getFirstEdge(v); e < compact.getLastEdge(v); ++e) {
+					int w = compact.getTarget(e);
+					if (cells[w] == cell) relax(w, top.first + compact.getCost(e, metric));
+				}
+				continue;
+			}
+
+			// Shortcuts across the subcell of v
+			const Level &below = levels[l - 1];
+			int subcell = partition.cells[l - 1][v];
+			int from = below.position[v];
+			const vector<int> &subBoundary = below.boundary[subcell];
+			const double *weights = &below.weights[below.offsets[subcell] + from * subBoundary.size()];
+			for (size_t j = 0; j < subBoundary.size(); ++j) {
+				if (weights[j] != infinity) relax(subBoundary[j], top.first + weights[j]);
+			}
+
+			// Edges into other subcells of the same cell
+			for (int e = compact.getFirstEdge(v); e < compact.getLastEdge(v); ++e) {
+				int w = compact.getTarget(e);
+				if (cells[w] == cell && partition.cells[l - 1][w] != subcell)
+					relax(w, top.first + compact.getCost(e, metric));
+			}
+		}
+
+		double *weights = &level.weights[level.offsets[cell] + i * size];
+		for (int j = 0; j < size; ++j)
+			weights[j] = cost[boundary[j]];
+
+		for (int v : workspace.touched)
+			cost[v] = infinity;
+		workspace.touched.clear();
+	}
+}
+
+/*
+ * @brief Recomputes the shortcuts of every cell for the current
+ * costs of the edges, level by level, in parallel within each level
+ * @param threads Number of threads, 0 for one per hardware thread
+ */
+void OverlayGraph::customize(int threads) {
+	if (metric == TRAVEL_TIME) compact.refreshCosts();
+
+	if (threads <= 0) threads = defaultThreads();
+	vector<SearchWorkspace> workspaces(threads);
+
+	for (int l = 0; l < (int)levels.size(); ++l) {
+		parallelFor(levels[l].boundary.size(), threads, [&](int cell, int t) {
+			customizeCell(l, cell, workspaces[t]);
+		});
+	}
+}
+
+/*
+ * @brief Highest level on which v is in neither the origin's nor
+ * the destination's cell, -1 if there is none
+ */
+int OverlayGraph::queryLevel(int v, int origin, int destination) const {
+	for (int l = levels.size() - 1; l >= 0; --l) {
+		const vector<int> &cells = partition.cells[l];
+		if (cells[v] != cells[origin] && cells[v] != cells[destination]) return l;
+	}
+	return -1;
+}
+
+/*
+ * @brief Best path from origin to destination for the costs of the
+ * last customization
+ * @param path Set to the vertex indexes of the path, origin first,
+ * empty if the destination is unreachable
+ * @param workspace Thread's own search state, reused between calls
+ * @param stats If given, set to the work done by the search (not unpacking)
+ * @return The cost of the path, infinity if unreachable
+ */
+double OverlayGraph::route(int origin, int destination, vector<int> &path, SearchWorkspace &workspace,
+		SearchStats *stats) const {
+	SearchStats st;
+	int n = compact.getNumVertices();
+	vector<double> &cost = workspace.cost;
+	vector<int> &parent = workspace.parent;
+	vector<int> &via = workspace.via;
+	if (cost.size() != (size_t)n) cost.assign(n, infinity);
+	if (parent.size() != (size_t)n) parent.assign(n, -1);
+	if (via.size() != (size_t)n) via.assign(n, -1);
+
+	priority_queue<entry, vector<entry>, greater<entry>> q;
+	cost[origin] = 0;
+	workspace.touched.push_back(origin);
+	q.push({0, origin});
+
+	const auto relax = [&](int v, int w, double newcost, int level) {
+		++st.relaxed;
+		if (newcost < cost[w]) {
+			if (cost[w] == infinity)
+				workspace.touched.push_back(w);
+			else
+				++st.decreaseKeys;
+			cost[w] = newcost;
+			parent[w] = v;
+			via[w] = level;
+			q.push({newcost, w});
+			st.maxHeapSize = max(st.maxHeapSize, (long long)q.size());
+		}
+	};
+
+	while (!q.empty()) {
+		entry top = q.top();
+		q.pop();
+		int v = top.second;
+		if (v == destination) break;
+		if (top.first > cost[v]) continue; // Stale entry
+		++st.settled;
+
+		int l = queryLevel(v, origin, destination);
+		const int *cells = l >= 0 ? partition.cells[l].data() : nullptr;
+		if (l >= 0 && levels[l].position[v] >= 0) {
+			// Shortcuts across the cell of v
+			const Level &level = levels[l];
+			const vector<int> &boundary = level.boundary[cells[v]];
+			const double *weights = &level.weights[level.offsets[cells[v]] + level.position[v] * boundary.size()];
+			for (size_t j = 0; j < boundary.size(); ++j) {
+				if (weights[j] != infinity) relax(v, boundary[j], top.first + weights[j], l);
+			}
+		}
+		else l = -1, cells = nullptr;
+
+		// Original edges, only those leaving the cell when using its shortcuts
+		for (int e = compact.getFirstEdge(v); e < compact.getLastEdge(v); ++e) {
+			int w = compact.getTarget(e);
+			if (cells == nullptr || cells[w] != cells[v])
+				relax(v, w, top.first + compact.getCost(e, metric), -1);
+		}
+	}
+
+	double result = cost[destination];
+	if (stats) {
+		// Labels (cost, parent, via) and the touched entry of each vertex reached,
+		// and the queue, whose capacity is at least its largest size
+		st.reached = workspace.touched.size();
+		st.bytesAllocated = st.reached * (sizeof(double) + 3 * sizeof(int)) + st.maxHeapSize * sizeof(entry);
+		*stats = st;
+	}
+
+	// Path through the overlay, as (vertex, level of the edge into it)
+	vector<pair<int, int>> coarse;
+	if (result != infinity) {
+		for (int v = destination; v != origin; v = parent[v])
+			coarse.push_back({v, via[v]});
+		coarse.push_back({origin, -1});
+		reverse(coarse.begin(), coarse.end());
+	}
+
+	for (int v : workspace.touched) {
+		cost[v] = infinity;
+		parent[v] = -1;
+		via[v] = -1;
+	}
+	workspace.touched.clear();
+
+	// Replace shortcuts by the original edges they stand for
+	path.clear();
+	for (size_t i = 0; i < coarse.size(); ++i) {
+		if (i > 0 && coarse[i].second >= 0)
+			unpack(coarse[i - 1].first, coarse[i].first, coarse[i].second, path, workspace);
+		else
+			path.push_back(coarse[i].first);
+	}
+
+	return result;
+}
+
+/*
+ * @brief Appends to path the vertices after from up to to of the best
+ * path between them inside their cell of the given level
+ */
+void OverlayGraph::unpack(int from, int to, int level, vector<int> &path, SearchWorkspace &workspace) const {
+	const vector<int> &cells = partition.cells[level];
+	int cell = cells[from];
+	vector<double> &cost = workspace.cost;
+	vector<int> &parent = workspace.parent;
+
+	priority_queue<entry, vector<entry>, greater<entry>> q;
+	cost[from] = 0;
+	workspace.touched.push_back(from);
+	q.push({0, from});
+
+	while (!q.empty()) {
+		entry top = q.top();
+		q.pop();
+		int v = top.second;
+		if (v == to) break;
+		if (top.first > cost[v]) continue; // Stale entry
+
+		for (int e = compact.getFirstEdge(v); e < compact.getLastEdge(v); ++e) {
+			int w = compact.getTarget(e);
+			double newcost = top.first + compact.getCost(e, metric);
+			if (cells[w] == cell && newcost < cost[w]) {
+				if (cost[w] == infinity)
+					workspace.touched.push_back(w);
+				cost[w] = newcost;
+				parent[w] = v;
+				q.push({newcost, w});
+			}
+		}
+	}
+
+	size_t start = path.size();
+	for (int v = to; v != from && v >= 0; v = parent[v])
+		path.push_back(v);
+	reverse(path.begin() + start, path.end());
+
+	for (int v : workspace.touched) {
+		cost[v] = infinity;
+		parent[v] = -1;
+	}
+	workspace.touched.clear();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CompactGraph.h"
+#include "Partition.h"
+
+#include <vector>
+
+using namespace std;
+
+struct SearchStats;
+
+// Default cell sizes (vertices) of the overlay levels, finest first
+#define OVERLAY_CELL_SIZES     {64, 1024}
+
+//////////////////////////
+/// Class OverlayGraph ///
+//////////////////////////
+
+/**
+ * Multi-level overlay (customizable route planning) over a snapshot of
+ * a Graph. Preprocessing is split in two phases:
+ *  - the partition into nested cells and the boundary vertices of each
+ *    cell, which depend only on the topology and are built once;
+ *  - the customization, which computes the cost between every pair of
+ *    boundary vertices of every cell for the current edge costs.
+ *    Cells of the same level are independent and customized in parallel,
+ *    so it can be re-run after every change of capacities.
+ * Queries run Dijkstra over the original edges near the origin and the
+ * destination, and over the cells' shortcuts everywhere else.
+ *
+ * Accidents change the topology: build a new overlay after them.
+ */
+class OverlayGraph {
+	CompactGraph compact;
+	Partition partition;
+	Metric metric;
+
+	struct Level {
+		vector<vector<int>> boundary;   // Boundary vertices of each cell
+		vector<int> offsets;            // Start of each cell's weights
+		vector<int> position;           // Position of each vertex in its cell's boundary, -1 if inside
+		vector<double> weights;         // Cell c, from boundary i to j: offsets[c] + i * size + j
+	};
+	vector<Level> levels;
+
+	int queryLevel(int v, int origin, int destination) const;
+	void customizeCell(int level, int cell, SearchWorkspace &workspace);
+	void unpack(int from, int to, int level, vector<int> &path, SearchWorkspace &workspace) const;
+
+public:
+	OverlayGraph(const Graph *graph, const vector<int> &cellSizes = OVERLAY_CELL_SIZES, Metric metric = TRAVEL_TIME);
+	OverlayGraph(const Graph *graph, const Partition &partition, Metric metric = TRAVEL_TIME);
+
+	const CompactGraph &getCompactGraph() const;
+	const Partition &getPartition() const;
+	int getNumLevels() const;
+	int getNumBoundaryVertices(int level) const;
+
+	void customize(int threads = 0);
+
+	double route(int origin, int destination, vector<int> &path, SearchWorkspace &workspace,
+			SearchStats *stats = nullptr) const;
+};
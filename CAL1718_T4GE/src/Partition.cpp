@@ -0,0 +1,297 @@
+#include "Partition.h"
+#include "FlowNetwork.h"
+
+#include <algorithm>
+#include <functional>
+#include <math.h>
+
+int Partition::getNumLevels() const {
+	return cells.size();
+}
+
+// Reorders vertices[begin, end) so that the first part comes first,
+// returning where the second part starts. depth is the number of
+// halvings left for the part, this one included.
+using splitter = function<int(vector<int> &vertices, int begin, int end, int depth)>;
+
+/*
+ * @brief Number of halvings needed to bring n vertices down to size
+ */
+static int bisectionDepth(int n, int size) {
+	int depth = 0;
+	while (size > 0 && (n >> depth) > size) ++depth;
+	return depth;
+}
+
+/*
+ * @brief Splits vertices[begin, end) in two recursively, numbering the leaves
+ */
+static void bisect(const splitter &split, vector<int> &vertices, int begin, int end,
+		int depth, int leaf, vector<int> &leaves) {
+	if (depth == 0 || end - begin < 2) {
+		for (int i = begin; i < end; ++i)
+			leaves[vertices[i]] = leaf << depth;
+		return;
+	}
+
+	int middle = split(vertices, begin, end, depth);
+
+	bisect(split, vertices, begin, middle, depth - 1, leaf * 2, leaves);
+	bisect(split, vertices, middle, end, depth - 1, leaf * 2 + 1, leaves);
+}
+
+/*
+ * @brief Nested partition by recursive bisection, with cells of
+ * level l holding about cellSizes[l] vertices (sizes must be ascending)
+ */
+static Partition recursiveBisection(int n, const vector<int> &cellSizes, const splitter &split) {
+	Partition partition;
+	if (n == 0 || cellSizes.empty()) return partition;
+
+	vector<int> depths;
+	for (int size : cellSizes) {
+		int depth = bisectionDepth(n, size);
+		if (!depths.empty()) depth = min(depth, depths.back()); // Keep levels nested
+		depths.push_back(depth);
+	}
+
+	vector<int> vertices(n), leaves(n);
+	for (int v = 0; v < n; ++v)
+		vertices[v] = v;
+	bisect(split, vertices, 0, n, depths[0], 0, leaves);
+
+	for (int depth : depths) {
+		vector<int> cells(n);
+		for (int v = 0; v < n; ++v)
+			cells[v] = leaves[v] >> (depths[0] - depth);
+		partition.cells.push_back(cells);
+		partition.numCells.push_back(1 << depth);
+	}
+
+	return partition;
+}
+
+/*
+ * @brief Recursive coordinate bisection: each part is split in two
+ * halves by the median of its widest coordinate.
+ * Only uses the vertices' positions, so it does not depend on
+ * the edges' costs and needs computing only once per map.
+ */
+Partition bisectByCoordinates(const CompactGraph &graph, const vector<int> &cellSizes) {
+	return recursiveBisection(graph.getNumVertices(), cellSizes, [&](vector<int> &vertices, int begin, int end, int) {
+		double minX = graph.getX(vertices[begin]), maxX = minX;
+		double minY = graph.getY(vertices[begin]), maxY = minY;
+		for (int i = begin; i < end; ++i) {
+			minX = min(minX, graph.getX(vertices[i]));
+			maxX = max(maxX, graph.getX(vertices[i]));
+			minY = min(minY, graph.getY(vertices[i]));
+			maxY = max(maxY, graph.getY(vertices[i]));
+		}
+		bool horizontal = maxX - minX >= maxY - minY;
+
+		int middle = begin + (end - begin) / 2;
+		nth_element(vertices.begin() + begin, vertices.begin() + middle, vertices.begin() + end,
+				[&](int a, int b) {
+			return horizontal ? graph.getX(a) < graph.getX(b) : graph.getY(a) < graph.getY(b);
+		});
+		return middle;
+	});
+}
+
+
+
+////////////////////
+// Inertial Flow //
+////////////////////
+
+/*
+ * Unit capacity flow network over the undirected road graph
+ * restricted to one part, plus a super source and a super sink
+ */
+class CutNetwork : public FlowNetwork {
+public:
+	/*
+	 * Part vertices are numbered 0..size-1; edges are undirected pairs
+	 */
+	CutNetwork(int size, const vector<pair<int, int>> &edges, const vector<int> &sources, const vector<int> &sinks) :
+			FlowNetwork(size) {
+		for (auto &e : edges)
+			addArc(e.first, e.second, 1, 1);
+		for (int s : sources)
+			addArc(source, s, FLOW_UNLIMITED, 0);
+		for (int t : sinks)
+			addArc(t, sink, FLOW_UNLIMITED, 0);
+	}
+};
+
+/*
+ * @brief Inertial flow: each part is projected onto several lines
+ * through the plane; for each line, the first and last share of the
+ * vertices along it are connected to a source and a sink and the
+ * minimum cut between them is computed. The smallest cut found (the
+ * most balanced on ties) splits the part. Vertices left between the two
+ * extreme minimum cuts go together to the side which balances it best.
+ *
+ * No cell of any level exceeds the average cell by more than balance:
+ * the finest cells hold at most a bound, and the sources and sinks are
+ * as many as keep each side within the bound times the cells it still
+ * has to be split into, so a part cut unevenly leaves less slack to its
+ * own bisections. Each side also keeps at least (1 - balance) / 2 of
+ * the part's vertices.
+ */
+Partition inertialFlow(const CompactGraph &graph, const vector<int> &cellSizes, double balance, int lines) {
+	int n = graph.getNumVertices();
+
+	// Undirected simple graph, each edge once
+	vector<vector<int>> neighbours(n);
+	for (int v = 0; v < n; ++v) {
+		for (int e = graph.getFirstEdge(v); e < graph.getLastEdge(v); ++e) {
+			int w = graph.getTarget(e);
+			if (w == v) continue;
+			neighbours[min(v, w)].push_back(max(v, w));
+		}
+	}
+	for (auto &list : neighbours) {
+		sort(list.begin(), list.end());
+		list.erase(unique(list.begin(), list.end()), list.end());
+	}
+
+	vector<int> local(n, -1);
+	static const double pi = acos(-1.0);
+
+	// Largest finest cell (cellSizes[0] has the deepest bisection)
+	int finest = cellSizes.empty() ? 0 : bisectionDepth(n, cellSizes[0]);
+	int cells = 1 << finest;
+	int largest = max((n + cells - 1) / cells, (int)((1 + balance) * n / cells));
+
+	return recursiveBisection(n, cellSizes, [&](vector<int> &vertices, int begin, int end, int depth) {
+		int size = end - begin;
+		int largestSide = largest << (depth - 1);
+		int terminals = max(1, min(size / 2, max(size - largestSide, (int)((1 - balance) / 2 * size))));
+
+		vector<pair<int, int>> edges;
+		for (int i = begin; i < end; ++i)
+			local[vertices[i]] = i - begin;
+		for (int i = begin; i < end; ++i) {
+			for (int w : neighbours[vertices[i]]) {
+				if (local[w] >= 0) edges.push_back({i - begin, local[w]});
+			}
+		}
+
+		int bestCut = -1, bestImbalance = 0;
+		vector<char> bestSide;
+		vector<int> order(vertices.begin() + begin, vertices.begin() + end);
+
+		for (int k = 0; k < lines; ++k) {
+			double angle = pi * k / lines;
+			double dx = cos(angle), dy = sin(angle);
+			sort(order.begin(), order.end(), [&](int a, int b) {
+				return graph.getX(a) * dx + graph.getY(a) * dy < graph.getX(b) * dx + graph.getY(b) * dy;
+			});
+
+			vector<int> sources, sinks;
+			for (int i = 0; i < terminals; ++i) {
+				sources.push_back(local[order[i]]);
+				sinks.push_back(local[order[size - 1 - i]]);
+			}
+
+			CutNetwork network(size, edges, sources, sinks);
+			int cut = network.maxFlow();
+
+			vector<char> side(size);
+			int reached = 0, free = 0;
+			for (int i = 0; i < size; ++i) {
+				side[i] = network.reachedFromSource(i);
+				reached += side[i];
+				if (!side[i] && !network.reachesTheSink(i)) ++free;
+			}
+			int imbalance = abs(size - 2 * reached);
+			if (abs(size - 2 * (reached + free)) < imbalance) {
+				imbalance = abs(size - 2 * (reached + free));
+				for (int i = 0; i < size; ++i)
+					side[i] = !network.reachesTheSink(i);
+			}
+
+			if (bestCut < 0 || cut < bestCut || (cut == bestCut && imbalance < bestImbalance)) {
+				bestCut = cut;
+				bestImbalance = imbalance;
+				bestSide = side;
+			}
+		}
+
+		// Source side first, keeping the original relative order
+		stable_partition(vertices.begin() + begin, vertices.begin() + end, [&](int v) {
+			return bestSide[local[v]];
+		});
+		int middle = begin;
+		while (middle < end && bestSide[local[vertices[middle]]]) ++middle;
+
+		for (int i = begin; i < end; ++i)
+			local[vertices[i]] = -1;
+		return middle;
+	});
+}
+
+
+
+//////////////
+// Analysis //
+//////////////
+
+/*
+ * @brief Boundary vertices of each cell of a level: those with
+ * an edge to or from a vertex of another cell
+ */
+vector<vector<int>> boundaryVertices(const CompactGraph &graph, const Partition &partition, int level) {
+	const vector<int> &cells = partition.cells[level];
+	int n = graph.getNumVertices();
+
+	vector<char> boundary(n, 0);
+	for (int v = 0; v < n; ++v) {
+		for (int e = graph.getFirstEdge(v); e < graph.getLastEdge(v); ++e) {
+			int w = graph.getTarget(e);
+			if (cells[v] != cells[w]) boundary[v] = boundary[w] = 1;
+		}
+	}
+
+	vector<vector<int>> result(partition.numCells[level]);
+	for (int v = 0; v < n; ++v) {
+		if (boundary[v]) result[cells[v]].push_back(v);
+	}
+	return result;
+}
+
+/*
+ * @brief Number of cells and cut edges, boundary
+ * vertices and cell sizes of one level of a partition
+ */
+CutStats cutStatistics(const CompactGraph &graph, const Partition &partition, int level) {
+	CutStats stats;
+	const vector<int> &cells = partition.cells[level];
+	int n = graph.getNumVertices();
+
+	for (int v = 0; v < n; ++v) {
+		for (int e = graph.getFirstEdge(v); e < graph.getLastEdge(v); ++e) {
+			if (cells[v] != cells[graph.getTarget(e)]) ++stats.cutEdges;
+		}
+	}
+
+	for (auto &boundary : boundaryVertices(graph, partition, level))
+		stats.boundaryVertices += boundary.size();
+
+	vector<int> sizes(partition.numCells[level], 0);
+	for (int v = 0; v < n; ++v)
+		++sizes[cells[v]];
+
+	stats.minCell = n;
+	for (int size : sizes) {
+		if (size == 0) continue;
+		++stats.cells;
+		stats.minCell = min(stats.minCell, size);
+		stats.maxCell = max(stats.maxCell, size);
+	}
+	if (stats.cells > 0) stats.imbalance = (double)stats.maxCell * stats.cells / n - 1;
+	else stats.minCell = 0;
+
+	return stats;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "CompactGraph.h"
+
+#include <vector>
+
+using namespace std;
+
+// Inertial flow: largest imbalance of the cells of any level
+// (largest cell over the average cell, minus 1, see CutStats)
+#define INERTIAL_FLOW_BALANCE  0.25
+#define INERTIAL_FLOW_LINES    4
+
+/*
+ * Nested partition of the vertices of a CompactGraph into cells.
+ * Level 0 is the finest; every cell of a level lies within a single
+ * cell of the next (coarser) level.
+ */
+struct Partition {
+	vector<vector<int>> cells;    // cells[level][vertex], cell of each vertex
+	vector<int> numCells;         // Number of cells of each level
+
+	int getNumLevels() const;
+};
+
+/*
+ * Quality of one level of a partition
+ */
+struct CutStats {
+	int cells = 0;              // Non-empty cells
+	int cutEdges = 0;           // Edges between different cells
+	int boundaryVertices = 0;   // Vertices with an edge to or from another cell
+	int minCell = 0, maxCell = 0;
+	double imbalance = 0;       // Largest cell over the average cell, minus 1
+};
+
+///// ***** Partitioners
+Partition bisectByCoordinates(const CompactGraph &graph, const vector<int> &cellSizes);
+Partition inertialFlow(const CompactGraph &graph, const vector<int> &cellSizes,
+		double balance = INERTIAL_FLOW_BALANCE, int lines = INERTIAL_FLOW_LINES);
+/////
+
+///// ***** Analysis
+vector<vector<int>> boundaryVertices(const CompactGraph &graph, const Partition &partition, int level);
+CutStats cutStatistics(const CompactGraph &graph, const Partition &partition, int level);
+/////
@@ -0,0 +1,85 @@
+#include "Random.h"
+
+#include <atomic>
+
+#define GOLDEN_GAMMA  0x9E3779B97F4A7C15ULL
+
+static atomic<uint64_t> randomSeed(RANDOM_DEFAULT_SEED);
+
+/*
+ * @brief Sets the seed of every stream built afterwards without one
+ * (see RandomStream::RandomStream)
+ */
+void setRandomSeed(uint64_t seed) {
+	randomSeed = seed;
+}
+
+uint64_t getRandomSeed() {
+	return randomSeed;
+}
+
+/*
+ * @brief Finalizer of splitmix64: a bijection of the 64 bit integers
+ * in which every input bit flips about half of the output bits
+ */
+uint64_t mixBits(uint64_t x) {
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+
+
+//////////////////////////
+/// Class RandomStream ///
+//////////////////////////
+
+/*
+ * @brief Stream of the given purpose, index and step under the seed
+ * of setRandomSeed
+ */
+RandomStream::RandomStream(uint64_t stream, uint64_t index, uint64_t step) :
+		RandomStream(fromSeed(getRandomSeed(), stream, index, step)) {}
+
+/*
+ * @brief Stream of the given purpose, index and step under seed,
+ * whatever the seed of setRandomSeed
+ */
+RandomStream RandomStream::fromSeed(uint64_t seed, uint64_t stream, uint64_t index, uint64_t step) {
+	RandomStream random;
+	random.key = mixBits(mixBits(mixBits(mixBits(seed) + stream * GOLDEN_GAMMA) + index) + step);
+	return random;
+}
+
+/*
+ * @brief i-th number of the stream, leaving the counter as it is
+ */
+uint64_t RandomStream::at(uint64_t i) const {
+	return mixBits(key + (i + 1) * GOLDEN_GAMMA);
+}
+
+uint64_t RandomStream::next() {
+	return at(counter++);
+}
+
+/*
+ * @brief Uniform integer in [0, n), by multiply and shift (no modulo bias
+ * worth noting for the n used here)
+ */
+uint32_t RandomStream::below(uint32_t n) {
+	return (uint32_t)(((next() >> 32) * n) >> 32);
+}
+
+/*
+ * @brief Uniform double in [0, 1), from the top 53 bits
+ */
+double RandomStream::uniform() {
+	return (next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*
+ * @brief Whether an event of probability p happens
+ */
+bool RandomStream::chance(double p) {
+	return uniform() < p;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+using namespace std;
+
+// Random streams of the simulation, one per purpose, so that drawing
+// more numbers for one never shifts those of another
+#define RANDOM_STREAM_CAPACITY   1   // Initial actual capacity of each subroad
+#define RANDOM_STREAM_ACCIDENT   2   // Accidents of generateGraphNewStatus, per vertex and step
+#define RANDOM_STREAM_TRIPS      4   // Random trips of the traffic simulation
+
+#define RANDOM_DEFAULT_SEED      0x5EED
+
+///// ***** Seed of the simulation streams
+void setRandomSeed(uint64_t seed);
+uint64_t getRandomSeed();
+/////
+
+uint64_t mixBits(uint64_t x);
+
+/**
+ * Counter-based random numbers (splitmix64): the i-th number of a
+ * stream is a hash of its key and i, so it holds no hidden state but
+ * its counter. Any stream, and any number within it, can be computed
+ * on its own and in any order, from any thread, and the same seed,
+ * stream, index and step always give the same numbers.
+ *
+ * A stream is picked by a purpose (see RANDOM_STREAM_*), an index
+ * (an edge, a vertex, a trip...) and a step (of a simulation).
+ */
+class RandomStream {
+	uint64_t key;
+	uint64_t counter = 0;
+
+	RandomStream() : key(0) {}
+
+public:
+	explicit RandomStream(uint64_t stream, uint64_t index = 0, uint64_t step = 0);
+	static RandomStream fromSeed(uint64_t seed, uint64_t stream, uint64_t index = 0, uint64_t step = 0);
+
+	uint64_t at(uint64_t i) const;
+	uint64_t next();
+	uint32_t below(uint32_t n);
+	double uniform();
+	bool chance(double p);
+};
@@ -1,12 +1,25 @@
 #include <math.h>
 #include <stdlib.h>
+#include <algorithm>
 
 #include "Graph.h"
+#include "Random.h"
 
 static int maxCapacityEstimation(double distance) {
 	return 10 + (distance * 0.25);
 }
 
+static int maxSpeedEstimation(double distance) {
+	if (distance > 1500)
+		return 120;
+	else if (distance > 1000)
+		return 90;
+	else if (distance > 750)
+		return 70;
+	else
+		return 50;
+}
+
 
 
 ////////////////
@@ -36,19 +49,121 @@ int Road::getMaxSpeed() const {
 	return maxSpeed;
 }
 
+/*
+ * @brief Returns the number of subroads of the road
+ */
+int Road::getNumSubroads() const {
+	return edges.size();
+}
+
+/*
+ * @brief Returns the edge of the index-th subroad,
+ * in the given direction of travel
+ * (1 - Begin to end, 2 - End to begin).
+ * One way roads only have begin to end edges,
+ * which are then returned for both directions.
+ * @return The edge, or nullptr if index is out of range
+ */
+Edge* Road::getEdge(int index, int direction) const {
+	if (index < 0 || index >= (int)edges.size()) return nullptr;
+	if (direction == 2 && !reverseEdges.empty())
+		return reverseEdges[index];
+	return edges[index];
+}
+
+/*
+ * @brief Finds the subroad that holds the point at
+ * position meters along the road, measured from
+ * the road's beginning (direction 1) or from its end
+ * (direction 2). Positions beyond the road's length
+ * are clamped to its last subroad in that direction.
+ * @return The subroad index, -1 if the road has no subroads
+ */
+int Road::findSubroad(double position, int direction) const {
+	if (edges.empty()) return -1;
+
+	if (direction == 2) {
+		// Subroad k starts at distances[k - 1] from the beginning, so it
+		// holds the position if the road's length minus that is >= position
+		double limit = distances.back() - position;
+		if (limit < 0) return 0;
+		return upper_bound(distances.begin(), distances.end() - 1, limit) - distances.begin();
+	}
+
+	auto it = lower_bound(distances.begin(), distances.end(), position);
+	if (it == distances.end()) return edges.size() - 1;
+	return it - distances.begin();
+}
+
+/*
+ * @brief Appends the next subroad's edge (and its reverse
+ * edge, for bidirectional roads) to the road's edge index.
+ * Called by loadSubroads in subroad order.
+ */
+void Road::addEdges(Edge *edge, Edge *reverse) {
+	double previous = distances.empty() ? 0 : distances.back();
+	edges.push_back(edge);
+	if (reverse != nullptr)
+		reverseEdges.push_back(reverse);
+	distances.push_back(previous + edge->getDistance());
+}
+
+/*
+ * @brief Drops the subroad of edge (either of its directions)
+ * from the road's edge index and recomputes the distances.
+ * Called when the edge is removed from the graph.
+ * @return false if the edge was not indexed in this road
+ */
+bool Road::removeEdges(Edge *edge) {
+	auto it = find(edges.begin(), edges.end(), edge);
+	int index = it - edges.begin();
+	if (it == edges.end()) {
+		auto reverse = find(reverseEdges.begin(), reverseEdges.end(), edge);
+		if (reverse == reverseEdges.end()) return false;
+		index = reverse - reverseEdges.begin();
+	}
+
+	edges.erase(edges.begin() + index);
+	if (!reverseEdges.empty())
+		reverseEdges.erase(reverseEdges.begin() + index);
+	updateTotalDistance();
+	return true;
+}
+
+/*
+ * @brief Recomputes the cumulative distances and the total
+ * distance from the indexed subroads, after they changed.
+ * The maximum speed follows the new length unless it was set.
+ */
+void Road::updateTotalDistance() {
+	distances.clear();
+	double previous = 0;
+	for (Edge *edge : edges) {
+		previous += edge->getDistance();
+		distances.push_back(previous);
+	}
+
+	totalDistance = previous;
+	if (!fixedSpeed && totalDistance > 0)
+		maxSpeed = maxSpeedEstimation(totalDistance);
+}
+
 bool Road::setTotalDistance(double distance) {
 	if (totalDistance != 0 || distance <= 0) return false;
 	totalDistance = distance;
+	if (!fixedSpeed)
+		maxSpeed = maxSpeedEstimation(distance);
+	return true;
+}
 
-	if (distance > 1500)
-		maxSpeed = 120;
-	else if (distance > 1000)
-		maxSpeed = 90;
-	else if (distance > 750)
-		maxSpeed = 70;
-	else
-		maxSpeed = 50;
-
+/*
+ * @brief Sets the maximum speed (km/h), which from then on
+ * no longer follows the road's length
+ */
+bool Road::setMaxSpeed(int speed) {
+	if (speed <= 0) return false;
+	maxSpeed = speed;
+	fixedSpeed = true;
 	return true;
 }
 
@@ -62,7 +177,11 @@ bool Road::setTotalDistance(double distance) {
 Subroad::Subroad(double distance, Road* road):
 		distance(distance), road(road) {
 	maxCapacity = maxCapacityEstimation(distance);
-	actualCapacity = (rand() % maxCapacity);
+	// Its own stream, by road and position on it, so that it does not
+	// depend on how many subroads were made before
+	RandomStream random(RANDOM_STREAM_CAPACITY, road != nullptr ? road->getID() : 0,
+			road != nullptr ? road->getNumSubroads() : 0);
+	actualCapacity = random.below(maxCapacity);
 }
 
 Road* Subroad::getRoad() const {
@@ -82,22 +201,55 @@ int Subroad::getMaxCapacity() const {
 }
 
 int Subroad::calculateAverageSpeed() const {
+	return calculateAverageSpeed(actualCapacity);
+}
+
+/*
+ * @brief Average speed the subroad would have with occupancy
+ * cars in it (which may be fractional, or over its capacity)
+ */
+int Subroad::calculateAverageSpeed(double occupancy) const {
 	int maxSpeed = road->getMaxSpeed();
 
-	if(((double)actualCapacity/maxCapacity)*100 <= 25)
+	if((occupancy/maxCapacity)*100 <= 25)
 		return maxSpeed;
-	else if(((double)actualCapacity/maxCapacity)*100 <= 50)
+	else if((occupancy/maxCapacity)*100 <= 50)
 		return maxSpeed*0.75;
-	else if(((double)actualCapacity/maxCapacity)*100 <= 75)
+	else if((occupancy/maxCapacity)*100 <= 75)
 		return (double)maxSpeed*0.5;
-	else if(((double)actualCapacity/maxCapacity)*100 <= 90)
+	else if((occupancy/maxCapacity)*100 <= 90)
 		return (double)maxSpeed*0.2;
 
 	return (double)maxSpeed*0.1;
 }
 
+int Subroad::getTimeProfile() const {
+	return timeProfile == DEFAULT_TIME_PROFILE ? defaultTimeProfile(road->getMaxSpeed()) : timeProfile;
+}
+
+/*
+ * @brief Travel time in hours at the road's maximum speed
+ */
+double Subroad::getFreeFlowTime() const {
+	return (distance / (double)1000) / road->getMaxSpeed();
+}
+
+/*
+ * @brief Travel time in hours leaving at departure,
+ * in hours since midnight, following the subroad's profile
+ */
+double Subroad::getTravelTime(double departure) const {
+	return ::getTimeProfile(getTimeProfile()).travelTime(getFreeFlowTime(), departure);
+}
+
+bool Subroad::setTimeProfile(int profile) {
+	if (profile < 0 || profile >= getNumTimeProfiles()) return false;
+	timeProfile = profile;
+	return true;
+}
+
 bool Subroad::setActualCapacity(int capacity) {
-	if (actualCapacity <= 0 || actualCapacity > maxCapacity) return false;
+	if (capacity < 0 || capacity > maxCapacity) return false;
 	actualCapacity = capacity;
 	return true;
 }
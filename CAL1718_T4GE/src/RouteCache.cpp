@@ -0,0 +1,238 @@
+#include "RouteCache.h"
+
+#include <functional>
+
+double RouteCacheStats::hitRate() const {
+	return hits + misses > 0 ? (double)hits / (hits + misses) : 0;
+}
+
+bool RouteCache::Key::operator==(const Key &other) const {
+	return origin == other.origin && destination == other.destination && metric == other.metric;
+}
+
+size_t RouteCache::KeyHash::operator()(const Key &key) const {
+	size_t h = hash<const Vertex*>()(key.origin);
+	h = h * 31 + hash<const Vertex*>()(key.destination);
+	return h * 31 + key.metric;
+}
+
+
+
+//////////////////////////
+/// Class RouteCache /////
+//////////////////////////
+
+/*
+ * @brief Empty cache of up to capacity routes over graph
+ */
+RouteCache::RouteCache(Graph *graph, int capacity) :
+		graph(graph), capacity(max(1, capacity)) {
+	listener = graph->addListener([this](const vector<GraphChange> &changes) { changed(changes); });
+}
+
+RouteCache::~RouteCache() {
+	graph->removeListener(listener);
+}
+
+/*
+ * @brief (Private) Drops a route, and its place in the indexes
+ * of its vertices and edges
+ */
+void RouteCache::erase(list<Entry>::iterator it) {
+	Entry *entry = &*it;
+	for (Edge *e : entry->edges) {
+		auto routes = byEdge.find(e);
+		routes->second.erase(entry);
+		if (routes->second.empty()) byEdge.erase(routes);
+	}
+	for (Vertex *v : entry->route.path) {
+		auto routes = byVertex.find(v);
+		routes->second.erase(entry);
+		if (routes->second.empty()) byVertex.erase(routes);
+	}
+	index.erase(entry->key);
+	entries.erase(it);
+}
+
+/*
+ * @brief (Private) Listener of the graph: drops the routes through
+ * what was accidented or reweighted, or every route if anything
+ * was fixed (see class description), all the changes of a bulk
+ * operation at once
+ */
+void RouteCache::changed(const vector<GraphChange> &changes) {
+	for (const GraphChange &change : changes) {
+		bool back = (change.event == VERTEX_FIXED && !change.vertex->isAccidented())
+				|| (change.event == EDGE_FIXED && !change.edge->isAccidented()
+				&& !change.vertex->isAccidented() && !change.edge->getDest()->isAccidented());
+		if (back) {
+			stats.invalidated += entries.size();
+			clear();
+			return;
+		}
+	}
+
+	unordered_set<Entry*> dropped;
+	for (const GraphChange &change : changes) {
+		const unordered_set<Entry*> *routes = nullptr;
+		if (change.event == EDGE_ACCIDENTED || change.event == EDGE_REWEIGHTED) {
+			auto it = byEdge.find(change.edge);
+			if (it != byEdge.end()) routes = &it->second;
+		} else if (change.event == VERTEX_ACCIDENTED) {
+			auto it = byVertex.find(change.vertex);
+			if (it != byVertex.end()) routes = &it->second;
+		}
+		if (routes == nullptr) continue;
+
+		for (Entry *entry : *routes) {
+			if (change.event != EDGE_REWEIGHTED || entry->key.metric == TRAVEL_TIME)
+				dropped.insert(entry);
+		}
+	}
+
+	// Erasing them changes the indexes read above
+	vector<Key> keys;
+	for (Entry *entry : dropped)
+		keys.push_back(entry->key);
+	for (const Key &key : keys) {
+		erase(index.at(key));
+		++stats.invalidated;
+	}
+}
+
+/*
+ * @brief Looks up the route from origin to destination by metric,
+ * counting a hit or a miss
+ * @param route Set to the route, if kept
+ * @return Whether it was kept
+ */
+bool RouteCache::find(Vertex *origin, Vertex *destination, Metric metric, CachedRoute &route) {
+	auto it = index.find({origin, destination, metric});
+	if (it == index.end()) {
+		++stats.misses;
+		return false;
+	}
+
+	++stats.hits;
+	entries.splice(entries.begin(), entries, it->second);
+	route = it->second->route;
+	return true;
+}
+
+/*
+ * @brief Keeps the route path (origin first) from origin to
+ * destination by metric, replacing any kept before, and drops
+ * the least recently used while over capacity
+ */
+void RouteCache::insert(Vertex *origin, Vertex *destination, Metric metric, const vector<Vertex*> &path, double cost) {
+	Key key = {origin, destination, metric};
+	auto old = index.find(key);
+	if (old != index.end()) erase(old->second);
+	if (path.empty()) return;
+
+	entries.emplace_front();
+	Entry &entry = entries.front();
+	entry.key = key;
+	entry.route.found = true;
+	entry.route.path = path;
+	entry.route.cost = cost;
+	for (size_t i = 0; i + 1 < path.size(); ++i)
+		entry.edges.push_back(path[i]->getEdge(path[i + 1]));
+
+	index[key] = entries.begin();
+	for (Edge *e : entry.edges)
+		byEdge[e].insert(&entry);
+	for (Vertex *v : path)
+		byVertex[v].insert(&entry);
+
+	while ((int)entries.size() > capacity) {
+		erase(prev(entries.end()));
+		++stats.evicted;
+	}
+}
+
+/*
+ * @brief Route from origin to destination by metric: the one kept
+ * if any, else the one found by A* (DISTANCE) or Dijkstra
+ * (TRAVEL_TIME), which is then kept. Searches change the graph's
+ * path state, as any search does.
+ */
+CachedRoute RouteCache::route(Vertex *origin, Vertex *destination, Metric metric) {
+	CachedRoute route;
+	if (find(origin, destination, metric, route))
+		return route;
+
+	if (origin == destination) {
+		if (origin->isAccidented()) return route;
+		route.path = {origin};
+	} else {
+		if (metric == DISTANCE) graph->AstarDist(origin, destination);
+		else graph->dijkstraSimulation(origin, destination);
+		route.path = graph->getPath(origin, destination);
+		if (route.path.empty()) return route;
+		route.cost = destination->getCost();
+	}
+
+	route.found = true;
+	insert(origin, destination, metric, route.path, route.cost);
+	return route;
+}
+
+/*
+ * @brief Drops every route (not counted as invalidated)
+ */
+void RouteCache::clear() {
+	entries.clear();
+	index.clear();
+	byEdge.clear();
+	byVertex.clear();
+}
+
+int RouteCache::getSize() const {
+	return entries.size();
+}
+
+int RouteCache::getCapacity() const {
+	return capacity;
+}
+
+/*
+ * @brief Sets the number of routes kept, dropping the least
+ * recently used if over it
+ */
+void RouteCache::setCapacity(int capacity) {
+	this->capacity = max(1, capacity);
+	while ((int)entries.size() > this->capacity) {
+		erase(prev(entries.end()));
+		++stats.evicted;
+	}
+}
+
+/*
+ * @brief Hit rate and memory of the cache (see RouteCacheStats)
+ */
+RouteCacheStats RouteCache::getStats() const {
+	static const size_t node = 4 * sizeof(void*); // Overhead of a list or hash table entry
+
+	RouteCacheStats result = stats;
+	result.routes = entries.size();
+	result.memory = sizeof(RouteCache) + index.bucket_count() * sizeof(void*)
+			+ (byEdge.bucket_count() + byVertex.bucket_count()) * sizeof(void*);
+	for (const Entry &entry : entries) {
+		result.memory += 2 * node + sizeof(Entry) + sizeof(Key) + sizeof(list<Entry>::iterator)
+				+ entry.route.path.capacity() * sizeof(Vertex*) + entry.edges.capacity() * sizeof(Edge*)
+				+ (entry.route.path.size() + entry.edges.size()) * (node + sizeof(Entry*));
+	}
+	for (auto &routes : byEdge)
+		result.memory += node + sizeof(routes) + routes.second.bucket_count() * sizeof(void*);
+	for (auto &routes : byVertex)
+		result.memory += node + sizeof(routes) + routes.second.bucket_count() * sizeof(void*);
+	return result;
+}
+
+/*
+ * @brief Restarts the counts of hits, misses and dropped routes
+ */
+void RouteCache::resetStats() {
+	stats = RouteCacheStats();
+}
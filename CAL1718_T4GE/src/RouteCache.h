@@ -0,0 +1,109 @@
+#pragma once
+
+#include "Graph.h"
+#include "CompactGraph.h"
+
+#include <list>
+#include <unordered_set>
+
+using namespace std;
+
+#define ROUTE_CACHE_CAPACITY   4096 // Routes kept
+
+/*
+ * A route from the cache (or just searched)
+ */
+struct CachedRoute {
+	bool found = false;
+	vector<Vertex*> path;      // Origin first
+	double cost = 0;           // Meters or hours, depending on the metric
+};
+
+/*
+ * Instrumentation of a RouteCache since it was built (or its
+ * statistics were reset)
+ */
+struct RouteCacheStats {
+	long long hits = 0;
+	long long misses = 0;
+	long long invalidated = 0;   // Routes dropped by an accident or a new weight on them, or by a fix
+	long long evicted = 0;       // Routes dropped as the least recently used
+	int routes = 0;              // Routes kept now
+	size_t memory = 0;           // Bytes, estimated
+
+	double hitRate() const;      // Share of the lookups that were hits
+};
+
+//////////////////////////
+/// Class RouteCache /////
+//////////////////////////
+
+/**
+ * Least recently used cache of the routes between pairs of vertices
+ * of a Graph, by origin, destination and metric. Only routes that
+ * were found are kept.
+ *
+ * Every vertex and edge knows the routes that go through it, and the
+ * cache follows the graph (see Graph::addListener):
+ * - A route is dropped as soon as one of its edges or vertices is
+ *   accidented or, for TRAVEL_TIME routes, one of its edges is
+ *   reweighted.
+ * - A fix may open a shorter way for any route, wherever it is, so
+ *   every route is dropped when a vertex or edge comes back (once for
+ *   all the fixes of a bulk operation).
+ * A route kept is always drivable and costs what it did when found.
+ * Only an edge that got faster elsewhere can leave a better TRAVEL_TIME
+ * route unseen: clear the cache when that matters.
+ *
+ * Vertices and edges removed from the graph are not followed: clear
+ * the cache. The cache must not outlive its graph.
+ */
+class RouteCache {
+	struct Key {
+		const Vertex *origin, *destination;
+		Metric metric;
+
+		bool operator==(const Key &other) const;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key &key) const;
+	};
+
+	struct Entry {
+		Key key;
+		CachedRoute route;
+		vector<Edge*> edges;      // Of the path, in order
+	};
+
+	Graph *graph;
+	int listener;
+	int capacity;
+
+	list<Entry> entries;        // Most recently used first
+	unordered_map<Key, list<Entry>::iterator, KeyHash> index;
+	unordered_map<const Edge*, unordered_set<Entry*>> byEdge;
+	unordered_map<const Vertex*, unordered_set<Entry*>> byVertex;
+	RouteCacheStats stats;
+
+	void erase(list<Entry>::iterator it);
+	void changed(const vector<GraphChange> &changes);
+
+public:
+	explicit RouteCache(Graph *graph, int capacity = ROUTE_CACHE_CAPACITY);
+	~RouteCache();
+	RouteCache(const RouteCache&) = delete;
+	RouteCache &operator=(const RouteCache&) = delete;
+
+	bool find(Vertex *origin, Vertex *destination, Metric metric, CachedRoute &route);
+	void insert(Vertex *origin, Vertex *destination, Metric metric, const vector<Vertex*> &path, double cost);
+	CachedRoute route(Vertex *origin, Vertex *destination, Metric metric = DISTANCE);
+	void clear();
+
+	int getSize() const;
+	int getCapacity() const;
+	void setCapacity(int capacity);
+
+	RouteCacheStats getStats() const;
+	void resetStats();
+};
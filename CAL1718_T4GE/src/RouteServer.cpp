@@ -0,0 +1,431 @@
+#include "RouteServer.h"
+#include "SearchAlgorithms.h"
+
+#include <sstream>
+#include <map>
+#include <signal.h>
+
+#ifdef linux
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Server interrupted by SIGINT/SIGTERM, see run()
+static RouteServer *activeServer = nullptr;
+
+static void interruptServer(int) {
+	if (activeServer) activeServer->stop();
+}
+
+/*
+ * @brief Prepares the server over a loaded graph
+ * @param meta Meta data of the graph's map, for geographic queries
+ * @param workers Worker threads, 0 for one per hardware thread
+ */
+RouteServer::RouteServer(Graph *graph, const MetaData &meta, int port, int workers) :
+		graph(graph), meta(meta), engine(graph, DISTANCE, true, workers), port(port), running(false) {}
+
+/*
+ * @brief Answers one request line, on worker thread
+ * @return The response line, without the newline
+ */
+string RouteServer::handle(const string &line, int thread) {
+	istringstream ss(line);
+	string command;
+	ss >> command;
+	for (auto &c : command) c = toupper(c);
+
+	ostringstream out;
+	out.precision(10);
+
+	if (command == "PING") {
+		return "OK PONG";
+	}
+	else if (command == "INFO") {
+		out << "OK vertices " << engine.getNumVertices() << " workers " << engine.getThreads();
+		return out.str();
+	}
+	else if (command == "ROUTE") {
+		int origin, destination;
+		string algo = "astar", metric = "distance";
+		if (!(ss >> origin >> destination)) return "ERR usage: ROUTE origin destination [astar|dijkstra] [distance|time]";
+		ss >> algo >> metric;
+		if ((algo != "astar" && algo != "dijkstra") || (metric != "distance" && metric != "time"))
+			return "ERR usage: ROUTE origin destination [astar|dijkstra] [distance|time]";
+		if (!engine.hasVertex(origin) || !engine.hasVertex(destination)) return "ERR unknown vertex";
+
+		RouteAnswer answer = engine.route(origin, destination,
+				metric == "time" ? TRAVEL_TIME : DISTANCE, algo == "astar", thread);
+		if (!answer.found) return "ERR unreachable";
+
+		out << "OK " << answer.cost << ' ' << answer.length << ' ' << answer.path.size() - 1 << ' ';
+		for (size_t i = 0; i < answer.path.size(); ++i) {
+			if (i > 0) out << ',';
+			out << answer.path[i];
+		}
+		return out.str();
+	}
+	else if (command == "NEAREST") {
+		long double latitude, longitude;
+		if (!(ss >> latitude >> longitude)) return "ERR usage: NEAREST latitude longitude";
+
+		double x, y;
+		toGraphCoordinates(latitude, longitude, meta, x, y);
+		Vertex *v = graph->findNearestVertex(x, y);
+		if (v == nullptr) return "ERR no vertex";
+
+		out << "OK " << v->getID() << ' ' << v->getX() << ' ' << v->getY();
+		return out.str();
+	}
+	else if (command == "ROADS") {
+		string text;
+		getline(ss, text);
+		string pattern = normalizeText(text);
+		if (pattern.empty()) return "ERR usage: ROADS text";
+
+		vector<string> names;
+		for (auto &entry : graph->getRoadsIndex()) {
+			if (knuthMorrisPrattAlgorithm(entry.first, pattern)) {
+				names.push_back(entry.second->getName());
+				if (names.size() == SERVER_MAX_ROADS) break;
+			}
+		}
+
+		out << "OK " << names.size();
+		for (auto &name : names) out << '\t' << name;
+		return out.str();
+	}
+	else if (command == "QUIT") {
+		return "OK BYE";
+	}
+
+	return "ERR unknown command";
+}
+
+/*
+ * @brief Worker loop: answers requests until the server stops
+ */
+void RouteServer::work(int thread) {
+	while (true) {
+		ServerRequest request;
+		{
+			unique_lock<mutex> lock(requestsMutex);
+			requestsReady.wait(lock, [this]() { return !requests.empty() || !running; });
+			if (!running) return;
+			request = move(requests.front());
+			requests.pop_front();
+		}
+
+		ServerResponse response{request.client, request.sequence, handle(request.line, thread)};
+
+		bool wasEmpty;
+		{
+			lock_guard<mutex> lock(responsesMutex);
+			wasEmpty = responses.empty();
+			responses.push_back(move(response));
+		}
+
+		// Wake the event loop once per batch of responses
+#ifdef linux
+		if (wasEmpty) {
+			uint64_t one = 1;
+			if (write(wakeup, &one, sizeof(one)) < 0) {}
+		}
+#endif
+	}
+}
+
+/*
+ * @brief Makes run() return, may be called from any thread
+ */
+void RouteServer::stop() {
+	running = false;
+#ifdef linux
+	uint64_t one = 1;
+	if (wakeup >= 0 && write(wakeup, &one, sizeof(one)) < 0) {}
+#endif
+}
+
+
+
+#ifdef linux
+
+/*
+ * State of one client connection in the event loop
+ */
+struct ServerClient {
+	int fd;
+	string input, output;
+	long long received = 0;           // Requests read
+	long long sent = 0;               // Responses queued to output
+	map<long long, string> pending;   // Responses answered out of order
+	bool quitting = false;            // Close once everything is sent
+	bool reading = true;              // Until QUIT or end of input
+	uint32_t events = EPOLLIN;        // Registered epoll events
+};
+
+static const uint64_t listen_token = 0;
+static const uint64_t wakeup_token = 1;
+
+/*
+ * @brief Sends as much of the client's output as the socket takes
+ * @return False if the connection failed
+ */
+static bool flushClient(int epoll, uint64_t token, ServerClient &client) {
+	while (!client.output.empty()) {
+		ssize_t n = send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+			return false;
+		}
+		client.output.erase(0, n);
+	}
+
+	// Only wait for writability while there is output left
+	uint32_t events = (client.reading ? (uint32_t)EPOLLIN : 0) | (client.output.empty() ? 0 : (uint32_t)EPOLLOUT);
+	if (events != client.events) {
+		epoll_event event{};
+		event.events = events;
+		event.data.u64 = token;
+		epoll_ctl(epoll, EPOLL_CTL_MOD, client.fd, &event);
+		client.events = events;
+	}
+	return true;
+}
+
+/*
+ * @brief Whether a quitting client has been sent all its responses
+ */
+static bool finishedClient(const ServerClient &client) {
+	return client.quitting && client.sent == client.received && client.output.empty();
+}
+
+/*
+ * @brief Listens on the port and serves clients until stop()
+ * @return 0 on a clean stop, -1 if the server could not start
+ */
+int RouteServer::run() {
+	int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (listener < 0) {
+		perror("socket");
+		return -1;
+	}
+	int yes = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	if (bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, SOMAXCONN) < 0) {
+		perror("bind");
+		close(listener);
+		return -1;
+	}
+
+	int epoll = epoll_create1(0);
+	wakeup = eventfd(0, EFD_NONBLOCK);
+
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.u64 = listen_token;
+	epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+	event.data.u64 = wakeup_token;
+	epoll_ctl(epoll, EPOLL_CTL_ADD, wakeup, &event);
+
+	running = true;
+	activeServer = this;
+	signal(SIGINT, interruptServer);
+	signal(SIGTERM, interruptServer);
+
+	vector<thread> workers;
+	for (int t = 0; t < engine.getThreads(); ++t)
+		workers.emplace_back(&RouteServer::work, this, t);
+
+	cerr << "Listening on 127.0.0.1:" << port << " with " << engine.getThreads() << " workers" << endl;
+
+	map<uint64_t, ServerClient> clients;
+	uint64_t nextToken = 2;
+	epoll_event events[SERVER_MAX_EVENTS];
+	char buffer[65536];
+
+	auto closeClient = [&](uint64_t token) {
+		auto it = clients.find(token);
+		if (it == clients.end()) return;
+		epoll_ctl(epoll, EPOLL_CTL_DEL, it->second.fd, nullptr);
+		close(it->second.fd);
+		clients.erase(it);
+	};
+
+	while (running) {
+		int n = epoll_wait(epoll, events, SERVER_MAX_EVENTS, -1);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			perror("epoll_wait");
+			break;
+		}
+
+		for (int i = 0; i < n; ++i) {
+			uint64_t token = events[i].data.u64;
+
+			if (token == listen_token) {
+				while (true) {
+					int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK);
+					if (fd < 0) break;
+					setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+					ServerClient client;
+					client.fd = fd;
+					clients[nextToken] = client;
+					event.events = EPOLLIN;
+					event.data.u64 = nextToken++;
+					epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+				}
+				continue;
+			}
+
+			if (token == wakeup_token) {
+				uint64_t count;
+				if (read(wakeup, &count, sizeof(count)) < 0) {}
+
+				vector<ServerResponse> ready;
+				{
+					lock_guard<mutex> lock(responsesMutex);
+					ready.swap(responses);
+				}
+
+				// Queue responses in request order, holding back early ones
+				vector<uint64_t> touched;
+				for (auto &response : ready) {
+					auto it = clients.find(response.client);
+					if (it == clients.end()) continue; // Client is gone
+					ServerClient &client = it->second;
+					client.pending[response.sequence] = move(response.text);
+					auto next = client.pending.begin();
+					while (next != client.pending.end() && next->first == client.sent) {
+						client.output += next->second;
+						client.output += '\n';
+						next = client.pending.erase(next);
+						++client.sent;
+					}
+					touched.push_back(response.client);
+				}
+
+				for (uint64_t t : touched) {
+					auto it = clients.find(t);
+					if (it == clients.end()) continue;
+					ServerClient &client = it->second;
+					if (!flushClient(epoll, t, client) || finishedClient(client))
+						closeClient(t);
+				}
+				continue;
+			}
+
+			auto it = clients.find(token);
+			if (it == clients.end()) continue;
+			ServerClient &client = it->second;
+
+			if (events[i].events & EPOLLOUT) {
+				if (!flushClient(epoll, token, client)) {
+					closeClient(token);
+					continue;
+				}
+				if (finishedClient(client)) {
+					closeClient(token);
+					continue;
+				}
+			}
+
+			if (!client.reading || !(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) continue;
+
+			// Read everything available, then split it into request lines.
+			// At the end of input, still answer what was already received
+			bool failed = false, ended = false;
+			while (true) {
+				ssize_t r = recv(client.fd, buffer, sizeof(buffer), 0);
+				if (r > 0) client.input.append(buffer, r);
+				else {
+					if (r == 0) ended = true;
+					else if (errno != EAGAIN && errno != EWOULDBLOCK) failed = true;
+					break;
+				}
+			}
+
+			vector<ServerRequest> received;
+			size_t start = 0, end;
+			while (!client.quitting && (end = client.input.find('\n', start)) != string::npos) {
+				string line = client.input.substr(start, end - start);
+				if (!line.empty() && line.back() == '\r') line.pop_back();
+				start = end + 1;
+				if (line.empty()) continue;
+
+				string command;
+				istringstream(line) >> command;
+				for (auto &c : command) c = toupper(c);
+				if (command == "QUIT") client.quitting = true;
+
+				received.push_back({(long long)token, client.received++, line});
+			}
+			client.input.erase(0, start);
+
+			if (client.input.size() > SERVER_MAX_LINE) failed = true; // Runaway line
+
+			if (!received.empty()) {
+				{
+					lock_guard<mutex> lock(requestsMutex);
+					for (auto &request : received)
+						requests.push_back(move(request));
+				}
+				if (received.size() == 1) requestsReady.notify_one();
+				else requestsReady.notify_all();
+			}
+
+			if (failed) {
+				closeClient(token);
+				continue;
+			}
+			if (ended || client.quitting) {
+				client.quitting = true;
+				client.reading = false;
+				if (!flushClient(epoll, token, client) || finishedClient(client))
+					closeClient(token);
+			}
+		}
+	}
+
+	// Shut down
+	running = false;
+	requestsReady.notify_all();
+	for (auto &worker : workers)
+		worker.join();
+
+	for (auto &entry : clients)
+		close(entry.second.fd);
+	close(listener);
+	close(epoll);
+	close(wakeup);
+	wakeup = -1;
+
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	activeServer = nullptr;
+
+	cerr << "Server stopped" << endl;
+	return 0;
+}
+
+#else
+
+int RouteServer::run() {
+	cerr << "Server mode requires epoll (Linux)" << endl;
+	return -1;
+}
+
+#endif
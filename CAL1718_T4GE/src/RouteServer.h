@@ -0,0 +1,79 @@
+#pragma once
+
+#include "BatchRouting.h"
+#include "LoadMap.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+#define SERVER_MAX_EVENTS      64
+#define SERVER_MAX_LINE        4096
+#define SERVER_MAX_ROADS       20
+
+/*
+ * One request line received from a client. Requests of the same
+ * client are numbered in order of arrival, so that pipelined
+ * requests are answered in that same order.
+ */
+struct ServerRequest {
+	long long client;
+	long long sequence;
+	string line;
+};
+
+struct ServerResponse {
+	long long client;
+	long long sequence;
+	string text;
+};
+
+//////////////////////////
+/// Class RouteServer ////
+//////////////////////////
+
+/**
+ * Long running service over a resident map. Clients connect to
+ * a local TCP port and send one request per line:
+ *
+ *   PING
+ *   INFO
+ *   ROUTE origin destination [astar|dijkstra] [distance|time]
+ *   NEAREST latitude longitude
+ *   ROADS text
+ *   QUIT
+ *
+ * and get one "OK ..." or "ERR ..." line per request, in order.
+ * A single thread runs the (epoll) event loop, doing all socket
+ * I/O, while a pool of workers answers the requests.
+ * The graph must not be changed while the server runs.
+ */
+class RouteServer {
+	Graph *graph;
+	MetaData meta;
+	QueryEngine engine;
+	int port;
+
+	mutex requestsMutex;
+	condition_variable requestsReady;
+	deque<ServerRequest> requests;
+
+	mutex responsesMutex;
+	vector<ServerResponse> responses;
+
+	atomic<bool> running;
+	int wakeup = -1; // Signals the event loop that responses are ready
+
+	string handle(const string &line, int thread);
+	void work(int thread);
+
+public:
+	RouteServer(Graph *graph, const MetaData &meta, int port, int workers = 0);
+
+	int run();
+	void stop();
+};
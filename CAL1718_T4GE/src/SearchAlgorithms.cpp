@@ -63,7 +63,7 @@ void computeFiniteAutomata(string pattern, int TF[][ALPHABET]) {
 		TF[0][x] = 0;
 
 
-	TF[0][(int)pattern[0]] = 1;
+	TF[0][(unsigned char)pattern[0]] = 1;
 
 	// Fill entries in other rows
 	for (unsigned int i = 1; i <= pattern.length(); i++) {
@@ -73,12 +73,12 @@ void computeFiniteAutomata(string pattern, int TF[][ALPHABET]) {
 			TF[i][x] = TF[prefixFunction][x];
 
 		// Update the entry corresponding to this character
-		TF[i][(int)pattern[i]] = i + 1;
+		TF[i][(unsigned char)pattern[i]] = i + 1;
 
 
 		// Update lps for next row to be filled
 		if (i < pattern.length())
-			prefixFunction = TF[prefixFunction][(int)pattern[i]];
+			prefixFunction = TF[prefixFunction][(unsigned char)pattern[i]];
 	}
 
 	return;
@@ -104,7 +104,7 @@ bool finiteAutomataAlgorithm(string text, string pattern) {
 	//Process text over FA <TF>.
 	for(int i = 0; i < N; i++) {
 
-		j = TF[j][(int)text[i]];
+		j = TF[j][(unsigned char)text[i]];
 
 		if (j == M)
 			return true;
@@ -312,3 +312,190 @@ int hammingDistanceAlgorithm(string text, string pattern) {
 
 	return count;
 }
+
+////////////////////////
+// TEXT NORMALIZATION //
+////////////////////////
+
+/**
+ * @brief Decodes the next code point of text starting at index i, advancing i.
+ * Valid UTF-8 sequences are decoded as such; any other byte is taken as a
+ * Windows-1252 character (the console code page and the encoding of some
+ * of the map files)
+ *
+ * @return The decoded code point
+ */
+static unsigned int decodeCodePoint(const string &text, size_t &i) {
+
+	static const unsigned int cp1252[32] = {
+		0x20AC, 0, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+		0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0, 0x017D, 0,
+		0, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+		0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0, 0x017E, 0x0178
+	};
+
+	unsigned char lead = text[i];
+	int length = 0;
+	unsigned int codePoint = 0;
+
+	if (lead < 0x80) {
+		i++;
+		return lead;
+	}
+	else if ((lead & 0xE0) == 0xC0) {
+		length = 1;
+		codePoint = lead & 0x1F;
+	}
+	else if ((lead & 0xF0) == 0xE0) {
+		length = 2;
+		codePoint = lead & 0x0F;
+	}
+	else if ((lead & 0xF8) == 0xF0) {
+		length = 3;
+		codePoint = lead & 0x07;
+	}
+
+	//Check continuation bytes
+	bool valid = length > 0 && i + length < text.length();
+	for (int j = 1; valid && j <= length; j++) {
+		unsigned char next = text[i + j];
+		if ((next & 0xC0) != 0x80)
+			valid = false;
+		else
+			codePoint = (codePoint << 6) | (next & 0x3F);
+	}
+
+	//Reject overlong encodings
+	if (valid && ((length == 1 && codePoint < 0x80) || (length == 2 && codePoint < 0x800) || (length == 3 && codePoint < 0x10000)))
+		valid = false;
+
+	if (valid) {
+		i += length + 1;
+		return codePoint;
+	}
+
+	//Not UTF-8: single Windows-1252 byte
+	i++;
+	if (lead < 0xA0)
+		return cp1252[lead - 0x80];
+
+	return lead;
+}
+
+/**
+ * @brief Appends code point to text encoded as UTF-8
+ */
+static void encodeCodePoint(unsigned int codePoint, string &text) {
+
+	if (codePoint < 0x80)
+		text += (char)codePoint;
+	else if (codePoint < 0x800) {
+		text += (char)(0xC0 | (codePoint >> 6));
+		text += (char)(0x80 | (codePoint & 0x3F));
+	}
+	else if (codePoint < 0x10000) {
+		text += (char)(0xE0 | (codePoint >> 12));
+		text += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+		text += (char)(0x80 | (codePoint & 0x3F));
+	}
+	else {
+		text += (char)(0xF0 | (codePoint >> 18));
+		text += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+		text += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+		text += (char)(0x80 | (codePoint & 0x3F));
+	}
+}
+
+/**
+ * @brief Folds a code point to its lower case, unaccented form.
+ * Latin letters become plain ASCII, combining diacritics are dropped
+ * and every other code point is kept as it is
+ *
+ * @return The folded text of the code point (possibly empty)
+ */
+static string foldCodePoint(unsigned int codePoint) {
+
+	// U+00C0 .. U+00FF
+	static const char latin1[] = "aaaaaaaceeeeiiiidnoooooxouuuuyts" "aaaaaaaceeeeiiiidnooooo/ouuuuyty";
+	// U+0100 .. U+017F
+	static const char latinExtendedA[] = "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiiiijjjkkkllllllllllnnnnnnnnnoooooooorrrrrrssssssssttttttuuuuuuuuuuuuwwyyyzzzzzzs";
+
+	string folded;
+
+	if (codePoint < 0x80) {
+		if (codePoint >= 'A' && codePoint <= 'Z')
+			folded += (char)(codePoint - 'A' + 'a');
+		else if (codePoint >= 0x20 && codePoint != 0x7F)
+			folded += (char)codePoint;
+	}
+	else if (codePoint < 0xC0) {
+		// Non-breaking space, remaining symbols are dropped
+		if (codePoint == 0xA0)
+			folded += ' ';
+	}
+	else if (codePoint < 0x100) {
+		switch (codePoint) {
+		case 0xC6: case 0xE6: folded = "ae"; break;
+		case 0xDE: case 0xFE: folded = "th"; break;
+		case 0xDF: folded = "ss"; break;
+		default: folded += latin1[codePoint - 0xC0];
+		}
+	}
+	else if (codePoint < 0x180) {
+		switch (codePoint) {
+		case 0x132: case 0x133: folded = "ij"; break;
+		case 0x152: case 0x153: folded = "oe"; break;
+		default: folded += latinExtendedA[codePoint - 0x100];
+		}
+	}
+	else if (codePoint >= 0x300 && codePoint < 0x370) {
+		// Combining diacritical marks
+	}
+	else if (codePoint >= 0x2010 && codePoint <= 0x2015) {
+		folded += '-';
+	}
+	else if (codePoint >= 0x2018 && codePoint <= 0x201B) {
+		folded += '\'';
+	}
+	else if (codePoint != 0) {
+		encodeCodePoint(codePoint, folded);
+	}
+
+	return folded;
+}
+
+/**
+ * @brief Normalizes text for searching: decodes it (UTF-8 or Windows-1252),
+ * folds it to lower case, strips the accents of latin letters and collapses
+ * whitespace. Computed once per road name at load time and once per pattern,
+ * so that the string matching algorithms only compare plain bytes
+ *
+ * @return The normalized text
+ */
+string normalizeText(const string &text) {
+
+	//Local variables
+	string normalized;
+	size_t i = 0;
+	bool space = false;
+
+	while (i < text.length()) {
+		unsigned int codePoint = decodeCodePoint(text, i);
+		string folded = foldCodePoint(codePoint);
+
+		for (char c : folded) {
+			if (isspace((unsigned char)c)) {
+				space = !normalized.empty();
+				continue;
+			}
+
+			if (space)
+				normalized += ' ';
+
+			normalized += c;
+			space = false;
+		}
+	}
+
+	return normalized;
+}
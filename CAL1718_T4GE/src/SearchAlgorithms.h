@@ -1,3 +1,5 @@
+#pragma once
+
 #include <iostream>
 #include <string>
 
@@ -23,5 +25,11 @@ bool knuthMorrisPrattAlgorithm(string text, string pattern);
 int editDistanceAlgorithm(string text, string pattern);
 int hammingDistanceAlgorithm(string text, string pattern);
 
+////////////////////////
+// TEXT NORMALIZATION //
+////////////////////////
+
+string normalizeText(const string &text);
+
 
 
@@ -1,27 +1,31 @@
+#include <algorithm>
 #include <chrono>
+#include <functional>
+#include <iomanip>
+#include <math.h>
 #include "Interface.h"
+#include "Benchmark.h"
+#include "Simulation.h"
+#include "Random.h"
 
 /////////////////////////
 // Auxiliary Functions //
 /////////////////////////
 
-void colorUnreachableNodes(Vertex* origin) {
-	graph->bfs(origin);
-
-	cout << endl << "Checking for unreachable nodes ..." << endl << endl;
-
-	for (auto v : graph->getVertexSet()) { // Non-accidented vertices
-		if (v->getPath() == nullptr) {
-			graph->setVertexColor(v, UNREACHABLE_COLOR);
-		}
-	}
-
-	graph->setVertexColor(origin, SELECTED_COLOR);
-	graph->rearrange();
-	graph->clear();
+/*
+ * Colors the clear nodes not reachable from origin, as answered by
+ * the component index of the graph, kept up to date by its accidents
+ * and fixes (so there is no search, nor snapshot, per call)
+ * @return Whether destination is reachable, true if not given
+ */
+bool colorUnreachableNodes(Graph *graph, const ComponentIndex &components, Vertex* origin, Vertex *destination) {
+	for (Vertex *v : components.getUnreachable(origin))
+		graph->setVertexColor(v, UNREACHABLE_COLOR);
+
+	return destination == nullptr || components.reaches(origin, destination);
 }
 
-void animateOneRoad(vector<Vertex*> path, Vertex* &current) {
+void animateOneRoad(Graph *graph, vector<Vertex*> path, Vertex* &current) {
 	graph->setVertexColor(current, PATH_COLOR);
 
 	// This is the road we should stay on
@@ -52,7 +56,7 @@ void animateOneRoad(vector<Vertex*> path, Vertex* &current) {
 	graph->animatePath(second, 15, NEXT_PATH_COLOR, true);
 }
 
-void animateOneSubroad(vector<Vertex*> path, Vertex* &current) {
+void animateOneSubroad(Graph *graph, vector<Vertex*> path, Vertex* &current) {
 	graph->setVertexColor(current, PATH_COLOR);
 
 	// The new current is the next vertex in the path
@@ -67,7 +71,7 @@ void animateOneSubroad(vector<Vertex*> path, Vertex* &current) {
 	graph->animatePath(second, 15, NEXT_PATH_COLOR, true);
 }
 
-void resetGraphState() {
+void resetGraphState(Graph *graph) {
 	graph->resetVertexColors();
 	graph->resetEdgeColors();
 	graph->rearrange();
@@ -79,7 +83,7 @@ void resetGraphState() {
 // GUI for Individual Algorithms //
 ///////////////////////////////////
 
-void gbfs(Vertex *origin, Vertex *destination) {
+void gbfs(Graph *graph, Vertex *origin, Vertex *destination) {
 	// Perform algorithm
 	microtime time;
 	graph->gbfsDist(origin, destination, &time);
@@ -111,7 +115,7 @@ void gbfs(Vertex *origin, Vertex *destination) {
 	}
 }
 
-void dijkstraSource(Vertex *origin, Vertex *destination) {
+void dijkstraSource(Graph *graph, Vertex *origin, Vertex *destination) {
 	// Perform algorithm
 	microtime time;
 	graph->dijkstraDist(origin, &time);
@@ -129,7 +133,7 @@ void dijkstraSource(Vertex *origin, Vertex *destination) {
 	cout << "Time of travel : " << timeTravel*3600 << " seconds. " << endl << endl;
 }
 
-void dijkstraSourceDest(Vertex *origin, Vertex *destination) {
+void dijkstraSourceDest(Graph *graph, Vertex *origin, Vertex *destination) {
 	// Perform algorithm
 	microtime time;
 	graph->dijkstraDist(origin, destination, &time);
@@ -147,7 +151,7 @@ void dijkstraSourceDest(Vertex *origin, Vertex *destination) {
 	cout << "Time of travel : " << timeTravel*3600 << " seconds. " << endl << endl;
 }
 
-void Astar(Vertex *origin, Vertex *destination) {
+void Astar(Graph *graph, Vertex *origin, Vertex *destination) {
 	// Perform algorithm
 	microtime time;
 	graph->AstarDist(origin, destination, &time);
@@ -165,75 +169,66 @@ void Astar(Vertex *origin, Vertex *destination) {
 	cout << "Time of travel : " << timeTravel*3600 << " seconds. "<< endl << endl;
 }
 
-void subroadSimulation(Vertex *origin, Vertex *destination) {
-	Vertex* current = origin;
-	double timeTravel = 0;
-
-	graph->showEdgeSimulationLabels();
-	graph->rearrange();
-
-	while (true) {
-		// Perform algorithm
-		microtime time;
-		graph->bfs(current);
-
-		for (auto v : graph->getVertexSet()) {
-			if (v->getPath() == nullptr)
-				graph->setVertexColor(v, UNREACHABLE_COLOR);
-		}
-		if (!destination->getPath()) { // Unreachable vertex
-			cout << "Node not reachable (" << destination->getID() << "). An accident occurred!" << endl << endl;
-			break;
-		}
-
-		graph->dijkstraSimulation(current, destination, &time);
-		cout << endl << "Elapsed time: " << time << " microseconds." << endl << endl;
-
-		// Get shortest path ...
-		vector<Vertex*> path = graph->getPath(current, destination);
-
-		// ... and animate
-		// by Subroad
-		animateOneSubroad(path, current);
-
-		timeTravel = current->getCost();
+/*
+ * Formats hours since midnight as hh:mm, adding the day if past midnight
+ */
+static string clockTime(double hours) {
+	int minutes = (int)floor(hours * 60 + 0.5);
+	ostringstream ss;
+	ss << setfill('0') << setw(2) << (minutes / 60) % 24 << ':' << setw(2) << minutes % 60;
+	if (minutes >= 24 * 60) ss << " (+" << minutes / (24 * 60) << " day)";
+	return ss.str();
+}
 
-		system("pause");
-		cout << endl;
-		if (current == destination) break;
+void timeDependent(Graph *graph, Vertex *origin, Vertex *destination) {
+	double departure = selectDepartureTime();
+	if (departure < 0) return;
 
-		// Clear path prediction colors
-		path = graph->getPath(current, destination);
-		graph->clearPath(path, 0, true);
+	// Perform algorithm
+	microtime time;
+	graph->AstarTimeDependent(origin, destination, departure, &time);
+	cout << endl << "Elapsed time: " << time << " microseconds." << endl << endl;
 
-		// Else move cars
-		graph->generateGraphNewStatus(path);
-		graph->showEdgeSimulationLabels();
-	};
+	double arrival = destination->getCost();
 
-	cout << "Time of travel : " << timeTravel*3600 << " seconds. " << endl << endl;
+	// Get fastest path and animate
+	vector<Vertex*> path = graph->getPath(origin, destination);
+	graph->animatePath(path, 200, PATH_COLOR, true);
 
-	graph->hideAllEdgeLabels();
-	graph->rearrange();
+	cout << "Leaving at " << clockTime(departure) << ", arriving at " << clockTime(arrival) << "." << endl;
+	cout << "Time of travel : " << (arrival - departure) * 3600 << " seconds. " << endl << endl;
 }
 
-void roadSimulation(Vertex *origin, Vertex *destination) {
+/*
+ * Follows one vehicle from origin to destination through simulated
+ * traffic (see TrafficSimulation): at every stop it takes the quickest
+ * path at the current occupancies and drives the stretch animate moves
+ * it along (one subroad, or one road) among the other vehicles, whose
+ * occupancies are then shown on the edges. Between stops, random
+ * accidents (see Graph::generateGraphNewStatus) may close the way.
+ */
+static void followVehicle(Graph *graph, ComponentIndex &components, Vertex *origin, Vertex *destination,
+		function<void(Graph*, vector<Vertex*>, Vertex*&)> animate) {
 	Vertex* current = origin;
 	double timeTravel = 0;
 
+	// The other vehicles: one trip per vertex, leaving over the first minutes
+	// (each run of the session its own, the same under the same --seed)
+	static int runs = 0;
+	int run = runs++;
+	TrafficSimulation simulation(graph);
+	int trips = simulation.addRandomTrips(graph->getNumVertices(), SIMULATION_VIEW_WINDOW,
+			RandomStream(RANDOM_STREAM_TRIPS, run).next());
+	cout << endl << "Simulating " << trips << " other vehicles (seed " << getRandomSeed() << ", run " << run << ")." << endl;
+
+	simulation.writeOccupancies();
 	graph->showEdgeSimulationLabels();
 	graph->rearrange();
 
 	while (true) {
 		// Perform algorithm
 		microtime time;
-		graph->bfs(current);
-
-		for (auto v : graph->getVertexSet()) {
-			if (v->getPath() == nullptr)
-				graph->setVertexColor(v, UNREACHABLE_COLOR);
-		}
-		if (!destination->getPath()) { // Unreachable vertex
+		if (!colorUnreachableNodes(graph, components, current, destination)) { // Unreachable vertex
 			cout << "Node not reachable (" << destination->getID() << "). An accident occurred!" << endl << endl;
 			break;
 		}
@@ -245,10 +240,16 @@ void roadSimulation(Vertex *origin, Vertex *destination) {
 		vector<Vertex*> path = graph->getPath(current, destination);
 
 		// ... and animate
-		// by Road
-		animateOneRoad(path, current);
+		animate(graph, path, current);
 
-		timeTravel = current->getCost();
+		// Drive the stretch just animated, with the traffic around it
+		vector<Vertex*> stretch(path.begin(), find(path.begin(), path.end(), current) + 1);
+		int vehicle = simulation.addVehicle(stretch, simulation.getTime());
+		if (vehicle < 0 || !simulation.runUntilArrived(vehicle, SIMULATION_VIEW_MAX_STEPS)) {
+			cout << "Stuck in traffic!" << endl << endl;
+			break;
+		}
+		timeTravel += simulation.getTravelTime(vehicle);
 
 		system("pause");
 		cout << endl;
@@ -258,27 +259,71 @@ void roadSimulation(Vertex *origin, Vertex *destination) {
 		path = graph->getPath(current, destination);
 		graph->clearPath(path, 0, true);
 
-		// Else move cars
-		graph->generateGraphNewStatus(path);
+		// Accidents happen (see --seed), and the cars move
+		int accidents = graph->generateGraphNewStatus(path);
+		if (accidents > 0) cout << accidents << " new accidents." << endl << endl;
+		simulation.writeOccupancies();
 		graph->showEdgeSimulationLabels();
 	};
 
-	cout << "Time of travel : " << timeTravel*3600 << " seconds. " << endl << endl;
+	cout << "Time of travel : " << timeTravel << " seconds. " << endl << endl;
 
 	graph->hideAllEdgeLabels();
 	graph->rearrange();
 }
 
-void benchmark(Vertex *origin, Vertex *destination, int N) {
+void subroadSimulation(Graph *graph, ComponentIndex &components, Vertex *origin, Vertex *destination) {
+	followVehicle(graph, components, origin, destination, animateOneSubroad);
+}
+
+void roadSimulation(Graph *graph, ComponentIndex &components, Vertex *origin, Vertex *destination) {
+	followVehicle(graph, components, origin, destination, animateOneRoad);
+}
+
+/*
+ * Runs one algorithm N times, timing every run, and prints
+ * its internal (algorithm only) and external (whole call) times,
+ * followed by the work done by the searches: the mean over the
+ * runs, and the largest queue and memory of any run
+ */
+static void benchmarkAlgorithm(string title, function<void(microtime*, SearchStats*)> run, int N) {
+	vector<double> external;
+	microtime sum = 0;
+	SearchStats total;
+
+	for (int i = 0; i < N; ++i) {
+		microtime time;
+		SearchStats stats;
+		auto start = chrono::steady_clock::now();
+		run(&time, &stats);
+		external.push_back(elapsedMicroseconds(start));
+		sum += time;
+		total.settled += stats.settled;
+		total.relaxed += stats.relaxed;
+		total.decreaseKeys += stats.decreaseKeys;
+		total.reached += stats.reached;
+		total.maxHeapSize = max(total.maxHeapSize, stats.maxHeapSize);
+		total.bytesAllocated = max(total.bytesAllocated, stats.bytesAllocated);
+	}
+
+	LatencySummary summary = summarizeLatencies(external);
+
+	cout << "--- " << title << " ---" << endl;
+	cout << "Internal Average Time: " << sum / N << " microseconds." << endl;
+	cout << "External Average Time: " << summary.mean << " microseconds (stddev " << summary.stddev << ")." << endl;
+	cout << "External p50/p95/p99: " << summary.p50 << " / " << summary.p95 << " / " << summary.p99 << " microseconds." << endl;
+	cout << "Average settled vertices: " << total.settled / N << ", relaxed edges: " << total.relaxed / N
+			<< ", decrease-keys: " << total.decreaseKeys / N << ", reached vertices: " << total.reached / N << endl;
+	cout << "Max queue size: " << total.maxHeapSize << ", search memory: " << total.bytesAllocated << " bytes." << endl;
+}
+
+void benchmark(Graph *graph, Vertex *origin, Vertex *destination, int N) {
 	// Perform A* to find the best path and show it,
 	// and only then proceed with benchmarking
 	graph->AstarDist(origin, destination);
 	vector<Vertex*> path = graph->getPath(origin, destination);
 	graph->animatePath(path, 0, PATH_COLOR, true);
 
-	// Time of all N iterations
-	microtime internal, external;
-
 	cout << "===== Benchmark " << N << " Iterations =====" << endl;
 
 	// Silent warmup
@@ -292,73 +337,23 @@ void benchmark(Vertex *origin, Vertex *destination, int N) {
 		}
 	}
 
-	// Benchmark Greedy Best-First Search
-	{
-		microtime sum = 0;
-		auto start = chrono::high_resolution_clock::now();
-		for (int i = 0; i < N; ++i) {
-			microtime time;
-			graph->gbfsDist(origin, destination, &time);
-			sum += time;
-		}
-		auto end = chrono::high_resolution_clock::now();
-		internal = sum / N;
-		external = (end - start).count() / N;
-	}
-	cout << "--- (1) Greedy Best First Search ---" << endl;
-	cout << "Internal Average Time: " << internal << " microseconds." << endl;
-	cout << "External Average Time: " << external << " microseconds." << endl;
+	benchmarkAlgorithm("(1) Greedy Best First Search", [&](microtime *time, SearchStats *stats) {
+		graph->gbfsDist(origin, destination, time, stats);
+	}, N);
 
-	// Benchmark Late Exit Dijkstra
-	{
-		microtime sum = 0;
-		auto start = chrono::high_resolution_clock::now();
-		for (int i = 0; i < N; ++i) {
-			microtime time;
-			graph->dijkstraDist(origin, &time);
-			sum += time;
-		}
-		auto end = chrono::high_resolution_clock::now();
-		internal = sum / N;
-		external = (end - start).count() / N;
-	}
-	cout << "--- (2) Late Exit Dijkstra ---" << endl;
-	cout << "Internal Average Time: " << internal << " microseconds." << endl;
-	cout << "External Average Time: " << external << " microseconds." << endl;
+	benchmarkAlgorithm("(2) Late Exit Dijkstra", [&](microtime *time, SearchStats *stats) {
+		graph->dijkstraDist(origin, time, stats);
+	}, N);
 
-	// Benchmark Early Exit Dijkstra
-	{
-		microtime sum = 0;
-		auto start = chrono::high_resolution_clock::now();
-		for (int i = 0; i < N; ++i) {
-			microtime time;
-			graph->dijkstraDist(origin, destination, &time);
-			sum += time;
-		}
-		auto end = chrono::high_resolution_clock::now();
-		internal = sum / N;
-		external = (end - start).count() / N;
-	}
-	cout << "--- (3) Early Exit Dijkstra ---" << endl;
-	cout << "Internal Average Time: " << internal << " microseconds." << endl;
-	cout << "External Average Time: " << external << " microseconds." << endl;
+	benchmarkAlgorithm("(3) Early Exit Dijkstra", [&](microtime *time, SearchStats *stats) {
+		graph->dijkstraDist(origin, destination, time, stats);
+	}, N);
 
-	// Benchmark A*
-	{
-		microtime sum = 0;
-		auto start = chrono::high_resolution_clock::now();
-		for (int i = 0; i < N; ++i) {
-			microtime time;
-			graph->AstarDist(origin, destination, &time);
-			sum += time;
-		}
-		auto end = chrono::high_resolution_clock::now();
-		internal = sum / N;
-		external = (end - start).count() / N;
-	}
-	cout << "--- (4) A* ---" << endl;
-	cout << "Internal Average Time: " << internal << " microseconds." << endl;
-	cout << "External Average Time: " << external << " microseconds." << endl << endl;
+	benchmarkAlgorithm("(4) A*", [&](microtime *time, SearchStats *stats) {
+		graph->AstarDist(origin, destination, time, stats);
+	}, N);
+
+	cout << endl;
 }
 
 
@@ -366,7 +361,7 @@ void benchmark(Vertex *origin, Vertex *destination, int N) {
 // Algorithms Menu //
 /////////////////////
 
-void shortestPathUI() {
+void shortestPathUI(Graph *graph, ComponentIndex &components) {
 
 	system("cls");
 
@@ -384,28 +379,31 @@ void shortestPathUI() {
 	cout << "3 - Dijkstra <source,destination>" << endl;
 	cout << "4 - A* <source,destination>" << endl;
 	cout << "5 - Simulation [edge - edge]" << endl;
-	cout << "6 - Simulation [road - road]" << endl << endl;
+	cout << "6 - Simulation [road - road]" << endl;
+	cout << "7 - Time-dependent A* <source,destination,departure>" << endl << endl;
 	cout << "##################" << endl;
 	cout << "## Benchmarking ##" << endl;
 	cout << "##################" << endl << endl;
-	cout << "7 - Benchmark  [1 through 4]" << endl << endl;
+	cout << "8 - Benchmark  [1 through 4]" << endl << endl;
 
 	// Choose Algorithm
-	option = selectOption(7);
-	if (option == 8) return;
+	option = selectOption(8);
+	if (option == 9) return;
 
 	// Choose origin
-	origin = selectOriginVertex(false);
+	origin = selectOriginVertex(graph, false);
 	if (origin == nullptr) return;
 
 	// Color unreachable nodes
-	colorUnreachableNodes(origin);
+	cout << endl << "Checking for unreachable nodes ..." << endl << endl;
+	colorUnreachableNodes(graph, components, origin);
 	graph->setVertexColor(origin, SELECTED_COLOR);
+	graph->rearrange();
 
 	// Select destination
-	destination = selectDestinationVertex(origin, false, true);
+	destination = selectDestinationVertex(graph, origin, false, &components);
 	if (destination == nullptr) {
-		resetGraphState();
+		resetGraphState(graph);
 		return;
 	}
 
@@ -414,34 +412,37 @@ void shortestPathUI() {
 	// Ok: so here we separate each algorithm
 	switch (option) {
 	case 1: // Greedy Best-First Search <source,destination>
-		gbfs(origin, destination);
+		gbfs(graph, origin, destination);
 		break;
 	case 2: // Dijkstra <source>
-		dijkstraSource(origin, destination);
+		dijkstraSource(graph, origin, destination);
 		break;
 	case 3: // Dijkstra <source,destination>
-		dijkstraSourceDest(origin, destination);
+		dijkstraSourceDest(graph, origin, destination);
 		break;
 	case 4: // A* <source,destination>
-		Astar(origin, destination);
+		Astar(graph, origin, destination);
 		break;
 	case 5: // Simulation (edge by edge)
-		subroadSimulation(origin, destination);
+		subroadSimulation(graph, components, origin, destination);
 		break;
 	case 6: // Simulation (road by road)
-		subroadSimulation(origin, destination);
+		roadSimulation(graph, components, origin, destination);
+		break;
+	case 7: // Time-dependent A* <source,destination,departure>
+		timeDependent(graph, origin, destination);
 		break;
-	case 7: // Benchmark 1 through 4
+	case 8: // Benchmark 1 through 4
 		int iterations = selectIterations();
 		cout << endl << endl;
 		if (iterations == 0) return;
-		benchmark(origin, destination, iterations);
+		benchmark(graph, origin, destination, iterations);
 	}
 
 	// Reset and go up
 	cout << "Done." << endl << endl;
 	system("pause");
-	resetGraphState();
-	return shortestPathUI();
+	resetGraphState(graph);
+	return shortestPathUI(graph, components);
 }
 
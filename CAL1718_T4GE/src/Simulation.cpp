@@ -0,0 +1,401 @@
+#include "Simulation.h"
+#include "Partition.h"
+#include "Random.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+
+static const double infinity = numeric_limits<double>::infinity();
+
+/*
+ * @brief Prepares the simulation of an empty road network: the
+ * occupancy of every subroad starts at zero, whatever the graph's
+ * actual capacities (see writeOccupancies)
+ * @param threads Threads of each step, 0 for one per hardware thread
+ */
+TrafficSimulation::TrafficSimulation(Graph *graph, int threads) :
+		graph(graph), compact(graph), threads(threads > 0 ? threads : defaultThreads()) {
+	int n = compact.getNumVertices(), m = compact.getNumEdges();
+
+	Partition partition = bisectByCoordinates(compact, {SIMULATION_CELL_SIZE});
+	cells.resize(partition.numCells[0]);
+	for (int v = 0; v < n; ++v)
+		cells[partition.cells[0][v]].push_back(v);
+
+	incoming.resize(n);
+	linkOf.resize(m);
+	unordered_map<const Subroad*, int> links;
+	for (int v = 0; v < n; ++v) {
+		for (int e = compact.getFirstEdge(v); e < compact.getLastEdge(v); ++e) {
+			incoming[compact.getTarget(e)].push_back(e);
+			auto it = links.insert({compact.getEdge(e)->getSubroad(), linkEdges.size()}).first;
+			if (it->second == (int)linkEdges.size()) linkEdges.emplace_back();
+			linkOf[e] = it->second;
+			linkEdges[it->second].push_back(e);
+		}
+	}
+	for (const vector<int> &edges : linkEdges)
+		capacity.push_back(compact.getEdge(edges[0])->getMaxCapacity());
+	occupancy.assign(linkEdges.size(), 0);
+
+	queues.resize(m);
+	headExit.assign(m, infinity);
+	departures.resize(n);
+	requests.resize(m);
+	granted.assign(m, 0);
+	departureGranted.assign(n, 0);
+	leaving.assign(m, 0);
+	moving.resize(n);
+}
+
+/*
+ * @brief (Private) Seconds to cross edge at the current
+ * occupancy of its subroad
+ */
+double TrafficSimulation::travelTime(int edge) const {
+	const Subroad *subroad = compact.getEdge(edge)->getSubroad();
+	int speed = max(1, subroad->calculateAverageSpeed(occupancy[linkOf[edge]]));
+	return (subroad->getDistance() / 1000) / speed * 3600;
+}
+
+/*
+ * @brief (Private) Whether vehicles may enter edge:
+ * it and both its ends are clear
+ */
+bool TrafficSimulation::canEnter(int edge) const {
+	const Edge *e = compact.getEdge(edge);
+	return !e->isAccidented() && !e->getSource()->isAccidented() && !e->getDest()->isAccidented();
+}
+
+/*
+ * @brief (Private) Whether the vehicle at the head of edge (-1 for
+ * a departure) has waited long enough to enter its next edge anyway
+ */
+bool TrafficSimulation::isStuck(int edge, double now) const {
+	return edge >= 0 && now - headExit[edge] >= SIMULATION_STUCK_TIME;
+}
+
+/*
+ * @brief (Private) Next edge of the vehicle's route, -1 if none is left
+ */
+int TrafficSimulation::wantedEdge(int vehicle) const {
+	const Vehicle &v = vehicles[vehicle];
+	return v.next < v.end ? routes[v.next] : -1;
+}
+
+/*
+ * @brief (Private) Puts the vehicles waiting at each vertex
+ * in departure order, first added first on ties
+ */
+void TrafficSimulation::sortDepartures() {
+	for (auto &waiting : departures) {
+		stable_sort(waiting.begin(), waiting.end(), [&](int a, int b) {
+			return vehicles[a].departure < vehicles[b].departure;
+		});
+	}
+	sorted = true;
+}
+
+/*
+ * @brief Adds a vehicle that will follow path (by the fastest of
+ * parallel edges), leaving at departure (seconds)
+ * @return The vehicle's id, -1 if path is empty or not in the
+ * clear part of the graph
+ */
+int TrafficSimulation::addVehicle(const vector<Vertex*> &path, double departure) {
+	if (path.empty() || compact.getIndex(path[0]) < 0) return -1;
+
+	vector<int> edges;
+	for (size_t i = 1; i < path.size(); ++i) {
+		int u = compact.getIndex(path[i - 1]), w = compact.getIndex(path[i]), best = -1;
+		for (int e = compact.getFirstEdge(u); e < compact.getLastEdge(u); ++e) {
+			if (compact.getTarget(e) == w && (best < 0 || compact.getCost(e, TRAVEL_TIME) < compact.getCost(best, TRAVEL_TIME)))
+				best = e;
+		}
+		if (best < 0) return -1;
+		edges.push_back(best);
+	}
+
+	Vehicle vehicle;
+	vehicle.origin = compact.getIndex(path[0]);
+	vehicle.begin = vehicle.next = routes.size();
+	routes.insert(routes.end(), edges.begin(), edges.end());
+	vehicle.end = routes.size();
+	vehicle.departure = departure;
+
+	vehicles.push_back(vehicle);
+	departures[vehicle.origin].push_back(vehicles.size() - 1);
+	sorted = false;
+	++stats.waiting;
+	return vehicles.size() - 1;
+}
+
+/*
+ * @brief Adds a vehicle for each trip (origin, destination), routed
+ * along the quickest path at the graph's current travel times (one
+ * search per origin, in parallel)
+ * @return The id of each trip's vehicle, -1 if it has no route
+ */
+vector<int> TrafficSimulation::addTrips(const vector<pair<Vertex*, Vertex*>> &trips, const vector<double> &times) {
+	map<int, vector<int>> byOrigin;
+	for (size_t i = 0; i < trips.size(); ++i) {
+		int origin = compact.getIndex(trips[i].first), destination = compact.getIndex(trips[i].second);
+		if (origin >= 0 && destination >= 0) byOrigin[origin].push_back(i);
+	}
+	vector<int> origins;
+	for (auto &pair : byOrigin)
+		origins.push_back(pair.first);
+
+	vector<vector<int>> paths(trips.size());
+	vector<char> found(trips.size(), 0);
+	vector<SearchWorkspace> workspaces(threads);
+	parallelFor(origins.size(), threads, [&](int i, int t) {
+		const vector<int> &indexes = byOrigin.at(origins[i]);
+		vector<int> destinations;
+		for (int trip : indexes)
+			destinations.push_back(compact.getIndex(trips[trip].second));
+		vector<double> costs;
+		vector<vector<int>> edges;
+		compact.oneToMany(origins[i], destinations, TRAVEL_TIME, costs, workspaces[t], &edges);
+		for (size_t j = 0; j < indexes.size(); ++j) {
+			found[indexes[j]] = costs[j] != infinity;
+			paths[indexes[j]].swap(edges[j]);
+		}
+	});
+
+	// Added in the order given, whatever the order of the searches
+	vector<int> ids(trips.size(), -1);
+	for (size_t i = 0; i < trips.size(); ++i) {
+		if (!found[i]) continue;
+		Vehicle vehicle;
+		vehicle.origin = compact.getIndex(trips[i].first);
+		vehicle.begin = vehicle.next = routes.size();
+		routes.insert(routes.end(), paths[i].begin(), paths[i].end());
+		vehicle.end = routes.size();
+		vehicle.departure = times[i];
+
+		ids[i] = vehicles.size();
+		vehicles.push_back(vehicle);
+		departures[vehicle.origin].push_back(ids[i]);
+		++stats.waiting;
+	}
+	sorted = false;
+	return ids;
+}
+
+/*
+ * @brief Adds count trips between random vertices, from a few random
+ * origins (see SIMULATION_RANDOM_ORIGINS), departing at random within
+ * the next window seconds. The same seed gives the same trips: each
+ * trip draws from its own stream (see RandomStream), so they are drawn
+ * in parallel.
+ * @return Number of trips added (those with a route)
+ */
+int TrafficSimulation::addRandomTrips(int count, double window, uint64_t seed) {
+	int n = compact.getNumVertices();
+	if (n == 0 || count <= 0) return 0;
+
+	RandomStream random = RandomStream::fromSeed(seed, RANDOM_STREAM_TRIPS);
+	vector<Vertex*> origins;
+	for (int i = 0; i < SIMULATION_RANDOM_ORIGINS; ++i)
+		origins.push_back(compact.getVertex(random.below(n)));
+
+	vector<pair<Vertex*, Vertex*>> trips(count);
+	vector<double> times(count);
+	double now = getTime();
+	parallelFor(count, threads, [&](int i, int) {
+		RandomStream trip = RandomStream::fromSeed(seed, RANDOM_STREAM_TRIPS, i + 1);
+		trips[i] = {origins[trip.below(origins.size())], compact.getVertex(trip.below(n))};
+		times[i] = now + window * trip.uniform();
+	});
+
+	vector<int> ids = addTrips(trips, times);
+	return count - std::count(ids.begin(), ids.end(), -1);
+}
+
+/*
+ * @brief Advances the simulation by SIMULATION_STEP seconds
+ */
+void TrafficSimulation::step() {
+	if (!sorted) sortDepartures();
+	double now = getTime();
+	vector<SimulationStats> counts(threads); // Changes seen by each thread
+
+	// Vertices: the vehicles due at the head of each queue ask for room on their next edge
+	parallelFor(cells.size(), threads, [&](int c, int) {
+		for (int v : cells[c]) {
+			for (int e : incoming[v]) {
+				if (headExit[e] > now) continue; // Empty, or not yet
+				int head = queues[e].front();
+				int next = wantedEdge(head);
+				if (next < 0) granted[e] = 1; // Arrived
+				else if (canEnter(next)) requests[next].push_back(e);
+			}
+			if (!departures[v].empty()) {
+				int head = departures[v].front();
+				if (vehicles[head].departure > now) continue;
+				int next = wantedEdge(head);
+				if (next < 0) departureGranted[v] = 1;
+				else if (canEnter(next)) requests[next].push_back(-1);
+			}
+		}
+	});
+
+	// Subroads: room left goes to the requests, both directions in turn,
+	// and the stuck vehicles get in even without it
+	int chunk = 1024;
+	parallelFor((linkEdges.size() + chunk - 1) / chunk, threads, [&](int c, int) {
+		int last = min((int)linkEdges.size(), (c + 1) * chunk);
+		for (int l = c * chunk; l < last; ++l) {
+			const vector<int> &edges = linkEdges[l];
+			for (int e : edges) {
+				occupancy[l] -= leaving[e];
+				leaving[e] = 0;
+			}
+			int room = capacity[l] - occupancy[l];
+			for (size_t i = 0; ; ++i) {
+				bool any = false;
+				for (int e : edges) {
+					if (i >= requests[e].size()) continue;
+					any = true;
+					if (room <= 0 && !isStuck(requests[e][i], now)) continue;
+					if (requests[e][i] >= 0) granted[requests[e][i]] = 1;
+					else departureGranted[compact.getSource(e)] = 1;
+					++occupancy[l];
+					--room;
+				}
+				if (!any) break;
+			}
+			for (int e : edges)
+				requests[e].clear();
+		}
+	});
+
+	// Vertices: the vehicles granted leave their queues
+	parallelFor(cells.size(), threads, [&](int c, int t) {
+		SimulationStats &count = counts[t];
+		for (int v : cells[c]) {
+			for (int e : incoming[v]) {
+				if (!granted[e]) {
+					if (headExit[e] <= now) ++count.blocked;
+					continue;
+				}
+				granted[e] = 0;
+				int head = queues[e].front();
+				queues[e].pop_front();
+				headExit[e] = queues[e].empty() ? infinity : vehicles[queues[e].front()].exit;
+				++leaving[e];
+				if (wantedEdge(head) >= 0) moving[v].push_back(head);
+				else {
+					vehicles[head].state = VEHICLE_ARRIVED;
+					vehicles[head].arrival = now;
+					--count.driving;
+					++count.arrived;
+				}
+			}
+			if (departureGranted[v]) {
+				departureGranted[v] = 0;
+				int head = departures[v].front();
+				departures[v].pop_front();
+				--count.waiting;
+				if (wantedEdge(head) >= 0) {
+					moving[v].push_back(head);
+					++count.driving;
+				} else {
+					vehicles[head].state = VEHICLE_ARRIVED;
+					vehicles[head].arrival = now;
+					++count.arrived;
+				}
+			}
+		}
+	});
+
+	// Vertices: and enter their next edge
+	parallelFor(cells.size(), threads, [&](int c, int) {
+		for (int v : cells[c]) {
+			for (int id : moving[v]) {
+				Vehicle &vehicle = vehicles[id];
+				int e = routes[vehicle.next++];
+				queues[e].push_back(id);
+				vehicle.exit = now + travelTime(e);
+				if (queues[e].size() == 1) headExit[e] = vehicle.exit;
+				vehicle.state = VEHICLE_DRIVING;
+			}
+			moving[v].clear();
+		}
+	});
+
+	stats.blocked = 0;
+	for (const SimulationStats &count : counts) {
+		stats.waiting += count.waiting;
+		stats.driving += count.driving;
+		stats.arrived += count.arrived;
+		stats.blocked += count.blocked;
+	}
+	++steps;
+}
+
+void TrafficSimulation::run(int steps) {
+	for (int i = 0; i < steps; ++i)
+		step();
+}
+
+/*
+ * @brief Runs until vehicle arrives, for at most maxSteps steps
+ * @return Whether it arrived
+ */
+bool TrafficSimulation::runUntilArrived(int vehicle, int maxSteps) {
+	for (int i = 0; i < maxSteps && getState(vehicle) != VEHICLE_ARRIVED; ++i)
+		step();
+	return getState(vehicle) == VEHICLE_ARRIVED;
+}
+
+/*
+ * @brief Sets the actual capacity of every subroad of
+ * the graph to the vehicles simulated on it
+ */
+void TrafficSimulation::writeOccupancies() const {
+	for (size_t l = 0; l < linkEdges.size(); ++l) {
+		compact.getEdge(linkEdges[l][0])->setActualCapacity(min(capacity[l], occupancy[l]));
+	}
+}
+
+/*
+ * @brief Seconds simulated so far
+ */
+double TrafficSimulation::getTime() const {
+	return steps * SIMULATION_STEP;
+}
+
+int TrafficSimulation::getNumVehicles() const {
+	return vehicles.size();
+}
+
+SimulationStats TrafficSimulation::getStats() const {
+	return stats;
+}
+
+VehicleState TrafficSimulation::getState(int vehicle) const {
+	return vehicles[vehicle].state;
+}
+
+/*
+ * @brief Seconds from the vehicle's departure time to its
+ * arrival, or to now if it has not arrived
+ */
+double TrafficSimulation::getTravelTime(int vehicle) const {
+	const Vehicle &v = vehicles[vehicle];
+	return max(0.0, (v.state == VEHICLE_ARRIVED ? v.arrival : getTime()) - v.departure);
+}
+
+/*
+ * @brief Last vertex the vehicle reached: its origin until it leaves,
+ * its destination once it arrives
+ */
+Vertex* TrafficSimulation::getLastVertex(int vehicle) const {
+	const Vehicle &v = vehicles[vehicle];
+	if (v.next == v.begin) return compact.getVertex(v.origin);
+	if (v.state == VEHICLE_ARRIVED) return compact.getVertex(compact.getTarget(routes[v.end - 1]));
+	return compact.getVertex(compact.getSource(routes[v.next - 1]));
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Graph.h"
+#include "CompactGraph.h"
+
+#include <deque>
+#include <stdint.h>
+
+using namespace std;
+
+// Traffic simulation: seconds per step, seconds a vehicle waits for
+// room before it squeezes in anyway, vertices per cell of the spatial
+// partition (the unit of work of each thread), and origins the random
+// trips are drawn from (one search each)
+#define SIMULATION_STEP            1.0
+#define SIMULATION_STUCK_TIME      60.0
+#define SIMULATION_CELL_SIZE       256
+#define SIMULATION_RANDOM_ORIGINS  64
+
+// Interactive simulations (see subroadSimulation): seconds over which the
+// other vehicles leave, and most steps each stretch may take
+#define SIMULATION_VIEW_WINDOW     600.0
+#define SIMULATION_VIEW_MAX_STEPS  3600
+
+enum VehicleState {
+	VEHICLE_WAITING,    // Not departed yet, or no room on its first edge
+	VEHICLE_DRIVING,
+	VEHICLE_ARRIVED
+};
+
+/*
+ * Counts of the vehicles after a simulation step
+ */
+struct SimulationStats {
+	int waiting = 0;
+	int driving = 0;
+	int arrived = 0;
+	int blocked = 0;      // Due to leave an edge, but with no room on the next (or it is accidented)
+};
+
+//////////////////////////////
+/// Class TrafficSimulation //
+//////////////////////////////
+
+/**
+ * Discrete time simulation of vehicles driving over the clear part
+ * of a Graph (as it was when the simulation was built), each along
+ * a fixed route.
+ *
+ * Every edge keeps a queue of the vehicles on it, in the order they
+ * entered. A vehicle takes the travel time of the edge at the
+ * occupancy of its subroad when it entered (see
+ * Subroad::calculateAverageSpeed), and then waits at the head of the
+ * queue until there is room on the subroad of its next edge: at most
+ * maxCapacity vehicles can be on a subroad, in both directions
+ * together, and at most one vehicle leaves each edge per step.
+ * So that full subroads waiting on each other in a cycle do not lock
+ * up for good, a vehicle that has waited SIMULATION_STUCK_TIME enters
+ * its next edge anyway. Accidented edges and vertices take no
+ * vehicles in.
+ *
+ * Each step runs in phases over the cells of a spatial partition of
+ * the vertices, spread over the threads: vertices ask for room for
+ * the vehicles at the head of their incoming queues, subroads grant
+ * it in a fixed order, and vertices move the vehicles granted. No
+ * phase depends on the order the threads run in, so for the same
+ * trips (and seed) every run is the same.
+ */
+class TrafficSimulation {
+	struct Vehicle {
+		int origin;
+		int begin, end, next;   // Route: edges routes[begin..end-1], the next one to enter
+		double departure;       // Seconds
+		double exit = 0;        // Seconds, when it may leave its edge
+		double arrival = 0;
+		VehicleState state = VEHICLE_WAITING;
+	};
+
+	Graph *graph;
+	CompactGraph compact;
+	int threads;
+	long long steps = 0;
+
+	vector<vector<int>> cells;          // Vertices of each cell
+	vector<vector<int>> incoming;       // Edges into each vertex
+	vector<int> linkOf;                 // Per edge, its subroad
+	vector<vector<int>> linkEdges;      // Per subroad, its edges
+	vector<int> capacity;               // Per subroad, its maximum capacity
+	vector<int> occupancy;              // Per subroad
+
+	vector<Vehicle> vehicles;
+	vector<int> routes;                 // Edges of every route, one after another
+	vector<deque<int>> queues;          // Per edge, vehicles on it
+	vector<double> headExit;            // Per edge, exit time of its first vehicle, infinity if none
+	vector<deque<int>> departures;      // Per vertex, vehicles waiting to depart from it
+	bool sorted = true;                 // Whether departures are in departure order
+
+	vector<vector<int>> requests;       // Per edge, edges whose head asks to enter it (-1: departure)
+	vector<char> granted;               // Per edge, whether its head may leave
+	vector<char> departureGranted;      // Per vertex
+	vector<int> leaving;                // Per edge, vehicles that left it this step
+	vector<vector<int>> moving;         // Per vertex, vehicles crossing it this step
+	SimulationStats stats;
+
+	double travelTime(int edge) const;
+	bool canEnter(int edge) const;
+	bool isStuck(int edge, double now) const;
+	int wantedEdge(int vehicle) const;
+	void sortDepartures();
+
+public:
+	explicit TrafficSimulation(Graph *graph, int threads = 0);
+
+	int addVehicle(const vector<Vertex*> &path, double departure);
+	vector<int> addTrips(const vector<pair<Vertex*, Vertex*>> &trips, const vector<double> &times);
+	int addRandomTrips(int count, double window, uint64_t seed);
+
+	void step();
+	void run(int steps);
+	bool runUntilArrived(int vehicle, int maxSteps);
+	void writeOccupancies() const;
+
+	double getTime() const;
+	int getNumVehicles() const;
+	SimulationStats getStats() const;
+	VehicleState getState(int vehicle) const;
+	double getTravelTime(int vehicle) const;
+	Vertex *getLastVertex(int vehicle) const;
+};
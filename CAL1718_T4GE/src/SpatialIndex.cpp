@@ -0,0 +1,341 @@
+#include "SpatialIndex.h"
+#include "Graph.h"
+
+#include <algorithm>
+#include <queue>
+#include <math.h>
+
+// Expected number of vertices per grid cell
+#define VERTICES_PER_CELL      2
+
+/*
+ * @brief (Private) Grid column of an X coordinate,
+ * clamped to the grid
+ */
+int SpatialGrid::column(double x) const {
+	int c = (int)floor(x / cellSize);
+	return max(0, min(columns - 1, c));
+}
+
+/*
+ * @brief (Private) Grid row of a Y coordinate,
+ * clamped to the grid
+ */
+int SpatialGrid::row(double y) const {
+	int r = (int)floor(y / cellSize);
+	return max(0, min(rows - 1, r));
+}
+
+/*
+ * @brief (Private) Cell holding the point (x, y)
+ */
+vector<Vertex*> &SpatialGrid::cell(int x, int y) {
+	return cells[row(y) * columns + column(x)];
+}
+
+/*
+ * @brief (Re)builds the grid for the given vertices
+ * over an area of width x height. The cell size is chosen so that
+ * each cell holds about VERTICES_PER_CELL vertices.
+ */
+void SpatialGrid::build(const vector<Vertex*> &vertices, int width, int height) {
+	long double area = (long double)(width + 1) * (height + 1);
+	long double cells = max<size_t>(1, vertices.size() / VERTICES_PER_CELL);
+	cellSize = max(1, (int)ceil(sqrt(area / cells)));
+	columns = width / cellSize + 1;
+	rows = height / cellSize + 1;
+	this->cells.assign(columns * rows, vector<Vertex*>());
+	size = 0;
+	for (auto v : vertices)
+		insert(v);
+}
+
+/*
+ * @brief Checks if the grid was already built
+ */
+bool SpatialGrid::isBuilt() const {
+	return columns > 0;
+}
+
+/*
+ * @brief Returns the side of each (square) cell
+ */
+int SpatialGrid::getCellSize() const {
+	return cellSize;
+}
+
+/*
+ * @brief Returns the number of indexed vertices
+ */
+int SpatialGrid::getSize() const {
+	return size;
+}
+
+/*
+ * @brief Adds vertex v to the cell of its coordinates
+ */
+void SpatialGrid::insert(Vertex *v) {
+	if (!isBuilt()) return;
+	cell(v->getX(), v->getY()).push_back(v);
+	++size;
+}
+
+/*
+ * @brief Removes vertex v from the grid
+ * @return True if the vertex was indexed, false otherwise
+ */
+bool SpatialGrid::remove(Vertex *v) {
+	if (!isBuilt()) return false;
+	vector<Vertex*> &c = cell(v->getX(), v->getY());
+	auto it = find(c.begin(), c.end(), v);
+	if (it == c.end()) return false;
+	*it = c.back();
+	c.pop_back();
+	--size;
+	return true;
+}
+
+/*
+ * @brief Returns the vertex closest to (x, y) accepted by the filter
+ * @return The vertex, or nullptr if there is none
+ */
+Vertex* SpatialGrid::nearest(double x, double y, filter accept) const {
+	vector<Vertex*> found = nearest(x, y, 1, accept);
+	return found.empty() ? nullptr : found.front();
+}
+
+/*
+ * @brief Returns the k vertices closest to (x, y) accepted by the filter,
+ * closest first. The search visits rings of cells around the point's cell
+ * and stops as soon as no unvisited cell can hold a closer vertex.
+ */
+vector<Vertex*> SpatialGrid::nearest(double x, double y, int k, filter accept) const {
+	using candidate = pair<double, Vertex*>;
+	priority_queue<candidate> best; // max-heap on squared distance
+	vector<Vertex*> result;
+
+	if (!isBuilt() || k <= 0) return result;
+
+	int cx = column(x), cy = row(y);
+	int maxRing = max(max(cx, columns - 1 - cx), max(cy, rows - 1 - cy));
+
+	for (int r = 0; r <= maxRing; ++r) {
+		// Visit the cells at Chebyshev distance r from (cx, cy)
+		for (int j = cy - r; j <= cy + r; ++j) {
+			if (j < 0 || j >= rows) continue;
+			bool edgeRow = (j == cy - r || j == cy + r);
+			for (int i = cx - r; i <= cx + r; i += (edgeRow ? 1 : 2 * r)) {
+				if (i >= 0 && i < columns) {
+					for (auto v : cells[j * columns + i]) {
+						if (accept && !accept(v)) continue;
+						double dx = v->getX() - x, dy = v->getY() - y;
+						double d = dx * dx + dy * dy;
+						if ((int)best.size() < k)
+							best.push({d, v});
+						else if (d < best.top().first) {
+							best.pop();
+							best.push({d, v});
+						}
+					}
+				}
+				if (r == 0) break;
+			}
+		}
+
+		// Any vertex outside the visited square is at least this far
+		if ((int)best.size() == k) {
+			double left = x - (double)(cx - r) * cellSize;
+			double right = (double)(cx + r + 1) * cellSize - x;
+			double top = y - (double)(cy - r) * cellSize;
+			double bottom = (double)(cy + r + 1) * cellSize - y;
+			double bound = max(0.0, min(min(left, right), min(top, bottom)));
+			if (bound * bound >= best.top().first) break;
+		}
+	}
+
+	while (!best.empty()) {
+		result.push_back(best.top().second);
+		best.pop();
+	}
+	reverse(result.begin(), result.end());
+	return result;
+}
+
+/*
+ * @brief Returns every vertex accepted by the filter inside the
+ * rectangle with corners (x1, y1) and (x2, y2), borders included
+ */
+vector<Vertex*> SpatialGrid::range(double x1, double y1, double x2, double y2, filter accept) const {
+	vector<Vertex*> result;
+
+	if (!isBuilt()) return result;
+	if (x1 > x2) swap(x1, x2);
+	if (y1 > y2) swap(y1, y2);
+
+	for (int j = row(y1); j <= row(y2); ++j) {
+		for (int i = column(x1); i <= column(x2); ++i) {
+			for (auto v : cells[j * columns + i]) {
+				if (v->getX() < x1 || v->getX() > x2) continue;
+				if (v->getY() < y1 || v->getY() > y2) continue;
+				if (accept && !accept(v)) continue;
+				result.push_back(v);
+			}
+		}
+	}
+
+	return result;
+}
+
+
+
+
+/*
+ * @brief (Private) Grid column of an X coordinate,
+ * clamped to the grid
+ */
+int SegmentGrid::column(double x) const {
+	int c = (int)floor(x / cellSize);
+	return max(0, min(columns - 1, c));
+}
+
+/*
+ * @brief (Private) Grid row of a Y coordinate,
+ * clamped to the grid
+ */
+int SegmentGrid::row(double y) const {
+	int r = (int)floor(y / cellSize);
+	return max(0, min(rows - 1, r));
+}
+
+/*
+ * @brief (Re)builds an empty grid with the given cell
+ * size over an area of width x height
+ */
+void SegmentGrid::build(int cellSize, int width, int height) {
+	this->cellSize = max(1, cellSize);
+	columns = width / this->cellSize + 1;
+	rows = height / this->cellSize + 1;
+	cells.assign(columns * rows, vector<Edge*>());
+	size = 0;
+}
+
+/*
+ * @brief Checks if the grid was already built
+ */
+bool SegmentGrid::isBuilt() const {
+	return columns > 0;
+}
+
+/*
+ * @brief Returns the number of indexed edges
+ */
+int SegmentGrid::getSize() const {
+	return size;
+}
+
+/*
+ * @brief Adds edge e to every cell its segment's
+ * bounding box overlaps
+ */
+void SegmentGrid::insert(Edge *e) {
+	if (!isBuilt()) return;
+	Vertex *a = e->getSource(), *b = e->getDest();
+	for (int j = row(min(a->getY(), b->getY())); j <= row(max(a->getY(), b->getY())); ++j)
+		for (int i = column(min(a->getX(), b->getX())); i <= column(max(a->getX(), b->getX())); ++i)
+			cells[j * columns + i].push_back(e);
+	++size;
+}
+
+/*
+ * @brief Removes edge e from the grid
+ * @return True if the edge was indexed, false otherwise
+ */
+bool SegmentGrid::remove(Edge *e) {
+	if (!isBuilt()) return false;
+	Vertex *a = e->getSource(), *b = e->getDest();
+	bool found = false;
+	for (int j = row(min(a->getY(), b->getY())); j <= row(max(a->getY(), b->getY())); ++j) {
+		for (int i = column(min(a->getX(), b->getX())); i <= column(max(a->getX(), b->getX())); ++i) {
+			vector<Edge*> &c = cells[j * columns + i];
+			auto it = find(c.begin(), c.end(), e);
+			if (it == c.end()) continue;
+			*it = c.back();
+			c.pop_back();
+			found = true;
+		}
+	}
+	if (found) --size;
+	return found;
+}
+
+/*
+ * @brief Projects the point (x, y) on the segment of edge e
+ * @param t Set to the position of the projection along the
+ * segment, from 0 (source) to 1 (destination)
+ * @return The squared distance from the point to the segment
+ */
+double SegmentGrid::project(Edge *e, double x, double y, double &t) {
+	double ax = e->getSource()->getX(), ay = e->getSource()->getY();
+	double dx = e->getDest()->getX() - ax, dy = e->getDest()->getY() - ay;
+	double length = dx * dx + dy * dy;
+
+	t = (length == 0) ? 0 : ((x - ax) * dx + (y - ay) * dy) / length;
+	t = max(0.0, min(1.0, t));
+
+	double px = ax + t * dx - x, py = ay + t * dy - y;
+	return px * px + py * py;
+}
+
+/*
+ * @brief Returns the edge whose segment is closest to (x, y),
+ * among those accepted by the filter. The search visits rings of
+ * cells around the point's cell and stops as soon as no unvisited
+ * cell can hold a closer segment.
+ * @param t Set to the position of the closest point along the edge
+ * @return The edge, or nullptr if there is none
+ */
+Edge* SegmentGrid::nearest(double x, double y, double &t, filter accept) const {
+	Edge *best = nullptr;
+	double bestDistance = 0;
+
+	t = 0;
+	if (!isBuilt()) return nullptr;
+
+	int cx = column(x), cy = row(y);
+	int maxRing = max(max(cx, columns - 1 - cx), max(cy, rows - 1 - cy));
+
+	for (int r = 0; r <= maxRing; ++r) {
+		// Visit the cells at Chebyshev distance r from (cx, cy)
+		for (int j = cy - r; j <= cy + r; ++j) {
+			if (j < 0 || j >= rows) continue;
+			bool edgeRow = (j == cy - r || j == cy + r);
+			for (int i = cx - r; i <= cx + r; i += (edgeRow ? 1 : 2 * r)) {
+				if (i >= 0 && i < columns) {
+					for (auto e : cells[j * columns + i]) {
+						if (accept && !accept(e)) continue;
+						double et;
+						double d = project(e, x, y, et);
+						if (best == nullptr || d < bestDistance) {
+							best = e;
+							bestDistance = d;
+							t = et;
+						}
+					}
+				}
+				if (r == 0) break;
+			}
+		}
+
+		// Any segment outside the visited square is at least this far
+		if (best != nullptr) {
+			double left = x - (double)(cx - r) * cellSize;
+			double right = (double)(cx + r + 1) * cellSize - x;
+			double top = y - (double)(cy - r) * cellSize;
+			double bottom = (double)(cy + r + 1) * cellSize - y;
+			double bound = max(0.0, min(min(left, right), min(top, bottom)));
+			if (bound * bound >= bestDistance) break;
+		}
+	}
+
+	return best;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+using namespace std;
+
+class Vertex;
+class Edge;
+
+//////////////////////////
+//// Class SpatialGrid ///
+//////////////////////////
+
+/**
+ * Uniform grid over the GraphViewer coordinates of the vertices.
+ * Each cell holds the vertices whose (x, y) fall inside it, so that
+ * nearest neighbour and range queries only visit nearby cells.
+ */
+class SpatialGrid {
+	int cellSize = 1;
+	int columns = 0, rows = 0;
+	vector<vector<Vertex*>> cells;
+	int size = 0;
+
+	int column(double x) const;
+	int row(double y) const;
+	vector<Vertex*> &cell(int x, int y);
+
+public:
+	using filter = function<bool(Vertex*)>;
+
+	///// ***** Construction
+	void build(const vector<Vertex*> &vertices, int width, int height);
+	bool isBuilt() const;
+	int getCellSize() const;
+	int getSize() const;
+	/////
+
+	///// ***** Updates
+	void insert(Vertex *v);
+	bool remove(Vertex *v);
+	/////
+
+	///// ***** Queries
+	Vertex *nearest(double x, double y, filter accept = nullptr) const;
+	vector<Vertex*> nearest(double x, double y, int k, filter accept = nullptr) const;
+	vector<Vertex*> range(double x1, double y1, double x2, double y2, filter accept = nullptr) const;
+	/////
+};
+
+
+
+//////////////////////////
+//// Class SegmentGrid ///
+//////////////////////////
+
+/**
+ * Uniform grid over the straight segments of the edges. Each edge
+ * is kept in every cell its bounding box overlaps, so that the edge
+ * closest to a point is found by visiting only the nearby cells.
+ */
+class SegmentGrid {
+	int cellSize = 1;
+	int columns = 0, rows = 0;
+	vector<vector<Edge*>> cells;
+	int size = 0;
+
+	int column(double x) const;
+	int row(double y) const;
+
+public:
+	using filter = function<bool(Edge*)>;
+
+	///// ***** Construction
+	void build(int cellSize, int width, int height);
+	bool isBuilt() const;
+	int getSize() const;
+	/////
+
+	///// ***** Updates
+	void insert(Edge *e);
+	bool remove(Edge *e);
+	/////
+
+	///// ***** Queries
+	static double project(Edge *e, double x, double y, double &t);
+	Edge *nearest(double x, double y, double &t, filter accept = nullptr) const;
+	/////
+};
@@ -0,0 +1,145 @@
+#include "TimeProfile.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <math.h>
+
+/*
+ * @brief Builds a profile from (hour, factor) breakpoints
+ * @throws invalid_argument if there are no breakpoints, the hours are
+ * not ascending within [0, 24) or some factor is below 1
+ */
+TravelTimeProfile::TravelTimeProfile(const vector<pair<double, double>> &breakpoints) {
+	if (breakpoints.empty()) {
+		throw invalid_argument("Profile without breakpoints");
+	}
+	for (size_t i = 0; i < breakpoints.size(); ++i) {
+		double hour = breakpoints[i].first, factor = breakpoints[i].second;
+		if (hour < 0 || hour >= HOURS_PER_DAY || (i > 0 && hour <= breakpoints[i - 1].first)) {
+			throw invalid_argument("Profile hours must be ascending in [0, 24)");
+		}
+		if (factor < 1) {
+			throw invalid_argument("Profile factors must be at least 1");
+		}
+		hours.push_back(hour);
+		factors.push_back(factor);
+	}
+
+	// Steepest descent, including the segment wrapping around midnight
+	for (size_t i = 0; i < hours.size(); ++i) {
+		size_t next = (i + 1) % hours.size();
+		double span = next > i ? hours[next] - hours[i] : hours[next] + HOURS_PER_DAY - hours[i];
+		maxDescent = max(maxDescent, (factors[i] - factors[next]) / span);
+	}
+}
+
+/*
+ * @brief Travel time factor at the given time of day,
+ * interpolated between the surrounding breakpoints
+ * @param hour Hours since midnight of any day
+ */
+double TravelTimeProfile::factor(double hour) const {
+	if (hours.size() == 1) return factors[0];
+
+	hour = fmod(hour, HOURS_PER_DAY);
+	if (hour < 0) hour += HOURS_PER_DAY;
+
+	// Segment [hours[i], hours[i + 1]), or the one wrapping around midnight
+	size_t next = upper_bound(hours.begin(), hours.end(), hour,
+			[](double h, float breakpoint) { return h < breakpoint; }) - hours.begin();
+	size_t i = next == 0 ? hours.size() - 1 : next - 1;
+	next %= hours.size();
+
+	double start = hours[i], end = hours[next];
+	if (end <= start) end += HOURS_PER_DAY;
+	if (hour < start) hour += HOURS_PER_DAY;
+
+	double t = (hour - start) / (end - start);
+	return factors[i] + t * (factors[next] - factors[i]);
+}
+
+/*
+ * @brief Time to travel a subroad leaving at departure (hours), given
+ * its free-flow travel time (hours). Arrival times never decrease
+ * with the departure time (FIFO): where a slightly later departure
+ * would arrive earlier, the vehicle waits for it instead.
+ */
+double TravelTimeProfile::travelTime(double freeFlow, double departure) const {
+	double duration = freeFlow * factor(departure);
+
+	// Travel time falls slower than time passes: FIFO already holds
+	if (freeFlow * maxDescent <= 1) return duration;
+
+	// Otherwise, the earliest arrival over the next day of departures is
+	// reached at departure itself or at one of the breakpoints
+	double arrival = departure + duration;
+	double midnight = floor(departure / HOURS_PER_DAY) * HOURS_PER_DAY;
+	for (int day = 0; day < 2; ++day) {
+		for (size_t i = 0; i < hours.size(); ++i) {
+			double later = midnight + day * HOURS_PER_DAY + hours[i];
+			if (later <= departure || later >= departure + HOURS_PER_DAY) continue;
+			arrival = min(arrival, later + freeFlow * factors[i]);
+		}
+	}
+	return arrival - departure;
+}
+
+double TravelTimeProfile::getMaxDescent() const {
+	return maxDescent;
+}
+
+
+
+//////////////////////
+// Profile Registry //
+//////////////////////
+
+/*
+ * @brief Built-in daily profiles, by road class:
+ * 0 urban (50 km/h), 1 arterial (70), 2 regional (90), 3 highway (120)
+ */
+static vector<TravelTimeProfile> &timeProfiles() {
+	static vector<TravelTimeProfile> profiles = {
+		TravelTimeProfile({{0, 1.0}, {6, 1.05}, {8, 2.2}, {10, 1.4}, {13, 1.6}, {15, 1.4}, {18, 2.4}, {20, 1.3}, {23, 1.0}}),
+		TravelTimeProfile({{0, 1.0}, {6, 1.05}, {8, 1.9}, {10, 1.3}, {13, 1.4}, {15, 1.3}, {18, 2.0}, {20, 1.2}, {23, 1.0}}),
+		TravelTimeProfile({{0, 1.0}, {6, 1.0}, {8, 1.5}, {10, 1.15}, {17, 1.2}, {18, 1.6}, {20, 1.1}, {23, 1.0}}),
+		TravelTimeProfile({{0, 1.0}, {6, 1.0}, {8, 1.8}, {9, 1.3}, {10, 1.1}, {17, 1.3}, {18, 1.9}, {19, 1.3}, {21, 1.0}})
+	};
+	return profiles;
+}
+
+/*
+ * @brief Registers a new profile
+ * @return The profile's index, for Subroad::setTimeProfile
+ * @throws length_error if there are too many profiles
+ * Not thread-safe: register profiles before running searches.
+ */
+int addTimeProfile(const TravelTimeProfile &profile) {
+	if (timeProfiles().size() >= MAX_TIME_PROFILES) {
+		throw length_error("Too many time profiles");
+	}
+	timeProfiles().push_back(profile);
+	return timeProfiles().size() - 1;
+}
+
+/*
+ * @throws out_of_range if there is no profile with that index
+ */
+const TravelTimeProfile &getTimeProfile(int id) {
+	return timeProfiles().at(id);
+}
+
+int getNumTimeProfiles() {
+	return timeProfiles().size();
+}
+
+/*
+ * @brief Index of the built-in profile of roads
+ * with the given maximum speed (km/h)
+ */
+int defaultTimeProfile(int maxSpeed) {
+	if (maxSpeed > 90) return 3;
+	if (maxSpeed > 70) return 2;
+	if (maxSpeed > 50) return 1;
+	return 0;
+}
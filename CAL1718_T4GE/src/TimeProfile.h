@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+// Subroads without a profile of their own follow their road's class
+#define DEFAULT_TIME_PROFILE   255
+#define MAX_TIME_PROFILES      255
+
+#define HOURS_PER_DAY          24.0
+
+//////////////////////////////////
+/// Class TravelTimeProfile //////
+//////////////////////////////////
+
+/**
+ * Daily traffic pattern: a piecewise-linear function of the time of
+ * day (hours, repeating every 24) giving the factor by which the
+ * free-flow travel time of a subroad is multiplied. Factors are at
+ * least 1, so free-flow times are lower bounds of travel times.
+ *
+ * Profiles are shared: each Subroad stores only the (1 byte) index
+ * of its profile, see addTimeProfile and getTimeProfile.
+ */
+class TravelTimeProfile {
+	vector<float> hours;      // Breakpoints, ascending in [0, 24)
+	vector<float> factors;    // Factor at each breakpoint
+	double maxDescent = 0;    // Steepest decrease of the factor, per hour
+
+public:
+	explicit TravelTimeProfile(const vector<pair<double, double>> &breakpoints);
+
+	double factor(double hour) const;
+	double travelTime(double freeFlow, double departure) const;
+	double getMaxDescent() const;
+};
+
+///// ***** Profile registry
+int addTimeProfile(const TravelTimeProfile &profile);
+const TravelTimeProfile &getTimeProfile(int id);
+int getNumTimeProfiles();
+int defaultTimeProfile(int maxSpeed);
+/////
@@ -1,6 +1,9 @@
 #include "LoadMap.h"
 #include "Graph.h"
 #include "Interface.h"
+#include "MapRegistry.h"
+#include "BatchRouting.h"
+#include "Random.h"
 #include <windows.h>
 
 #include <stdlib.h>
@@ -24,18 +27,14 @@ string files = "Select map file\n\n"
 "tokyo        10K          8K\n"
 "paris        18K          16K\n";
 
-Graph* graph;
-
-static void getFilename(string &filename) {
+static void getMapName(string &name) {
 	cout << files << endl;
 
 	while (1) {
 		cout << "Filename: ";
-		cin >> filename;
-
-		filename = FILENAME_PREFIX + filename;
+		cin >> name;
 
-		if (checkFilename(filename))
+		if (checkFilename(FILENAME_PREFIX + name))
 			return;
 		else
 			cout << "Invalid filename. Try again !" << endl << endl;
@@ -43,37 +42,52 @@ static void getFilename(string &filename) {
 }
 
 int main(int argc, char* argv[]) {
-	srand(time(0));
+	// --seed S first makes the simulations repeatable; otherwise the
+	// seed changes from run to run (and is shown with each simulation)
+	setRandomSeed(time(0));
+	if (argc > 2 && string(argv[1]) == "--seed") {
+		try {
+			setRandomSeed(stoull(argv[2]));
+		} catch (exception &e) {
+			cerr << "Invalid seed " << argv[2] << endl;
+			return 1;
+		}
+		argv[2] = argv[0];
+		argc -= 2;
+		argv += 2;
+	}
 
-	string filename;
+	string name;
 
 	SetConsoleCP(1252);
 	SetConsoleOutputCP(1252);
 
 	// Process args
 	if (argc > 1) {
-		filename = argv[1];
-		if (filename == "--test") {
-			getFilename(filename);
-			return testNewMap(filename);
+		name = argv[1];
+		if (name == "--test") {
+			getMapName(name);
+			return testNewMap(FILENAME_PREFIX + name);
+		}
+		if (name.compare(0, 2, "--") == 0) {
+			return batchMode(argc, argv);
 		}
-		filename = FILENAME_PREFIX + filename;
-		if (!checkFilename(filename)) {
-			getFilename(filename);
+		if (!checkFilename(FILENAME_PREFIX + name)) {
+			getMapName(name);
 		}
 	} else {
-		getFilename(filename);
+		getMapName(name);
 	}
 
 	cout << endl << "Loading map information ..";
 
-	if (loadMap(filename, graph) != 0) {
+	MapRegistry maps(FILENAME_PREFIX);
+	if (maps.get(name) == nullptr) {
 		system("pause");
 		return 1;
 	}
 	cout << ".";
-	mainMenu();
+	mainMenu(maps, name);
 
-	delete graph;
 	return 0;
 }